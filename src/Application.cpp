@@ -9,8 +9,10 @@
 #include "Scene.hpp"
 #include "SceneFactory.hpp"
 #include "slib.hpp"
+#include <cmath>
 #include <memory>
-#include <omp.h>
+#include <string>
+#include <tuple>
 #include <SDL2/SDL.h>
 
 namespace soft3d
@@ -41,47 +43,100 @@ namespace soft3d
 
     inline void Application::initGui()
     {
-        std::unique_ptr<soft3d::Scene> scene1 = isometricGameLevel(*renderer);
-        std::unique_ptr<soft3d::Scene> scene2 = vikingRoomSceneInit(*renderer);
-        std::unique_ptr<soft3d::Scene> scene3 = concreteCatInit(*renderer);
-        scenes.push_back(std::move(scene1));
-        scenes.push_back(std::move(scene2));
-        scenes.push_back(std::move(scene3));
+        // Scenes load their assets in the background when first shown (or prefetched)
+        scenes.push_back(std::make_unique<Scene>(*renderer, assets, isometricGameLevel));
+        scenes.push_back(std::make_unique<Scene>(*renderer, assets, vikingRoomSceneInit));
+        scenes.push_back(std::make_unique<Scene>(*renderer, assets, concreteCatInit));
+        scenes.push_back(std::make_unique<Scene>(*renderer, assets, vikingVillageInit));
+        scenes.push_back(std::make_unique<Scene>(*renderer, assets, streamedLevelInit));
         changeScene(0); // default scene
 
         eventManager->Subscribe([p = this] { p->changeScene(0); }, *gui->scene1ButtonDown);
         eventManager->Subscribe([p = this] { p->changeScene(1); }, *gui->scene2ButtonDown);
         eventManager->Subscribe([p = this] { p->changeScene(2); }, *gui->scene3ButtonDown);
+        eventManager->Subscribe([p = this] { p->changeScene(3); }, *gui->scene4ButtonDown);
+        eventManager->Subscribe([p = this] { p->changeScene(4); }, *gui->scene5ButtonDown);
         eventManager->Subscribe([p = this] { p->quit(); }, *gui->quitButtonDown);
         eventManager->Subscribe([p = renderer.get()] { p->setShader(soft3d::FLAT); }, *gui->flatShaderButtonDown);
         eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->flatShaderButtonDown);
         eventManager->Subscribe(
             [p = renderer.get()] { p->setShader(soft3d::GOURAUD); }, *gui->gouraudShaderButtonDown);
         eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->gouraudShaderButtonDown);
+        eventManager->Subscribe(
+            [p = renderer.get()] { p->setShader(soft3d::PHONG); }, *gui->phongShaderButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->phongShaderButtonDown);
         eventManager->Subscribe(
             [p = renderer.get()] { p->setTextureFilter(soft3d::NEIGHBOUR); }, *gui->neighbourButtonDown);
         eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->neighbourButtonDown);
         eventManager->Subscribe(
             [p = renderer.get()] { p->setTextureFilter(soft3d::BILINEAR); }, *gui->bilinearButtonDown);
         eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->bilinearButtonDown);
+        eventManager->Subscribe(
+            [p = renderer.get()] { p->SetCheckerboard(!p->Checkerboarded()); }, *gui->checkerboardButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->checkerboardButtonDown);
+        eventManager->Subscribe(
+            [p = renderer.get()] { p->SetReprojectionCache(p->ReprojectionCache() ? 0 : REPROJECTION_REFRESH); },
+            *gui->reprojectionButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->reprojectionButtonDown);
+        eventManager->Subscribe(
+            [p = renderer.get()] { p->SetVariableRateShading(!p->VariableRateShading()); },
+            *gui->variableRateButtonDown);
+        eventManager->Subscribe([p = this] { p->disableMouse(); }, *gui->variableRateButtonDown);
     }
 
     void Application::init()
     {
         initSDL();
         renderer = std::make_unique<Renderer>(sdlRenderer);
+        renderer->SetVirtualTextures(&assets.VirtualTextures());
         gui = std::make_unique<GUI>(sdlWindow, sdlRenderer);
         menuMouseEnabled = false;
         initGui();
-        omp_set_num_threads(omp_get_max_threads());
     }
 
+    // The renderer keeps drawing the current scene until the new one has loaded (see updateSceneLoading).
     void Application::changeScene(int newScene)
     {
-        scenes.at(newScene)->LoadScene();
+        scenes.at(newScene)->Prefetch();
+        requestedScene = newScene;
         disableMouse();
     }
 
+    void Application::updateSceneLoading()
+    {
+        if (requestedScene >= 0)
+        {
+            Scene& scene = *scenes[requestedScene];
+            if (scene.IsLoaded())
+            {
+                scene.LoadScene();
+                if (cameraInput) cameraInput->Place(renderer->camera);
+            }
+            else if (scene.Failed())
+            {
+                // Keep the current scene
+                std::cout << "Could not load scene " << requestedScene + 1 << ": " << scene.Error() << std::endl;
+            }
+            else
+            {
+                gui->loadingScene = requestedScene + 1;
+                gui->loadingProgress = scene.Progress();
+                return;
+            }
+            requestedScene = -1;
+            gui->loadingScene = 0;
+        }
+
+        // Once the requested scene is up, load the others one at a time so switching to them is instant. One that
+        // failed is only tried again when asked for.
+        for (const auto& scene : scenes)
+        {
+            if (scene->IsLoaded() || scene->Failed()) continue;
+            scene->Prefetch();
+            break;
+        }
+    }
+
     void Application::disableMouse()
     {
         menuMouseEnabled = false;
@@ -95,17 +150,32 @@ namespace soft3d
 
     void Application::draw()
     {
+        fpsCounter.Update();
         renderer->Render();
         gui->Draw();
         renderer->RenderBuffer();
+        repaint = false;
+    }
+
+    // The last frame again, with the menu bar over it, when only the menu bar or the window has changed.
+    void Application::redraw()
+    {
+        renderer->RedrawLastFrame();
+        gui->Draw();
+        renderer->RenderBuffer();
+        repaint = false;
     }
 
     void Application::update()
     {
-        clock.tick();
-        fpsCounter.Update();
+        updateSceneLoading();
         gui->fpsCounter = fpsCounter.fps_current;
-        renderer->camera.Update(clock.delta);
+        gui->renderScale = static_cast<int>(std::lround(renderer->ResolutionScale() * 100));
+        gui->checkerboard = renderer->Checkerboarded();
+        gui->reprojectionCache = renderer->ReprojectionCache() > 0;
+        gui->reuseRate = renderer->ReuseRate();
+        gui->variableRateShading = renderer->VariableRateShading();
+        gui->inputLatency = static_cast<int>(std::lround(renderer->InputLatency()));
 
         while (SDL_PollEvent(&event))
         {
@@ -113,14 +183,23 @@ namespace soft3d
             {
                 gui->Update(&event);
             }
-            else
+            // Key events too while the menu has the mouse: they time the movement keys
+            if (!menuMouseEnabled || event.type == SDL_KEYDOWN || event.type == SDL_KEYUP)
             {
-                renderer->camera.HandleEvent(&event);
+                cameraInput->HandleEvent(event);
             }
             if (event.type == SDL_QUIT)
             {
                 loop = SDL_FALSE;
             }
+            else if (event.type == SDL_WINDOWEVENT)
+            {
+                repaint = true; // E.g. uncovered: the window has to be painted again
+            }
+            else if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET)
+            {
+                gui->Invalidate(); // The overlay's contents are lost
+            }
             else if (event.type == SDL_MOUSEMOTION)
             {
                 if (!menuMouseEnabled)
@@ -151,21 +230,201 @@ namespace soft3d
                 }
             }
         }
+        cameraInput->SetMoveKeys(Camera::MoveKeys(SDL_GetKeyboardState(nullptr)));
     }
 
     void Application::cleanup()
     {
+        renderer.reset(); // Finishes the frame in flight and frees the frame texture while SDL is still up
+        cameraInput.reset();
         SDL_DestroyWindow(sdlWindow);
         SDL_DestroyRenderer(sdlRenderer);
         SDL_Quit();
     }
 
+    // Peak signal-to-noise ratio of two frames (colour channels only), in dB. Identical frames give infinity.
+    inline double psnr(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b)
+    {
+        double squaredError = 0;
+        for (size_t i = 0; i < a.size(); i += 4)
+        {
+            for (size_t c = 0; c < 3; ++c)
+            {
+                const double d = static_cast<double>(a[i + c]) - b[i + c];
+                squaredError += d * d;
+            }
+        }
+        const double mse = squaredError / (static_cast<double>(a.size()) / 4 * 3);
+        return 10 * std::log10(255.0 * 255.0 / mse);
+    }
+
+    inline double bytesPerVertex(const SceneData& data)
+    {
+        size_t bytes = 0, vertices = 0;
+        for (const auto& renderable : data.renderables)
+        {
+            bytes += renderable->mesh->AttributeBytes();
+            vertices += renderable->mesh->VertexCount();
+        }
+        for (const auto& batch : data.instancedRenderables)
+        {
+            bytes += batch->mesh->AttributeBytes();
+            vertices += batch->mesh->VertexCount();
+        }
+        for (const auto& mesh : data.streamingMeshes)
+        {
+            for (const auto& chunk : mesh->Chunks())
+            {
+                bytes += chunk.mesh->AttributeBytes();
+                vertices += chunk.mesh->VertexCount();
+            }
+        }
+        return static_cast<double>(bytes) / static_cast<double>(vertices);
+    }
+
+    /*
+     * Prints the cost of clearing and presenting an empty frame, then renders every scene with each shader and
+     * prints the average time per frame, pipelined and with the raster pass run inline (sequential).
+     * Each scene is then rendered again with quantized vertex attributes, reporting the time and the difference
+     * from the float frame (PSNR), and checkerboarded, reporting the time and the PSNR of a frame reconstructed
+     * after a small camera turn (with a still camera it converges to the full frame), and with the reprojection
+     * cache, reporting the time, then the share of reused fragments and the PSNR of a frame drawn from a fully
+     * shaded one after the same turn. Last, with variable-rate shading: the time and the PSNR of its frame.
+     * Run with "--bench".
+     */
+    void Application::Benchmark(int frames)
+    {
+        const std::pair<FragmentShader, const char*> shaders[] = {
+            {FLAT, "Flat"}, {GOURAUD, "Gouraud"}, {PHONG, "Phong"}};
+        const double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+
+        // Returns the average frame time in ms and leaves a freshly drawn frame in the render target. Each frame
+        // is presented, as in the main loop, so that pipelined frames overlap the present as they would there.
+        auto timeFrames = [&](FragmentShader shader, bool pipelined) {
+            renderer->SetPipelined(pipelined);
+            renderer->setShader(shader);
+            renderer->Render(); // Warm up
+            const Uint64 start = SDL_GetPerformanceCounter();
+            for (int i = 0; i < frames; ++i)
+            {
+                renderer->Render();
+                renderer->RenderBuffer();
+            }
+            renderer->Flush();
+            const double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / frequency / frames;
+            renderer->Render();
+            renderer->Flush();
+            return ms;
+        };
+
+        // Cost of a frame with nothing in it: clearing it, handing it to SDL and presenting it
+        renderer->ClearRenderables();
+        const Uint64 presentStart = SDL_GetPerformanceCounter();
+        for (int i = 0; i < frames; ++i)
+        {
+            renderer->Render();
+            renderer->RenderBuffer();
+        }
+        const double presentMs = (SDL_GetPerformanceCounter() - presentStart) * 1000.0 / frequency / frames;
+        std::cout << "Empty frame (clear and present)\t" << presentMs << " ms" << std::endl;
+
+        std::cout << "Scene\tShader\tms/frame\tsequential ms/frame\tquantized ms/frame\tquantized PSNR (dB)"
+                  << "\tcheckerboard ms/frame\tcheckerboard PSNR (dB)"
+                  << "\tcached ms/frame\treuse (%)\tcached PSNR (dB)\tVRS ms/frame\tVRS PSNR (dB)" << std::endl;
+        for (int scene = 0; scene < static_cast<int>(scenes.size()); ++scene)
+        {
+            if (!scenes[scene]->WaitUntilLoaded())
+            {
+                std::cout << scene + 1 << "\tcould not be loaded: " << scenes[scene]->Error() << std::endl;
+                continue;
+            }
+            scenes[scene]->LoadScene();
+            const double floatBytes = bytesPerVertex(scenes[scene]->Data());
+            std::vector<std::pair<double, std::vector<unsigned char>>> reference;
+            std::vector<double> sequential;
+            std::vector<std::pair<double, double>> checkerboard;
+            std::vector<std::tuple<double, double, double>> cached;
+            std::vector<std::pair<double, double>> variableRate;
+            for (const auto& shader : shaders)
+            {
+                sequential.push_back(timeFrames(shader.first, false));
+                const double ms = timeFrames(shader.first, true);
+                reference.emplace_back(ms, renderer->ReadFrame());
+
+                renderer->SetCheckerboard(true);
+                const double checkerboardMs = timeFrames(shader.first, true);
+                renderer->camera.rotation.y += 0.02f;
+                renderer->Render();
+                renderer->camera.rotation.y -= 0.02f;
+                renderer->Render();
+                renderer->Flush();
+                checkerboard.emplace_back(checkerboardMs, psnr(reference.back().second, renderer->ReadFrame()));
+                renderer->SetCheckerboard(false);
+
+                renderer->SetReprojectionCache(REPROJECTION_REFRESH);
+                const double cachedMs = timeFrames(shader.first, true);
+                // Turned until a frame is shaded in full, so the next one reuses it
+                renderer->SetPipelined(false);
+                renderer->camera.rotation.y += 0.02f;
+                for (int i = 0; i < REPROJECTION_REFRESH; ++i)
+                {
+                    renderer->Render();
+                    if (renderer->ReuseRate() == 0) break;
+                }
+                renderer->camera.rotation.y -= 0.02f;
+                renderer->Render();
+                cached.emplace_back(
+                    cachedMs, renderer->ReuseRate() * 100, psnr(reference.back().second, renderer->ReadFrame()));
+                renderer->SetReprojectionCache(0);
+
+                renderer->SetVariableRateShading(true);
+                const double variableRateMs = timeFrames(shader.first, true);
+                variableRate.emplace_back(variableRateMs, psnr(reference.back().second, renderer->ReadFrame()));
+                renderer->SetVariableRateShading(false);
+            }
+
+            scenes[scene]->QuantizeMeshes();
+            scenes[scene]->LoadScene();
+            const double quantizedBytes = bytesPerVertex(scenes[scene]->Data());
+            for (size_t i = 0; i < std::size(shaders); ++i)
+            {
+                const double ms = timeFrames(shaders[i].first, true);
+                const double quality = psnr(reference[i].second, renderer->ReadFrame());
+                std::cout << scene + 1 << "\t" << shaders[i].second << "\t" << reference[i].first << "\t"
+                          << sequential[i] << "\t" << ms << "\t" << quality << "\t" << checkerboard[i].first
+                          << "\t" << checkerboard[i].second << "\t" << std::get<0>(cached[i]) << "\t"
+                          << std::get<1>(cached[i]) << "\t" << std::get<2>(cached[i]) << "\t"
+                          << variableRate[i].first << "\t" << variableRate[i].second << std::endl;
+            }
+            std::cout << scene + 1 << "\tbytes/vertex\t" << floatBytes << "\t\t" << quantizedBytes << std::endl;
+        }
+        cleanup();
+    }
+
+    void Application::SetPipelined(bool enabled)
+    {
+        renderer->SetPipelined(enabled);
+    }
+
+    void Application::SetFixedResolution()
+    {
+        targetFrameMs = 0;
+    }
+
     void Application::Run()
     {
+        renderer->SetDynamicResolution(targetFrameMs);
+        cameraInput = std::make_unique<CameraInput>(renderer->camera);
+        renderer->SetCameraInput(cameraInput.get());
         while (loop)
         {
             update();
-            draw();
+            if (renderer->NeedsRender())
+                draw();
+            else if (repaint || gui->NeedsRebuild())
+                redraw();
+            else
+                SDL_WaitEventTimeout(nullptr, IDLE_WAIT_MS);
         }
         cleanup();
     }
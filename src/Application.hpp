@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "AssetRegistry.hpp"
+#include "CameraInput.hpp"
 #include "EventManager.hpp"
 #include "GUI.hpp"
 #include "Renderer.hpp"
@@ -17,27 +19,43 @@ namespace soft3d
     {
         std::unique_ptr<GUI> gui;
         std::unique_ptr<Renderer> renderer;
+        std::unique_ptr<CameraInput> cameraInput; // Moves the renderer's camera while Run is running
+        AssetRegistry assets; // Before 'scenes': their loader threads use it
         std::vector<std::unique_ptr<soft3d::Scene>> scenes;
         std::unique_ptr<EventManager> eventManager;
         SDL_Window* sdlWindow{};
         SDL_Renderer* sdlRenderer{};
         FPSCounter fpsCounter{};
-        Clock clock{};
         SDL_bool loop = SDL_FALSE;
         SDL_Event event{};
         bool menuMouseEnabled{};
+        int requestedScene = -1; // Shown as soon as it has loaded
+        // Frame time the render resolution is scaled to hold (see Renderer::SetDynamicResolution), 0 for none
+        double targetFrameMs = 1000.0 / 60;
+        // Frames between full refreshes of the reprojection cache, when it is turned on
+        static constexpr int REPROJECTION_REFRESH = 8;
+        // While nothing changes, the last frame is kept and the loop sleeps until there is input, waking up this
+        // often (ms) for scenes loading in the background
+        static constexpr Uint32 IDLE_WAIT_MS = 50;
+        bool repaint = true; // The window needs presenting again even if nothing in it has changed
         void changeScene(int newScene);
+        void updateSceneLoading();
         void quit();
         void init();
         void initGui();
         void initSDL();
         void draw();
+        void redraw();
         void update();
         void cleanup();
         void disableMouse();
 
       public:
         void Run();
+        void Benchmark(int frames = 60);
+        void SetPipelined(bool enabled);
+        // Draws at the full resolution however long frames take
+        void SetFixedResolution();
         Application();
     };
 } // namespace soft3d
\ No newline at end of file
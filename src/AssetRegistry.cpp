@@ -0,0 +1,134 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "AssetRegistry.hpp"
+#include "MappedFile.hpp"
+#include "MeshCache.hpp"
+
+namespace soft3d
+{
+    namespace
+    {
+        // Returns the live asset stored under 'key', or stores 'asset' there if there is none.
+        template <typename Map, typename Key, typename T>
+        std::shared_ptr<const T> share(Map& map, const Key& key, std::shared_ptr<const T> asset)
+        {
+            auto& entry = map[key];
+            if (auto existing = entry.lock()) return existing;
+            entry = asset;
+            return asset;
+        }
+
+        template <typename Map>
+        size_t liveCount(Map& map)
+        {
+            std::erase_if(map, [](const auto& entry) { return entry.second.expired(); });
+            return map.size();
+        }
+    } // namespace
+
+    std::shared_ptr<const Mesh> AssetRegistry::LoadMesh(
+        const std::string& path, ObjParser::Options options, std::string& error)
+    {
+        const MeshKey key{
+            path,
+            options.compressTextures,
+            options.loadTextures,
+            options.atlasTileSize,
+            options.virtualTextures,
+            options.lodLevels};
+        {
+            std::lock_guard lock(mutex);
+            if (auto mesh = meshes[key].lock())
+            {
+                if (options.progress) options.progress->store(1, std::memory_order_relaxed);
+                return mesh;
+            }
+        }
+
+        uint64_t hash;
+        {
+            const MappedFile file(path.c_str());
+            if (!file.IsOpen())
+            {
+                error = "could not open " + path;
+                return nullptr;
+            }
+            hash = HashBytes(file.Data(), file.Size());
+        }
+        const ContentKey contentKey{
+            hash,
+            options.compressTextures,
+            options.loadTextures,
+            options.atlasTileSize,
+            options.virtualTextures,
+            options.lodLevels};
+        {
+            std::lock_guard lock(mutex);
+            if (auto mesh = meshContents[contentKey].lock())
+            {
+                meshes[key] = mesh;
+                if (options.progress) options.progress->store(1, std::memory_order_relaxed);
+                return mesh;
+            }
+        }
+
+        options.assets = this;
+        auto parsed = ObjParser::ParseObj(path.c_str(), options, error);
+        if (!parsed) return nullptr;
+        auto mesh = std::make_shared<const Mesh>(std::move(*parsed));
+
+        std::lock_guard lock(mutex);
+        mesh = share(meshContents, contentKey, std::move(mesh));
+        meshes[key] = mesh;
+        return mesh;
+    }
+
+    std::vector<LoadedTexture> AssetRegistry::LoadTextures(
+        const std::vector<TextureRequest>& requests, bool writeCache)
+    {
+        std::vector<LoadedTexture> loaded(requests.size());
+        std::vector<TextureRequest> missing;
+        std::vector<size_t> missingIndices;
+        {
+            std::lock_guard lock(mutex);
+            for (size_t i = 0; i < requests.size(); ++i)
+            {
+                loaded[i].texture = textures[{requests[i].path, requests[i].format}].lock();
+                if (loaded[i].texture) continue;
+                missing.push_back(requests[i]);
+                missingIndices.push_back(i);
+            }
+        }
+        if (missing.empty()) return loaded;
+
+        auto decoded = soft3d::LoadTextures(missing, writeCache);
+        std::lock_guard lock(mutex);
+        for (size_t i = 0; i < missing.size(); ++i)
+        {
+            auto& result = decoded[i];
+            if (result.texture)
+            {
+                // Another file (or thread) may already have the same image in memory
+                const int format = missing[i].format;
+                result.texture = share(textureContents, TextureContentKey{result.hash, format}, result.texture);
+                textures[{missing[i].path, format}] = result.texture;
+            }
+            loaded[missingIndices[i]] = std::move(result);
+        }
+        return loaded;
+    }
+
+    size_t AssetRegistry::MeshCount()
+    {
+        std::lock_guard lock(mutex);
+        return liveCount(meshContents);
+    }
+
+    size_t AssetRegistry::TextureCount()
+    {
+        std::lock_guard lock(mutex);
+        return liveCount(textureContents);
+    }
+} // namespace soft3d
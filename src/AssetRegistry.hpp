@@ -0,0 +1,67 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include "Mesh.hpp"
+#include "ObjParser.hpp"
+#include "slib.hpp"
+#include "TextureLoader.hpp"
+#include "VirtualTexture.hpp"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace soft3d
+{
+    /*
+     * Hands out shared, immutable meshes and textures. An asset is keyed by its path (and load options) and by
+     * a hash of its contents, so a model or image that is already in use is returned again instead of being
+     * loaded a second time, even under another name.
+     * The registry only holds weak references: an asset is freed once nothing uses it, and loaded again when
+     * next asked for. Safe to use from several loader threads; two threads asking for the same new asset at
+     * once may both load it, but they end up sharing the first copy that was registered.
+     */
+    class AssetRegistry
+    {
+        // Path, then the options that change the loaded mesh (compressTextures, loadTextures, atlasTileSize,
+        // virtualTextures, lodLevels)
+        using MeshKey = std::tuple<std::string, bool, bool, int, bool, int>;
+        using ContentKey = std::tuple<uint64_t, bool, bool, int, bool, int>;
+        using TextureKey = std::pair<std::string, int>;
+        using TextureContentKey = std::pair<uint64_t, int>;
+
+        std::mutex mutex;
+        std::map<MeshKey, std::weak_ptr<const Mesh>> meshes;
+        std::map<ContentKey, std::weak_ptr<const Mesh>> meshContents;
+        std::map<TextureKey, std::weak_ptr<const slib::texture>> textures;
+        std::map<TextureContentKey, std::weak_ptr<const slib::texture>> textureContents;
+        VirtualTexturePool virtualTextures;
+
+      public:
+        // Parses the obj file (ObjParser::ParseObj) unless the same model, loaded with the same options, is in
+        // use. Its textures are shared through the registry too. nullptr (and 'error') if the file cannot be
+        // opened or parsed.
+        std::shared_ptr<const Mesh> LoadMesh(
+            const std::string& path, ObjParser::Options options, std::string& error);
+
+        // LoadTextures (TextureLoader.hpp) that reuses textures which are still in use.
+        std::vector<LoadedTexture> LoadTextures(const std::vector<TextureRequest>& requests, bool writeCache);
+
+        // The page cache behind every virtual texture the registry's meshes use (ObjParser::Options).
+        VirtualTexturePool& VirtualTextures()
+        {
+            return virtualTextures;
+        }
+
+        // Number of meshes/textures currently in use.
+        [[nodiscard]] size_t MeshCount();
+        [[nodiscard]] size_t TextureCount();
+    };
+} // namespace soft3d
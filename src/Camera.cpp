@@ -6,35 +6,33 @@
 namespace soft3d
 {
 
-    void Camera::Update(float deltaTime)
+    void Camera::Update(float deltaTime, uint8_t moveKeys)
     {
         const float speed = 0.05f; // Adjust this value as needed
         const float adjustedSpeed = speed * deltaTime;
     
-        const Uint8 *keyState = SDL_GetKeyboardState(NULL);
-        if (keyState[SDL_SCANCODE_W]) {
+        if (moveKeys & MOVE_FORWARD) {
             pos -= forward * adjustedSpeed;
         }
-        if (keyState[SDL_SCANCODE_S]) {
+        if (moveKeys & MOVE_BACK) {
             pos += forward * adjustedSpeed;
         }
-        if (keyState[SDL_SCANCODE_A]) {
+        if (moveKeys & MOVE_LEFT) {
             pos -= right * adjustedSpeed;
         }
-        if (keyState[SDL_SCANCODE_D]) {
+        if (moveKeys & MOVE_RIGHT) {
             pos += right * adjustedSpeed;
         }
     }
     
-    void Camera::HandleEvent(SDL_Event *event)
+    uint8_t Camera::MoveKeys(const Uint8* keyState)
     {
-        if (event->type == SDL_MOUSEMOTION) {
-            rotate(event->motion.xrel, event->motion.yrel);
-        }
+        return static_cast<uint8_t>(
+            (keyState[SDL_SCANCODE_W] ? MOVE_FORWARD : 0) | (keyState[SDL_SCANCODE_S] ? MOVE_BACK : 0) |
+            (keyState[SDL_SCANCODE_A] ? MOVE_LEFT : 0) | (keyState[SDL_SCANCODE_D] ? MOVE_RIGHT : 0));
     }
 
-    
-    void Camera::rotate(float x, float y)
+    void Camera::Rotate(float x, float y)
     {
         const float sensitivity = 0.075f;
         rotation.y -= x * sensitivity;
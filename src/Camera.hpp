@@ -5,11 +5,20 @@
 #pragma once
 #include <SDL2/SDL.h>
 #include "slib.hpp"
+#include <cstdint>
 
 namespace soft3d
 {
     struct Camera
     {
+        // Movement keys held, as bits of the mask Update takes
+        enum MoveKey : uint8_t
+        {
+            MOVE_FORWARD = 1,
+            MOVE_BACK = 2,
+            MOVE_LEFT = 4,
+            MOVE_RIGHT = 8
+        };
         slib::vec3 pos;
         slib::vec3 rotation;
         slib::vec3 direction;
@@ -22,11 +31,13 @@ namespace soft3d
             :
             pos(_pos), rotation(_rotation), direction(_direction), up(_up), zFar(_zFar), zNear(_zNear)
         {};
-        void Update(float deltaTime);
-        void HandleEvent(SDL_Event *event);
+        // Moves along the direction vectors for 'deltaTime' ms with the 'moveKeys' held.
+        void Update(float deltaTime, uint8_t moveKeys);
+        // Turns by a mouse motion of (x, y) pixels.
+        void Rotate(float x, float y);
         void UpdateDirectionVectors(const slib::mat& viewMatrix);
-    private:
-        void rotate(float x, float y);
+        // The MoveKey bits of the keys held in SDL's keyboard state.
+        static uint8_t MoveKeys(const Uint8* keyState);
     };
 }
 
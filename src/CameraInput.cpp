@@ -0,0 +1,154 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "CameraInput.hpp"
+#include "smath.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace soft3d
+{
+    CameraInput::CameraInput(const Camera& camera)
+    {
+        latest.pos = camera.pos;
+        latest.rotation = camera.rotation;
+        input.placedPos = sent.placedPos = camera.pos;
+        input.placedRotation = sent.placedRotation = camera.rotation;
+        thread = std::thread(&CameraInput::run, this, camera);
+    }
+
+    void CameraInput::HandleEvent(const SDL_Event& event)
+    {
+        if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && !event.key.repeat)
+        {
+            keyTime = event.key.timestamp;
+            return;
+        }
+        if (event.type != SDL_MOUSEMOTION) return;
+        sent.mouseX += event.motion.xrel;
+        sent.mouseY += event.motion.yrel;
+        sent.inputTime = event.motion.timestamp;
+        send();
+    }
+
+    void CameraInput::SetMoveKeys(uint8_t keys)
+    {
+        if (keys == sent.moveKeys) return;
+        sent.moveKeys = keys;
+        sent.inputTime = keyTime != 0 ? keyTime : SDL_GetTicks(); // No key event seen: from now
+        send();
+    }
+
+    void CameraInput::Place(const Camera& camera)
+    {
+        ++sent.placement;
+        sent.placedPos = camera.pos;
+        sent.placedRotation = camera.rotation;
+        sent.placedMouseX = sent.mouseX;
+        sent.placedMouseY = sent.mouseY;
+        // Snapshots from before the placement are ignored from now on (see Apply)
+        latest = {camera.pos, camera.rotation, sent.mouseX, sent.mouseY, latest.inputTime, sent.placement};
+        send();
+    }
+
+    void CameraInput::send()
+    {
+        {
+            std::lock_guard lock(mutex);
+            input = sent;
+        }
+        wake.notify_one();
+    }
+
+    bool CameraInput::Pending() const
+    {
+        // While a key is held the thread writes a snapshot every step without waking the main thread, which
+        // must then not sleep waiting for events between two of them
+        return sent.moveKeys != 0 || snapshots.Fresh() || sent.mouseX != appliedMouseX ||
+               sent.mouseY != appliedMouseY;
+    }
+
+    Uint32 CameraInput::Apply(Camera& camera)
+    {
+        CameraSnapshot snapshot;
+        if (snapshots.Read(snapshot) && snapshot.placement == sent.placement) latest = snapshot;
+        camera.pos = latest.pos;
+        camera.rotation = latest.rotation;
+        // Motion the thread has not stepped yet
+        camera.Rotate(
+            static_cast<float>(sent.mouseX - latest.mouseX), static_cast<float>(sent.mouseY - latest.mouseY));
+        appliedMouseX = sent.mouseX;
+        appliedMouseY = sent.mouseY;
+
+        const bool unstepped = sent.mouseX != latest.mouseX || sent.mouseY != latest.mouseY;
+        const Uint32 inputTime = unstepped ? sent.inputTime : latest.inputTime;
+        if (inputTime <= appliedInputTime) return 0;
+        appliedInputTime = inputTime;
+        return inputTime;
+    }
+
+    void CameraInput::run(Camera camera)
+    {
+        using clock = std::chrono::steady_clock;
+        constexpr auto step = std::chrono::nanoseconds(1000000000 / STEPS_PER_SECOND);
+        constexpr float stepMs = 1000.0f / STEPS_PER_SECOND;
+        uint32_t placement = 0;
+        int64_t mouseX = 0, mouseY = 0;
+        auto next = clock::now();
+
+        std::unique_lock lock(mutex);
+        while (true)
+        {
+            const auto idle = [&] {
+                return input.moveKeys == 0 && input.mouseX == mouseX && input.mouseY == mouseY &&
+                       input.placement == placement;
+            };
+            if (idle())
+            {
+                wake.wait(lock, [&] { return stopping || !idle(); });
+                next = clock::now();
+            }
+            else
+            {
+                wake.wait_until(lock, next, [this] { return stopping; });
+            }
+            if (stopping) return;
+            // Keep to the fixed rate, but do not try to catch up after a stall
+            next = std::max(next + step, clock::now() - step);
+            const Input current = input;
+            lock.unlock();
+
+            if (current.placement != placement)
+            {
+                placement = current.placement;
+                camera.pos = current.placedPos;
+                camera.rotation = current.placedRotation;
+                mouseX = current.placedMouseX;
+                mouseY = current.placedMouseY;
+            }
+            camera.Rotate(
+                static_cast<float>(current.mouseX - mouseX), static_cast<float>(current.mouseY - mouseY));
+            mouseX = current.mouseX;
+            mouseY = current.mouseY;
+            if (current.moveKeys != 0)
+            {
+                camera.UpdateDirectionVectors(smath::fpsview(camera.pos, camera.rotation.x, camera.rotation.y));
+                camera.Update(stepMs, current.moveKeys);
+            }
+            snapshots.Write({camera.pos, camera.rotation, mouseX, mouseY, current.inputTime, placement});
+
+            lock.lock();
+        }
+    }
+
+    CameraInput::~CameraInput()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (thread.joinable()) thread.join();
+    }
+} // namespace soft3d
@@ -0,0 +1,93 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include "Camera.hpp"
+#include "TripleBuffer.hpp"
+#include "slib.hpp"
+#include <SDL2/SDL.h>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace soft3d
+{
+    // The camera as the input thread left it after a step
+    struct CameraSnapshot
+    {
+        slib::vec3 pos{};
+        slib::vec3 rotation{};
+        int64_t mouseX = 0, mouseY = 0; // Mouse motion stepped so far (running totals, in pixels)
+        Uint32 inputTime = 0;           // SDL timestamp (ms) of the latest input event stepped
+        uint32_t placement = 0;         // Number of the last Place stepped from
+    };
+
+    /*
+     * Moves the camera on a thread of its own, in fixed steps of 1/STEPS_PER_SECOND s whatever the frame rate,
+     * and hands every new position to the renderer through a TripleBuffer, which it picks up just before the
+     * geometry pass (Apply). SDL only reads input on the main thread, so the application passes the mouse motion
+     * and movement keys in; the thread sleeps while no key is held and no motion is waiting.
+     *
+     * Apply also turns the camera by the mouse motion the thread has not stepped yet, so mouse look is never a
+     * step behind the last events read.
+     *
+     * Each input carries the timestamp SDL gave its event, so the latency measured from it (see
+     * Renderer::SetCameraInput) includes the time the event waited in SDL's queue, not just from the poll.
+     */
+    class CameraInput
+    {
+      public:
+        static constexpr int STEPS_PER_SECOND = 500;
+
+        explicit CameraInput(const Camera& camera);
+        ~CameraInput();
+
+        // The rest is for the main thread only.
+        // Takes mouse motion, and the times of key presses and releases for SetMoveKeys.
+        void HandleEvent(const SDL_Event& event);
+        // Movement keys held, as Camera::MoveKeys. A change is timed by the last key event handled.
+        void SetMoveKeys(uint8_t keys);
+        // Moves the camera to where 'camera' is, e.g. when a scene has placed it. Motion before this is dropped.
+        void Place(const Camera& camera);
+        // Whether Apply would move the camera, or will soon (a movement key is held).
+        [[nodiscard]] bool Pending() const;
+        /*
+         * Gives the camera the latest position and rotation. Returns the timestamp of the latest input event in
+         * them (SDL_GetTicks time), or 0 if an earlier Apply had it already.
+         */
+        Uint32 Apply(Camera& camera);
+
+      private:
+        // What the main thread passes to the input thread
+        struct Input
+        {
+            int64_t mouseX = 0, mouseY = 0; // Running totals
+            uint8_t moveKeys = 0;
+            Uint32 inputTime = 0;
+            uint32_t placement = 0;
+            slib::vec3 placedPos{}, placedRotation{};
+            int64_t placedMouseX = 0, placedMouseY = 0; // Motion before the placement, not to be stepped
+        };
+
+        TripleBuffer<CameraSnapshot> snapshots;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::thread thread;
+        bool stopping = false;
+        Input input; // Guarded by 'mutex'
+
+        // Main thread
+        Input sent;              // The last Input passed on
+        CameraSnapshot latest;   // The last snapshot taken
+        int64_t appliedMouseX = 0, appliedMouseY = 0;
+        Uint32 appliedInputTime = 0;
+        Uint32 keyTime = 0; // Timestamp of the last key pressed or released
+
+        void send();
+        void run(Camera camera);
+    };
+} // namespace soft3d
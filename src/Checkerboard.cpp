@@ -0,0 +1,103 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "Checkerboard.hpp"
+#include "JobSystem.hpp"
+
+namespace soft3d
+{
+    namespace
+    {
+        // Weighted average of a few pixels (BGRA, as bufferPixels writes them), per channel.
+        struct Blend
+        {
+            uint32_t b = 0, g = 0, r = 0, weight = 0;
+
+            void add(uint32_t colour, uint32_t w)
+            {
+                b += (colour & 0xFF) * w;
+                g += (colour >> 8 & 0xFF) * w;
+                r += (colour >> 16 & 0xFF) * w;
+                weight += w;
+            }
+
+            [[nodiscard]] uint32_t colour() const
+            {
+                const uint32_t half = weight / 2; // Round to nearest
+                return 0xFF000000 | (r + half) / weight << 16 | (g + half) / weight << 8 | (b + half) / weight;
+            }
+        };
+    } // namespace
+
+    void Checkerboard::Resolve(SDL_Surface* surface, ZBuffer& zBuffer, FrameHistory& history)
+    {
+        const int width = surface->w;
+        const int height = surface->h;
+        auto* pixels = static_cast<unsigned char*>(surface->pixels);
+        const int pitch = surface->pitch;
+        float* depths = zBuffer.buffer.data();
+        const int depthPitch = zBuffer.width;
+        const bool hasHistory = history.Valid();
+
+        JobSystem::Get().ParallelForRange(0, height, [&](int first, int last) {
+            for (int y = first; y < last; ++y)
+            {
+                auto* row = reinterpret_cast<uint32_t*>(pixels + y * pitch);
+                float* depthRow = depths + y * depthPitch;
+                // The nearest shaded pixels of a missing one are in the neighbouring blocks: one pixel away on
+                // the side of the block it is on, two on the other. Only those are read from other rows, and only
+                // missing pixels are written, so rows can be resolved in any order.
+                const int nearY = y & 1 ? y + 1 : y - 1;
+                const int farY = y & 1 ? y - 2 : y + 2;
+                for (int x = 0; x < width; ++x)
+                {
+                    if (Shaded(x, y, parity)) continue;
+                    const int nearX = x & 1 ? x + 1 : x - 1;
+                    const int farX = x & 1 ? x - 2 : x + 2;
+                    const int neighbours[4][3] = {{nearX, y, 2}, {x, nearY, 2}, {farX, y, 1}, {x, farY, 1}};
+                    // The pixel is assumed to be on one of the surfaces seen by its shaded neighbours, or on the
+                    // background if the previous frame saw it there
+                    float candidates[4]; // Nearest first
+                    int count = 0;
+                    bool nearBackground = true;
+                    for (const auto& n : neighbours)
+                    {
+                        if (n[0] < 0 || n[0] >= width || n[1] < 0 || n[1] >= height) continue;
+                        const float d = depths[n[1] * depthPitch + n[0]];
+                        if (d == 0) continue;
+                        if (n[2] == 2) nearBackground = false;
+                        int i = count++;
+                        for (; i > 0 && candidates[i - 1] > d; --i)
+                            candidates[i] = candidates[i - 1];
+                        candidates[i] = d;
+                    }
+                    // Without a previous frame, a pixel between two background ones is taken as background
+                    bool resolved = count == 0 || (!hasHistory && nearBackground);
+                    for (int i = 0; i < count && !resolved; ++i)
+                    {
+                        resolved = history.Lookup(x, y, candidates[i], row[x]);
+                        if (resolved) depthRow[x] = candidates[i];
+                    }
+                    // Left as cleared
+                    if (!resolved) resolved = history.WasBackground(x, y, candidates[count - 1]);
+                    if (!resolved)
+                    {
+                        // Interpolated from the neighbours that are not background, so silhouettes do not darken
+                        Blend blend;
+                        for (const auto& n : neighbours)
+                        {
+                            if (n[0] < 0 || n[0] >= width || n[1] < 0 || n[1] >= height) continue;
+                            if (depths[n[1] * depthPitch + n[0]] == 0) continue;
+                            blend.add(reinterpret_cast<const uint32_t*>(pixels + n[1] * pitch)[n[0]], n[2]);
+                        }
+                        row[x] = blend.colour();
+                        depthRow[x] = candidates[0];
+                    }
+                }
+                history.StoreRow(y, row, depthRow);
+            }
+        });
+        parity ^= 1;
+    }
+} // namespace soft3d
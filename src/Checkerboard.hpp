@@ -0,0 +1,45 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include "FrameHistory.hpp"
+#include "ZBuffer.hpp"
+#include <SDL2/SDL.h>
+
+namespace soft3d
+{
+    /*
+     * Checkerboard rendering: each frame only shades the 2x2 pixel blocks of one colour of a checker pattern,
+     * alternating between frames, and Resolve fills in the other half. A missing pixel takes the depth of one of
+     * its shaded neighbours, is reprojected into the previous frame (FrameHistory), and reuses the colour there
+     * if the previous frame saw the same surface. Otherwise, or with no previous frame, it is interpolated from
+     * the shaded pixels around it. With a still camera every pixel is fully shaded every other frame, so the
+     * image converges to the full resolution one.
+     */
+    class Checkerboard
+    {
+      public:
+        // Whether pixel (x, y) is shaded in a frame of the given parity.
+        static bool Shaded(int x, int y, int parity)
+        {
+            return (((x >> 1) + (y >> 1)) & 1) == parity;
+        }
+        // Parity of the frame being drawn.
+        [[nodiscard]] int Parity() const
+        {
+            return parity;
+        }
+
+        /*
+         * Fills the pixels of 'surface' that the frame did not shade, from the shaded ones (their depths are in
+         * 'zBuffer', which gets the filled pixels' too) and the previous frame in 'history', begun for this frame.
+         * Every row is stored in 'history' once final; it is up to the caller to commit it. The parity flips.
+         */
+        void Resolve(SDL_Surface* surface, ZBuffer& zBuffer, FrameHistory& history);
+
+      private:
+        int parity = 0;
+    };
+} // namespace soft3d
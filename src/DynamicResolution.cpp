@@ -0,0 +1,36 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "DynamicResolution.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace soft3d
+{
+    DynamicResolution::DynamicResolution(double _targetMs, float _minScale, float _maxScale)
+        : targetMs(_targetMs), minScale(_minScale), maxScale(std::max(_minScale, _maxScale)), scale(maxScale)
+    {
+    }
+
+    float DynamicResolution::Update(double frameMs)
+    {
+        // Exponential average over roughly the last 4 frames, restarted after a change
+        averageMs = framesSinceChange == 0 ? frameMs : averageMs + (frameMs - averageMs) * 0.25;
+        if (++framesSinceChange < SETTLE_FRAMES) return scale;
+
+        // Only part of the frame scales with the pixel count, so the estimate undershoots and is repeated
+        const bool overBudget = averageMs > targetMs * 1.05;
+        const bool underBudget = averageMs < targetMs * 0.8;
+        if (!overBudget && !underBudget) return scale;
+        float next = scale * static_cast<float>(std::sqrt(targetMs / averageMs));
+        next = overBudget ? std::floor(next / STEP) * STEP : std::ceil(next / STEP) * STEP;
+        next = std::clamp(next, minScale, maxScale);
+        if (next != scale)
+        {
+            scale = next;
+            framesSinceChange = 0;
+        }
+        return scale;
+    }
+} // namespace soft3d
@@ -0,0 +1,37 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+namespace soft3d
+{
+    /*
+     * Picks the render resolution scale (applied to both axes) that holds a target frame time. The raster cost
+     * grows with the pixel count, so the scale moves by the square root of target / average frame time, in
+     * steps of STEP so it does not change every frame. It drops as soon as frames run over the target but only
+     * rises once they are well under it, and waits a few frames after each change for the average to catch up.
+     */
+    class DynamicResolution
+    {
+      public:
+        static constexpr float STEP = 1.0f / 16;
+        static constexpr int SETTLE_FRAMES = 8;
+
+        DynamicResolution(double _targetMs, float _minScale, float _maxScale);
+
+        // Feeds the duration of the last frame and returns the scale to draw the next one at.
+        float Update(double frameMs);
+        [[nodiscard]] float Scale() const
+        {
+            return scale;
+        }
+
+      private:
+        double targetMs;
+        float minScale, maxScale;
+        float scale;
+        double averageMs = 0;
+        int framesSinceChange = 0;
+    };
+} // namespace soft3d
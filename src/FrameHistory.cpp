@@ -0,0 +1,48 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "FrameHistory.hpp"
+
+namespace soft3d
+{
+    void FrameHistory::Begin(int _width, int _height, const smath::mat4& _viewProjection)
+    {
+        if (_width != width || _height != height)
+        {
+            width = _width;
+            height = _height;
+            const size_t size = static_cast<size_t>(width) * height;
+            colours.assign(size, 0);
+            nextColours.assign(size, 0);
+            depths.assign(size, 0);
+            nextDepths.assign(size, 0);
+            valid = false;
+        }
+        halfWidth = static_cast<float>(width) / 2;
+        halfHeight = static_cast<float>(height) / 2;
+        unproject = smath::inverse(_viewProjection);
+        reproject = smath::multiply(viewProjection, unproject);
+        viewProjection = _viewProjection;
+    }
+
+    void FrameHistory::StoreRow(int y, const uint32_t* rowColours, const float* rowDepths)
+    {
+        const float ndcY = (halfHeight - static_cast<float>(y)) / halfHeight;
+        const size_t start = static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x)
+        {
+            const float z = rowDepths[x];
+            const float ndcX = (static_cast<float>(x) - halfWidth) / halfWidth;
+            nextColours[start + x] = rowColours[x];
+            nextDepths[start + x] = z == 0 ? 0 : 1 / transformRow(unproject, 3, ndcX, ndcY, z);
+        }
+    }
+
+    void FrameHistory::Commit()
+    {
+        colours.swap(nextColours);
+        depths.swap(nextDepths);
+        valid = true;
+    }
+} // namespace soft3d
@@ -0,0 +1,94 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include "smath.hpp"
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace soft3d
+{
+    /*
+     * The colour and view depth of every pixel of the previous frame, and the matrix it was drawn with, so a
+     * point of the frame being drawn can be looked up where the previous frame saw it (reprojection). Used to
+     * reuse shading between frames (Renderer::SetReprojectionCache) and to fill in checkerboarded frames.
+     *
+     * Per frame: Begin before the frame is drawn (lookups then go from it to the previous frame), StoreRow for
+     * every row once it is final, then Commit to make it the previous frame. Lookups and StoreRow may run on
+     * several threads at once.
+     */
+    class FrameHistory
+    {
+      public:
+        // How far (relative) a reprojected depth may be from the previous frame's to count as the same surface
+        static constexpr float DEPTH_TOLERANCE = 0.03f;
+
+        void Begin(int _width, int _height, const smath::mat4& viewProjection);
+        // Colours (BGRA) and depths (NDC z, as in the z-buffer, 0 for background) of row 'y' of the frame.
+        void StoreRow(int y, const uint32_t* colours, const float* depths);
+        void Commit();
+        // Forgets the previous frame, e.g. when a frame is drawn without recording it.
+        void Invalidate()
+        {
+            valid = false;
+        }
+        [[nodiscard]] bool Valid() const
+        {
+            return valid;
+        }
+
+        /*
+         * Index of the previous frame's pixel nearest to where it saw the point at pixel (x, y), NDC depth z, of
+         * the frame begun, and the view depth the point had there. -1 if it was off screen.
+         */
+        long Reproject(int x, int y, float z, float& previousDepth) const
+        {
+            const float ndcX = (static_cast<float>(x) - halfWidth) / halfWidth;
+            const float ndcY = (halfHeight - static_cast<float>(y)) / halfHeight;
+            const float w = transformRow(reproject, 3, ndcX, ndcY, z);
+            if (w <= 0) return -1;
+            const long qx = std::lround(halfWidth + transformRow(reproject, 0, ndcX, ndcY, z) / w * halfWidth);
+            const long qy = std::lround(halfHeight - transformRow(reproject, 1, ndcX, ndcY, z) / w * halfHeight);
+            if (qx < 0 || qx >= width || qy < 0 || qy >= height) return -1;
+            previousDepth = w / transformRow(unproject, 3, ndcX, ndcY, z);
+            return qy * width + qx;
+        }
+        // The colour the previous frame had for the point, if it saw the same surface there.
+        bool Lookup(int x, int y, float z, uint32_t& colour) const
+        {
+            if (!valid) return false;
+            float depth;
+            const long q = Reproject(x, y, z, depth);
+            if (q < 0 || depths[q] == 0 || std::abs(depths[q] - depth) > DEPTH_TOLERANCE * depth) return false;
+            colour = colours[q];
+            return true;
+        }
+        // Whether the previous frame saw background where the point is.
+        [[nodiscard]] bool WasBackground(int x, int y, float z) const
+        {
+            float depth;
+            const long q = valid ? Reproject(x, y, z, depth) : -1;
+            return q >= 0 && depths[q] == 0;
+        }
+
+      private:
+        int width = 0, height = 0;
+        float halfWidth = 0, halfHeight = 0;
+        bool valid = false;
+        std::vector<uint32_t> colours, nextColours;
+        std::vector<float> depths, nextDepths; // View depth (clip w), 0 for background
+        smath::mat4 viewProjection{};
+        // Screen position and depth (NDC) of the frame begun to homogeneous world space, and on to the previous
+        // frame's clip space
+        smath::mat4 unproject{}, reproject{};
+
+        // Row 'row' of a row-major matrix times (x, y, z, 1).
+        static float transformRow(const smath::mat4& m, int row, float x, float y, float z)
+        {
+            return m[row * 4] * x + m[row * 4 + 1] * y + m[row * 4 + 2] * z + m[row * 4 + 3];
+        }
+    };
+} // namespace soft3d
@@ -4,6 +4,7 @@
 
 #include "GUI.hpp"
 #include "constants.hpp"
+#include <algorithm>
 #include <string>
 
 namespace soft3d
@@ -25,10 +26,68 @@ namespace soft3d
     }
     
     void GUI::Draw()
+    {
+        if (!resizeOverlay()) return;
+        if (NeedsRebuild()) rebuildOverlay();
+        SDL_RenderCopy(sdlRenderer, overlay, nullptr, nullptr);
+    }
+
+    // Matches the overlay to the window's size. False if there is nothing to draw to (e.g. minimised).
+    bool GUI::resizeOverlay()
+    {
+        int width = 0, height = 0;
+        SDL_GetRendererOutputSize(sdlRenderer, &width, &height);
+        if (width <= 0 || height <= 0) return false;
+        if (overlay && width == overlayWidth && height == overlayHeight) return true;
+        if (overlay) SDL_DestroyTexture(overlay);
+        overlay =
+            SDL_CreateTexture(sdlRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width, height);
+        if (!overlay) return false;
+        overlayWidth = width;
+        overlayHeight = height;
+        // ImGui blends into transparent black, which leaves colours premultiplied by alpha. Renderers without
+        // custom blend modes fall back to plain alpha blending: translucent parts then come out a little darker.
+        const SDL_BlendMode premultiplied = SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE,
+                                                                       SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                                                                       SDL_BLENDOPERATION_ADD,
+                                                                       SDL_BLENDFACTOR_ONE,
+                                                                       SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                                                                       SDL_BLENDOPERATION_ADD);
+        if (SDL_SetTextureBlendMode(overlay, premultiplied) != 0)
+            SDL_SetTextureBlendMode(overlay, SDL_BLENDMODE_BLEND);
+        Invalidate();
+        return true;
+    }
+
+    void GUI::rebuildOverlay()
     {
         ImGui_ImplSDLRenderer2_NewFrame();
         ImGui_ImplSDL2_NewFrame();
         ImGui::NewFrame();
+        buildMenuBar();
+        ImGui::Render();
+        drawnState = State();
+        // A menu takes another frame to close after a click, so keep rebuilding while a menu or item is open,
+        // then once more after
+        const bool busy = ImGui::IsPopupOpen(nullptr, ImGuiPopupFlags_AnyPopup) || ImGui::IsAnyItemActive();
+        rebuildFrames = busy ? std::max(rebuildFrames - 1, 1) : std::max(rebuildFrames - 1, 0);
+
+        SDL_SetRenderTarget(sdlRenderer, overlay);
+        SDL_SetRenderDrawColor(sdlRenderer, 0, 0, 0, 0);
+        SDL_RenderClear(sdlRenderer);
+        ImGuiIO& io = ImGui::GetIO();
+        SDL_RenderSetScale(sdlRenderer, io.DisplayFramebufferScale.x, io.DisplayFramebufferScale.y);
+        SDL_SetRenderDrawColor(sdlRenderer,
+                               (Uint8) (clear_color.x * 255),
+                               (Uint8) (clear_color.y * 255),
+                               (Uint8) (clear_color.z * 255),
+                               (Uint8) (clear_color.w * 255));
+        ImGui_ImplSDLRenderer2_RenderDrawData(ImGui::GetDrawData());
+        SDL_SetRenderTarget(sdlRenderer, nullptr);
+    }
+
+    void GUI::buildMenuBar()
+    {
         if(ImGui::BeginMainMenuBar())
         {
             if (ImGui::BeginMenu("Scenes"))
@@ -45,6 +104,14 @@ namespace soft3d
                 {
                     scene3ButtonDown->InvokeAllCallbacks();
                 }
+                if(ImGui::MenuItem("Scene 4"))
+                {
+                    scene4ButtonDown->InvokeAllCallbacks();
+                }
+                if(ImGui::MenuItem("Scene 5"))
+                {
+                    scene5ButtonDown->InvokeAllCallbacks();
+                }
                 ImGui::Separator();
                 if(ImGui::MenuItem("Quit"))
                 {
@@ -62,6 +129,10 @@ namespace soft3d
                 {
                     gouraudShaderButtonDown->InvokeAllCallbacks();
                 }
+                if(ImGui::MenuItem("Phong"))
+                {
+                    phongShaderButtonDown->InvokeAllCallbacks();
+                }
                 ImGui::EndMenu();
             }
             if (ImGui::BeginMenu("Filtering"))
@@ -76,27 +147,54 @@ namespace soft3d
                 }
                 ImGui::EndMenu();
             }
-            ImGui::SameLine(ImGui::GetWindowWidth() - 100);
+            if (ImGui::BeginMenu("Rendering"))
+            {
+                if(ImGui::MenuItem("Checkerboard", nullptr, checkerboard))
+                {
+                    checkerboardButtonDown->InvokeAllCallbacks();
+                }
+                if(ImGui::MenuItem("Reprojection cache", nullptr, reprojectionCache))
+                {
+                    reprojectionButtonDown->InvokeAllCallbacks();
+                }
+                if(ImGui::MenuItem("Variable rate shading", nullptr, variableRateShading))
+                {
+                    variableRateButtonDown->InvokeAllCallbacks();
+                }
+                ImGui::EndMenu();
+            }
+            if (loadingScene)
+            {
+                ImGui::Text("Loading scene %d", loadingScene);
+                ImGui::ProgressBar(loadingProgress, ImVec2(120, 0));
+            }
+            if (reprojectionCache)
+            {
+                ImGui::SameLine(ImGui::GetWindowWidth() - 410);
+                ImGui::Text("Reuse: %d%%", static_cast<int>(reuseRate * 100 + 0.5f));
+            }
+            if (inputLatency)
+            {
+                ImGui::SameLine(ImGui::GetWindowWidth() - 310);
+                ImGui::Text("Latency: %d ms", inputLatency);
+            }
+            ImGui::SameLine(ImGui::GetWindowWidth() - 190);
 
+            ImGui::Text("Res: %d%%", renderScale);
+            ImGui::SameLine(ImGui::GetWindowWidth() - 100);
             ImGui::Text("FPS: %s", std::to_string(fpsCounter).c_str());
 
             ImGui::EndMainMenuBar();
         }
-
-        ImGui::Render();
-        ImGuiIO& io = ImGui::GetIO();
-        SDL_RenderSetScale(sdlRenderer, io.DisplayFramebufferScale.x, io.DisplayFramebufferScale.y);
-        SDL_SetRenderDrawColor(sdlRenderer,
-                               (Uint8) (clear_color.x * 255),
-                               (Uint8) (clear_color.y * 255),
-                               (Uint8) (clear_color.z * 255),
-                               (Uint8) (clear_color.w * 255));
-        ImGui_ImplSDLRenderer2_RenderDrawData(ImGui::GetDrawData());
     }
     
     void GUI::Update(SDL_Event* event)
     {
         ImGui_ImplSDL2_ProcessEvent(event);
+        Invalidate();
+        // ImGui takes in at most one button or key change per frame (io.ConfigInputTrickleEventQueue), so each
+        // one queued needs a rebuild of its own. Mouse motion is taken in all at once.
+        if (event->type != SDL_MOUSEMOTION) ++rebuildFrames;
     }
     
     GUI::GUI(SDL_Window* _sdlWindow, SDL_Renderer* _sdlRenderer)
@@ -104,17 +202,24 @@ namespace soft3d
     scene1ButtonDown(std::make_unique<Event>()), 
     scene2ButtonDown(std::make_unique<Event>()), 
     scene3ButtonDown(std::make_unique<Event>()),
+    scene4ButtonDown(std::make_unique<Event>()),
+    scene5ButtonDown(std::make_unique<Event>()),
     quitButtonDown(std::make_unique<Event>()), 
     flatShaderButtonDown(std::make_unique<Event>()), 
     gouraudShaderButtonDown(std::make_unique<Event>()),
+    phongShaderButtonDown(std::make_unique<Event>()),
     bilinearButtonDown(std::make_unique<Event>()), 
-    neighbourButtonDown(std::make_unique<Event>())
+    neighbourButtonDown(std::make_unique<Event>()),
+    checkerboardButtonDown(std::make_unique<Event>()),
+    reprojectionButtonDown(std::make_unique<Event>()),
+    variableRateButtonDown(std::make_unique<Event>())
     {
         init();
     }
     
     GUI::~GUI()
     {
+        if (overlay) SDL_DestroyTexture(overlay);
         ImGui_ImplSDLRenderer2_Shutdown();
         ImGui_ImplSDL2_Shutdown();
         ImGui::DestroyContext();
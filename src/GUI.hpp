@@ -9,7 +9,9 @@
 #include "imgui/backends/imgui_impl_sdl2.h"
 #include "imgui/backends/imgui_impl_sdlrenderer2.h"
 #include "Event.hpp"
+#include <algorithm>
 #include <memory>
+#include <tuple>
 
 namespace soft3d
 {
@@ -19,20 +21,70 @@ namespace soft3d
         SDL_Window * sdlWindow;
         ImVec4 clear_color;
         void init();
+
+        // The menu bar is drawn into this texture only when it changes, and the texture is drawn over each frame
+        static constexpr int SETTLE_FRAMES = 2; // Rebuilds after input at least, more while ImGui is busy with it
+        using DisplayedState = std::tuple<int, int, bool, bool, int, bool, int, float, int>;
+        SDL_Texture* overlay = nullptr;
+        int overlayWidth = 0, overlayHeight = 0;
+        int rebuildFrames = SETTLE_FRAMES;
+        DisplayedState drawnState{};
+        bool resizeOverlay();
+        void rebuildOverlay();
+        void buildMenuBar();
     public:
         GUI(SDL_Window* _sdlWindow, SDL_Renderer* _sdlRenderer);
         ~GUI();
+        // Draws the menu bar over the frame, rebuilding it first if it has changed.
         void Draw();
         void Update(SDL_Event* event);
+        // Whether the menu bar looks different from the last one drawn.
+        [[nodiscard]] bool NeedsRebuild() const
+        {
+            return rebuildFrames > 0 || State() != drawnState;
+        }
+        // Rebuilds the menu bar next time, e.g. after the renderer has lost the overlay's contents.
+        void Invalidate()
+        {
+            rebuildFrames = std::max(rebuildFrames, SETTLE_FRAMES);
+        }
         std::unique_ptr<Event> scene1ButtonDown;
         std::unique_ptr<Event> scene2ButtonDown;
         std::unique_ptr<Event> scene3ButtonDown;
+        std::unique_ptr<Event> scene4ButtonDown;
+        std::unique_ptr<Event> scene5ButtonDown;
         std::unique_ptr<Event> quitButtonDown;
         std::unique_ptr<Event> flatShaderButtonDown;
         std::unique_ptr<Event> gouraudShaderButtonDown;
+        std::unique_ptr<Event> phongShaderButtonDown;
         std::unique_ptr<Event> bilinearButtonDown;
         std::unique_ptr<Event> neighbourButtonDown;
+        std::unique_ptr<Event> checkerboardButtonDown;
+        std::unique_ptr<Event> reprojectionButtonDown;
+        std::unique_ptr<Event> variableRateButtonDown;
         int fpsCounter = 0;
+        int renderScale = 100; // Render resolution, in percent of the window's
+        bool checkerboard = false; // Ticks the menu item
+        bool reprojectionCache = false; // Ticks the menu item
+        bool variableRateShading = false; // Ticks the menu item
+        float reuseRate = 0; // Of the reprojection cache, shown while it is on
+        int loadingScene = 0; // Number of the scene being loaded, 0 if none
+        float loadingProgress = 0;
+        int inputLatency = 0; // Input to present, ms, 0 until measured
+        // Everything above as Draw shows it, to tell when the menu bar has to be drawn again
+        [[nodiscard]] DisplayedState State() const
+        {
+            return {
+                fpsCounter,
+                renderScale,
+                checkerboard,
+                reprojectionCache,
+                static_cast<int>(reuseRate * 100 + 0.5f),
+                variableRateShading,
+                loadingScene,
+                loadingProgress,
+                inputLatency};
+        }
     };
 }
 
@@ -0,0 +1,282 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "JobSystem.hpp"
+#include <algorithm>
+
+namespace soft3d
+{
+    class JobSystem::Job
+    {
+      public:
+        std::function<void()> work;
+        const void* group = nullptr;
+        std::atomic<int> blockers = 1; // Unfinished dependencies, plus one until Run has registered them all
+        std::atomic<bool> done = false;
+        std::mutex mutex; // Guards 'finished' and 'dependents'
+        bool finished = false;
+        std::vector<JobHandle> dependents;
+    };
+
+    struct JobSystem::Range
+    {
+        const std::function<void(int, int)>& body;
+        int grain;
+        std::atomic<int> pending = 0; // Split-off parts not yet finished
+    };
+
+    namespace
+    {
+        thread_local const JobSystem* currentSystem = nullptr; // Set on worker threads
+        thread_local size_t currentQueue = 0;
+        thread_local const void* currentGroup = nullptr; // Group of the job running on this thread
+
+        // Outside threads are a group of their own until they run a job.
+        const void* threadGroup()
+        {
+            static thread_local char marker;
+            return currentGroup ? currentGroup : &marker;
+        }
+    } // namespace
+
+    JobSystem& JobSystem::Get()
+    {
+        static JobSystem system(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return system;
+    }
+
+    JobSystem::Queue& JobSystem::localQueue()
+    {
+        return currentSystem == this ? *queues[currentQueue] : *queues.back();
+    }
+
+    void JobSystem::push(JobHandle job)
+    {
+        if (workers.empty())
+        {
+            execute(job);
+            return;
+        }
+        {
+            Queue& queue = localQueue();
+            std::lock_guard lock(queue.mutex);
+            queue.jobs.push_back(std::move(job));
+        }
+        queued.fetch_add(1);
+        {
+            std::lock_guard lock(sleepMutex); // So a worker cannot miss the notify between its check and its wait
+        }
+        wake.notify_one();
+        signalProgress();
+    }
+
+    void JobSystem::signalProgress()
+    {
+        progress.fetch_add(1, std::memory_order_release);
+        progress.notify_all();
+    }
+
+    template <typename Ready>
+    void JobSystem::helpUntil(const Ready& ready)
+    {
+        const void* group = threadGroup();
+        int spins = 0;
+        while (!ready())
+        {
+            if (auto job = popGroup(group))
+            {
+                execute(job);
+                spins = 0;
+                continue;
+            }
+            if (++spins <= SPIN_COUNT)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            // Anything queued or finished after this read changes 'progress', so the wait cannot miss it
+            const uint32_t seen = progress.load(std::memory_order_acquire);
+            if (ready()) return;
+            if (auto job = popGroup(group))
+            {
+                execute(job);
+                spins = 0;
+                continue;
+            }
+            progress.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    JobSystem::JobHandle JobSystem::pop(size_t queue)
+    {
+        {
+            Queue& own = *queues[queue];
+            std::lock_guard lock(own.mutex);
+            if (!own.jobs.empty())
+            {
+                JobHandle job = std::move(own.jobs.back());
+                own.jobs.pop_back();
+                queued.fetch_sub(1);
+                return job;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); ++i)
+        {
+            Queue& victim = *queues[(queue + i) % queues.size()];
+            std::lock_guard lock(victim.mutex);
+            if (victim.jobs.empty()) continue;
+            JobHandle job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            queued.fetch_sub(1);
+            return job;
+        }
+        return nullptr;
+    }
+
+    JobSystem::JobHandle JobSystem::popGroup(const void* group)
+    {
+        if (queued.load() == 0) return nullptr;
+        for (auto& queue : queues)
+        {
+            std::lock_guard lock(queue->mutex);
+            const auto it = std::find_if(queue->jobs.rbegin(), queue->jobs.rend(), [group](const auto& job) {
+                return job->group == group;
+            });
+            if (it == queue->jobs.rend()) continue;
+            JobHandle job = std::move(*it);
+            queue->jobs.erase(std::next(it).base());
+            queued.fetch_sub(1);
+            return job;
+        }
+        return nullptr;
+    }
+
+    bool JobSystem::hasLocalWork()
+    {
+        Queue& queue = localQueue();
+        std::lock_guard lock(queue.mutex);
+        if (currentSystem == this) return !queue.jobs.empty();
+        // The shared queue also holds other outside threads' jobs
+        const void* group = threadGroup();
+        return std::any_of(queue.jobs.begin(), queue.jobs.end(), [group](const auto& job) {
+            return job->group == group;
+        });
+    }
+
+    void JobSystem::execute(const JobHandle& job)
+    {
+        const void* outerGroup = currentGroup;
+        currentGroup = job->group;
+        job->work();
+        currentGroup = outerGroup;
+
+        std::vector<JobHandle> dependents;
+        {
+            std::lock_guard lock(job->mutex);
+            job->finished = true;
+            dependents.swap(job->dependents);
+        }
+        job->done.store(true, std::memory_order_release);
+        for (auto& dependent : dependents)
+        {
+            if (dependent->blockers.fetch_sub(1) == 1) push(std::move(dependent));
+        }
+        signalProgress();
+    }
+
+    JobSystem::JobHandle JobSystem::Run(std::function<void()> work, std::initializer_list<JobHandle> dependencies)
+    {
+        auto job = std::make_shared<Job>();
+        job->work = std::move(work);
+        job->group = threadGroup();
+        for (const auto& dependency : dependencies)
+        {
+            if (!dependency) continue;
+            std::lock_guard lock(dependency->mutex);
+            if (dependency->finished) continue;
+            job->blockers.fetch_add(1);
+            dependency->dependents.push_back(job);
+        }
+        if (job->blockers.fetch_sub(1) == 1) push(job);
+        return job;
+    }
+
+    void JobSystem::Wait(const JobHandle& job)
+    {
+        helpUntil([&job] { return job->done.load(std::memory_order_acquire); });
+    }
+
+    void JobSystem::runRange(Range& range, int first, int last)
+    {
+        while (first < last)
+        {
+            // Split off the upper half for another thread, unless this one already has work up for stealing
+            if (last - first > range.grain && !hasLocalWork())
+            {
+                const int middle = first + (last - first) / 2;
+                range.pending.fetch_add(1);
+                Run([this, &range, middle, last] {
+                    runRange(range, middle, last);
+                    range.pending.fetch_sub(1, std::memory_order_release);
+                });
+                last = middle;
+                continue;
+            }
+            const int chunkEnd = std::min(last, first + range.grain);
+            range.body(first, chunkEnd);
+            first = chunkEnd;
+        }
+    }
+
+    void JobSystem::ParallelForRange(int begin, int end, const std::function<void(int, int)>& body, int grain)
+    {
+        if (begin >= end) return;
+        if (workers.empty())
+        {
+            body(begin, end);
+            return;
+        }
+        if (grain <= 0) grain = std::max(1, (end - begin) / static_cast<int>(ThreadCount() * 16));
+        Range range{body, grain};
+        runRange(range, begin, end);
+
+        helpUntil([&range] { return range.pending.load(std::memory_order_acquire) == 0; });
+    }
+
+    void JobSystem::workerLoop(size_t index)
+    {
+        currentSystem = this;
+        currentQueue = index;
+        while (true)
+        {
+            if (auto job = pop(index))
+            {
+                execute(job);
+                continue;
+            }
+            std::unique_lock lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+            if (stopping && queued.load() == 0) return;
+        }
+    }
+
+    JobSystem::JobSystem(unsigned workerCount)
+    {
+        for (unsigned i = 0; i <= workerCount; ++i)
+            queues.push_back(std::make_unique<Queue>());
+        for (unsigned i = 0; i < workerCount; ++i)
+            workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers)
+            worker.join();
+    }
+} // namespace soft3d
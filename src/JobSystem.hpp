@@ -0,0 +1,113 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace soft3d
+{
+    /*
+     * Work-stealing task scheduler shared by the renderer and the loaders. Each worker thread owns a deque of
+     * jobs: it pushes and pops at the back (the newest job, whose data is still in cache) and, when it runs dry,
+     * steals from the front of another worker's deque (the oldest, and usually the largest, piece of work).
+     * Threads outside the pool (the main, raster and loader threads) queue into one shared deque.
+     *
+     * A thread that waits (Wait, ParallelFor) runs jobs in the meantime, but only jobs of its own group: the ones
+     * it queued, and the ones those jobs queued in turn. So the main thread takes part in its own frame's work,
+     * but never picks up a slow loader job that would hold up the frame. Once there is none left it spins
+     * briefly, then sleeps until a job is queued or finishes.
+     */
+    class JobSystem
+    {
+      public:
+        class Job;
+        using JobHandle = std::shared_ptr<Job>;
+
+        // The process-wide scheduler: one worker per hardware thread, less one for the thread that waits.
+        static JobSystem& Get();
+
+        // With no workers every job runs on the thread that queues (or waits for) it.
+        explicit JobSystem(unsigned workerCount);
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+        ~JobSystem();
+
+        // Queues 'work' to run once every job in 'dependencies' (nullptr entries are ignored) has finished.
+        JobHandle Run(std::function<void()> work, std::initializer_list<JobHandle> dependencies = {});
+        void Wait(const JobHandle& job);
+
+        /*
+         * Calls body(first, last) on disjoint sub-ranges covering [begin, end) and returns once they have all
+         * run. The range is split lazily: the thread working through it runs 'grain' indices at a time, and
+         * splits off the upper half of what is left only while its own deque is empty, i.e. while other threads
+         * may be looking for work. Even loops pay little more than a serial loop, and uneven ones (triangles
+         * of very different sizes) keep splitting until every thread is busy. 'grain' 0 picks one from the
+         * range and the thread count.
+         */
+        void ParallelForRange(int begin, int end, const std::function<void(int, int)>& body, int grain = 0);
+        // ParallelForRange calling body(i) for each index.
+        template <typename Body>
+        void ParallelFor(int begin, int end, const Body& body, int grain = 0)
+        {
+            ParallelForRange(
+                begin,
+                end,
+                [&body](int first, int last) {
+                    for (int i = first; i < last; ++i)
+                        body(i);
+                },
+                grain);
+        }
+
+        // Workers plus the thread that waits.
+        [[nodiscard]] unsigned ThreadCount() const
+        {
+            return static_cast<unsigned>(workers.size()) + 1;
+        }
+
+      private:
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<JobHandle> jobs;
+        };
+        struct Range; // A ParallelForRange in progress
+
+        std::vector<std::unique_ptr<Queue>> queues; // One per worker, then the one shared by outside threads
+        std::vector<std::thread> workers;
+        std::atomic<int> queued = 0;
+        // Bumped whenever a job is queued or finishes, for waiting threads to sleep on (atomic wait)
+        std::atomic<uint32_t> progress = 0;
+        static constexpr int SPIN_COUNT = 16; // Yields before a waiting thread sleeps
+        std::mutex sleepMutex;
+        std::condition_variable wake;
+        bool stopping = false;
+
+        Queue& localQueue();
+        // Whether this thread already has jobs queued that another thread could take
+        bool hasLocalWork();
+        void push(JobHandle job);
+        // The newest job of the local queue, else the oldest of another. nullptr if every queue is empty.
+        JobHandle pop(size_t queue);
+        // Like pop, but only jobs of 'group'.
+        JobHandle popGroup(const void* group);
+        void execute(const JobHandle& job);
+        void signalProgress();
+        // Runs jobs of this thread's group until 'ready' returns true, sleeping while there are none.
+        template <typename Ready>
+        void helpUntil(const Ready& ready);
+        void runRange(Range& range, int first, int last);
+        void workerLoop(size_t index);
+    };
+} // namespace soft3d
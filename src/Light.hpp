@@ -0,0 +1,80 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include "slib.hpp"
+#include "smath.hpp"
+#include <algorithm>
+
+namespace soft3d
+{
+    enum LightType
+    {
+        DIRECTIONAL,
+        POINT,
+        SPOT
+    };
+
+    struct Light
+    {
+        LightType type = DIRECTIONAL;
+        slib::vec3 position{};  // World space (point/spot)
+        slib::vec3 direction{}; // Unit vector pointing towards the light (directional), or the spot's facing
+        float intensity = 1;
+        float range = 10;        // Point/spot lights have no effect beyond this distance
+        float cosInner = 0.95f;  // Spot: full intensity inside this cone
+        float cosOuter = 0.85f;  // Spot: no light outside this cone
+
+        static Light Directional(const slib::vec3& towardsLight, float intensity)
+        {
+            return {DIRECTIONAL, {}, smath::normalize(towardsLight), intensity};
+        }
+
+        static Light Point(const slib::vec3& position, float range, float intensity)
+        {
+            return {POINT, position, {}, intensity, range};
+        }
+
+        static Light Spot(
+            const slib::vec3& position,
+            const slib::vec3& direction,
+            float range,
+            float intensity,
+            float cosInner,
+            float cosOuter)
+        {
+            return {SPOT, position, smath::normalize(direction), intensity, range, cosInner, cosOuter};
+        }
+    };
+
+    /*
+     * Returns how much of the light reaches 'position' (0-1) and writes the unit vector towards the light to 'L'.
+     */
+    inline float lightAttenuation(const Light& light, const slib::vec3& position, slib::vec3& L)
+    {
+        if (light.type == DIRECTIONAL)
+        {
+            L = light.direction;
+            return 1;
+        }
+
+        const slib::vec3 toLight = light.position - position;
+        const float distanceSq = smath::dot(toLight, toLight);
+        const float rangeSq = light.range * light.range;
+        if (distanceSq >= rangeSq) return 0;
+
+        L = toLight * smath::fastInvSqrt(distanceSq);
+        float attenuation = 1 - distanceSq / rangeSq;
+        attenuation *= attenuation;
+
+        if (light.type == SPOT)
+        {
+            const float cosAngle = -smath::dot(L, light.direction);
+            if (cosAngle <= light.cosOuter) return 0;
+            attenuation *= std::min((cosAngle - light.cosOuter) / (light.cosInner - light.cosOuter), 1.0f);
+        }
+        return attenuation;
+    }
+} // namespace soft3d
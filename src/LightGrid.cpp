@@ -0,0 +1,128 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "LightGrid.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace soft3d
+{
+    void LightGrid::SetLights(const std::vector<Light>* _lights)
+    {
+        lights = _lights;
+        globalLights.clear();
+        localLights.clear();
+        for (int i = 0; i < static_cast<int>(lights->size()); ++i)
+        {
+            if ((*lights)[i].type == DIRECTIONAL)
+                globalLights.push_back(i);
+            else
+                localLights.push_back(i);
+        }
+    }
+
+    void LightGrid::Resize(int _width, int _height)
+    {
+        width = _width;
+        height = _height;
+        tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+        tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+        tiles.resize(tilesX * tilesY);
+    }
+
+    void LightGrid::ResetDepth()
+    {
+        for (auto& tile : tiles)
+        {
+            tile.minDepth = FLT_MAX;
+            tile.maxDepth = -FLT_MAX;
+            tile.count = 0;
+        }
+    }
+
+    void LightGrid::ExpandDepth(
+        std::vector<float>& minDepths,
+        std::vector<float>& maxDepths,
+        float xmin,
+        float xmax,
+        float ymin,
+        float ymax,
+        float minDepth,
+        float maxDepth) const
+    {
+        const int txMin = std::max(static_cast<int>(xmin) / TILE_SIZE, 0);
+        const int txMax = std::min(static_cast<int>(xmax) / TILE_SIZE, tilesX - 1);
+        const int tyMin = std::max(static_cast<int>(ymin) / TILE_SIZE, 0);
+        const int tyMax = std::min(static_cast<int>(ymax) / TILE_SIZE, tilesY - 1);
+        for (int ty = tyMin; ty <= tyMax; ++ty)
+        {
+            for (int tx = txMin; tx <= txMax; ++tx)
+            {
+                const int i = ty * tilesX + tx;
+                minDepths[i] = std::min(minDepths[i], minDepth);
+                maxDepths[i] = std::max(maxDepths[i], maxDepth);
+            }
+        }
+    }
+
+    void LightGrid::MergeDepth(const std::vector<float>& minDepths, const std::vector<float>& maxDepths)
+    {
+        for (int i = 0; i < static_cast<int>(tiles.size()); ++i)
+        {
+            tiles[i].minDepth = std::min(tiles[i].minDepth, minDepths[i]);
+            tiles[i].maxDepth = std::max(tiles[i].maxDepth, maxDepths[i]);
+        }
+    }
+
+    void LightGrid::Cull(const slib::mat& viewTransform, const slib::mat& perspective)
+    {
+        droppedLights = 0;
+        for (const uint16_t index : localLights)
+        {
+            const Light& light = (*lights)[index];
+            const slib::vec4 view = viewTransform * slib::vec4{light.position.x, light.position.y, light.position.z, 1};
+            const slib::vec4 clip = perspective * view;
+
+            // Depth range of the light's bounding sphere (w is linear in view space z)
+            const float nearW = (perspective * slib::vec4{view.x, view.y, view.z + light.range, 1}).w;
+            const float farW = (perspective * slib::vec4{view.x, view.y, view.z - light.range, 1}).w;
+            const float minW = std::min(nearW, farW);
+            const float maxW = std::max(nearW, farW);
+            if (maxW <= 0) continue; // Entirely behind the camera
+
+            // Screen space bounds of the sphere. If the sphere crosses the camera plane it may cover any tile.
+            int txMin = 0, txMax = tilesX - 1, tyMin = 0, tyMax = tilesY - 1;
+            if (minW > 1e-4f)
+            {
+                const double halfWidth = width / 2.0;
+                const double halfHeight = height / 2.0;
+                const auto cx = static_cast<float>(halfWidth + clip.x / clip.w * halfWidth);
+                const auto cy = static_cast<float>(halfHeight - clip.y / clip.w * halfHeight);
+                const auto rx =
+                    static_cast<float>(std::abs(perspective.data[0][0]) * light.range / minW * halfWidth);
+                const auto ry =
+                    static_cast<float>(std::abs(perspective.data[1][1]) * light.range / minW * halfHeight);
+                txMin = std::max(static_cast<int>(std::floor((cx - rx) / TILE_SIZE)), 0);
+                txMax = std::min(static_cast<int>(std::floor((cx + rx) / TILE_SIZE)), tilesX - 1);
+                tyMin = std::max(static_cast<int>(std::floor((cy - ry) / TILE_SIZE)), 0);
+                tyMax = std::min(static_cast<int>(std::floor((cy + ry) / TILE_SIZE)), tilesY - 1);
+            }
+
+            for (int ty = tyMin; ty <= tyMax; ++ty)
+            {
+                for (int tx = txMin; tx <= txMax; ++tx)
+                {
+                    Tile& tile = tiles[ty * tilesX + tx];
+                    // Empty tiles have minDepth > maxDepth and never pass
+                    if (tile.maxDepth < minW || tile.minDepth > maxW) continue;
+                    if (tile.count < MAX_LIGHTS_PER_TILE)
+                        tile.lights[tile.count++] = index;
+                    else
+                        ++droppedLights;
+                }
+            }
+        }
+    }
+} // namespace soft3d
@@ -0,0 +1,85 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include "Light.hpp"
+#include "slib.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace soft3d
+{
+    /*
+     * Tiled light culling. The screen is split into TILE_SIZE x TILE_SIZE tiles; each tile gets the depth range of
+     * the triangles that overlap it and the list of point/spot lights whose bounds touch that range.
+     * Directional lights affect every pixel and are kept in a separate list.
+     */
+    class LightGrid
+    {
+      public:
+        static constexpr int TILE_SIZE = 16;
+        static constexpr int MAX_LIGHTS_PER_TILE = 64;
+
+        struct Tile
+        {
+            float minDepth, maxDepth;
+            int count;
+            uint16_t lights[MAX_LIGHTS_PER_TILE];
+        };
+
+        // Lights of the current scene. Must outlive the grid (owned by the renderer).
+        void SetLights(const std::vector<Light>* _lights);
+        [[nodiscard]] bool HasLocalLights() const
+        {
+            return !localLights.empty();
+        }
+
+        // Covers a width x height pixel frame (the render resolution, which may change between frames).
+        void Resize(int width, int height);
+        [[nodiscard]] int TileCount() const
+        {
+            return tilesX * tilesY;
+        }
+
+        /*
+         * Per frame: reset the tile depth ranges, grow them with every visible triangle, then assign the lights.
+         * Depth is clip space w (the same as slib::vec4::w after projection). ExpandDepth works on a (per-thread)
+         * copy of the ranges, sized TileCount(), which is then merged into the grid.
+         */
+        void ResetDepth();
+        void ExpandDepth(
+            std::vector<float>& minDepths,
+            std::vector<float>& maxDepths,
+            float xmin,
+            float xmax,
+            float ymin,
+            float ymax,
+            float minDepth,
+            float maxDepth) const;
+        void MergeDepth(const std::vector<float>& minDepths, const std::vector<float>& maxDepths);
+        // Assigns the lights to the tiles. 'viewTransform' is world to view space, applied as m * v.
+        void Cull(const slib::mat& viewTransform, const slib::mat& perspective);
+        // Times the last Cull left a light out of a tile that already had MAX_LIGHTS_PER_TILE.
+        [[nodiscard]] int DroppedLights() const
+        {
+            return droppedLights;
+        }
+
+        [[nodiscard]] const Tile& TileAt(int x, int y) const
+        {
+            return tiles[(y / TILE_SIZE) * tilesX + x / TILE_SIZE];
+        }
+
+        const std::vector<Light>* lights = nullptr;
+        std::vector<uint16_t> globalLights; // Directional lights
+        std::vector<uint16_t> localLights;  // Point and spot lights (the ones that get culled)
+
+      private:
+        int width = 0, height = 0;
+        int tilesX = 0, tilesY = 0;
+        std::vector<Tile> tiles;
+        int droppedLights = 0;
+    };
+} // namespace soft3d
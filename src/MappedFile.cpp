@@ -0,0 +1,94 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "MappedFile.hpp"
+#include <fstream>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace soft3d
+{
+    MappedFile::MappedFile(const char* path)
+    {
+#ifndef _WIN32
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return;
+        struct stat info
+        {
+        };
+        if (fstat(fd, &info) == 0)
+        {
+            open = true;
+            size = static_cast<size_t>(info.st_size);
+            if (size > 0)
+            {
+                void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (view != MAP_FAILED)
+                {
+                    madvise(view, size, MADV_SEQUENTIAL);
+                    data = static_cast<const char*>(view);
+                    mapped = true;
+                }
+            }
+        }
+        ::close(fd);
+        if (!open || mapped || size == 0) return;
+#endif
+        // Could not map: read the whole file instead
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+        {
+            open = false;
+            return;
+        }
+        buffer.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        data = buffer.data();
+        size = buffer.size();
+        open = true;
+    }
+
+    void MappedFile::release()
+    {
+#ifndef _WIN32
+        if (mapped) munmap(const_cast<char*>(data), size);
+#endif
+        data = nullptr;
+        size = 0;
+        buffer.clear();
+        mapped = false;
+        open = false;
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+    {
+        if (this == &other) return *this;
+        release();
+        buffer = std::move(other.buffer);
+        mapped = std::exchange(other.mapped, false);
+        open = std::exchange(other.open, false);
+        size = std::exchange(other.size, 0);
+        data = mapped ? other.data : buffer.data();
+        if (size == 0) data = nullptr;
+        other.data = nullptr;
+        return *this;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        release();
+    }
+} // namespace soft3d
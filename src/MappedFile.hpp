@@ -0,0 +1,46 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace soft3d
+{
+    /*
+     * Read-only view of a whole file. Memory-mapped where the platform supports it, otherwise read into memory.
+     * Move-only; the mapping is released when the object is destroyed.
+     */
+    class MappedFile
+    {
+        const char* data = nullptr;
+        size_t size = 0;
+        std::vector<char> buffer; // Fallback when the file cannot be mapped
+        bool mapped = false;
+        bool open = false;
+        void release();
+
+      public:
+        [[nodiscard]] bool IsOpen() const
+        {
+            return open;
+        }
+        [[nodiscard]] const char* Data() const
+        {
+            return data;
+        }
+        [[nodiscard]] size_t Size() const
+        {
+            return size;
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        explicit MappedFile(const char* path);
+        ~MappedFile();
+    };
+} // namespace soft3d
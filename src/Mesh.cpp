@@ -0,0 +1,214 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "Mesh.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace soft3d
+{
+    // Wraps a Kd channel into [0, 1) and converts it to a byte (matches how untextured materials have always been
+    // shaded).
+    inline uint32_t kdToByte(float kd)
+    {
+        kd = std::fmod(kd, 1.0f);
+        kd = kd < 0 ? 1.0f + kd : kd;
+        return static_cast<uint32_t>(kd * 255);
+    }
+
+    MaterialConstants makeMaterialConstants(const slib::material& material, bool atlas)
+    {
+        MaterialConstants constants;
+        constants.baseColor =
+            kdToByte(material.Kd[0]) << 16 | kdToByte(material.Kd[1]) << 8 | kdToByte(material.Kd[2]);
+        if (material.map_Kd && !material.map_Kd->data.empty()) constants.flags |= MATERIAL_TEXTURED;
+        if (atlas) constants.flags |= MATERIAL_ATLAS;
+        if (material.virtual_Kd)
+        {
+            constants.flags |= MATERIAL_VIRTUAL;
+            constants.virtualTexture = material.virtual_Kd.get();
+        }
+
+        const slib::sampler& sampler = material.texSampler;
+        if (sampler.filter != slib::FILTER_DEFAULT)
+        {
+            constants.flags |= MATERIAL_FILTER_PINNED;
+            const bool bilinear = sampler.filter == slib::FILTER_LINEAR;
+            constants.sample[0] = constants.sample[1] =
+                ResolveSampler(material.map_Kd.get(), sampler.addressMode, bilinear, atlas);
+        }
+        else
+        {
+            constants.sample[0] = ResolveSampler(material.map_Kd.get(), sampler.addressMode, false, atlas);
+            constants.sample[1] = ResolveSampler(material.map_Kd.get(), sampler.addressMode, true, atlas);
+        }
+
+        // Specular (Blinn-Phong). The exponent is baked into a table so the shader doesn't call pow per pixel.
+        const bool hasSpecular = material.Ks[0] > 0 || material.Ks[1] > 0 || material.Ks[2] > 0;
+        if (hasSpecular)
+        {
+            constants.flags |= MATERIAL_SPECULAR;
+            for (int i = 0; i < 3; ++i)
+                constants.specular[i] = std::min(material.Ks[i], 1.0f) * 255;
+            constants.sampleSpecular = ResolveSampler(material.map_Ks.get(), sampler.addressMode, false, atlas);
+            const float shininess = std::max(material.Ns, 1.0f); // Ns 0 would light every facing pixel
+            for (int i = 0; i < SPECULAR_LUT_SIZE; ++i)
+                constants.specularLut[i] = std::pow(static_cast<float>(i) / (SPECULAR_LUT_SIZE - 1), shininess);
+        }
+        return constants;
+    }
+
+    void Mesh::SetAtlas(int tileSize)
+    {
+        atlas = true;
+        atlasTileSize = tileSize;
+        for (size_t i = 0; i < materials.size(); ++i)
+            materialConstants[i] = makeMaterialConstants(materials[i], atlas);
+    }
+
+    namespace
+    {
+        struct MeshArrays
+        {
+            std::vector<slib::vec3> vertices;
+            std::vector<slib::tri> faces;
+            std::vector<slib::vec2> textureCoords;
+            std::vector<slib::vec3> normals;
+        };
+    } // namespace
+
+    Mesh::Mesh(
+        std::vector<slib::vec3> _vertices,
+        std::vector<slib::tri> _faces,
+        std::vector<slib::vec2> _textureCoords,
+        std::vector<slib::vec3> _normals,
+        std::vector<slib::material> _materials)
+        : materials(std::move(_materials))
+    {
+        auto arrays = std::make_shared<MeshArrays>(
+            MeshArrays{std::move(_vertices), std::move(_faces), std::move(_textureCoords), std::move(_normals)});
+        vertices = arrays->vertices;
+        faces = arrays->faces;
+        textureCoords = arrays->textureCoords;
+        normals = arrays->normals;
+        storage = std::move(arrays);
+
+        materialConstants.reserve(materials.size());
+        for (const auto& material : materials)
+            materialConstants.push_back(makeMaterialConstants(material, atlas));
+        computeBounds();
+    }
+
+    Mesh::Mesh(
+        std::span<const slib::vec3> _vertices,
+        std::span<const slib::tri> _faces,
+        std::span<const slib::vec2> _textureCoords,
+        std::span<const slib::vec3> _normals,
+        std::vector<slib::material> _materials,
+        std::shared_ptr<const void> _storage)
+        : vertices(_vertices),
+          faces(_faces),
+          textureCoords(_textureCoords),
+          normals(_normals),
+          materials(std::move(_materials)),
+          storage(std::move(_storage))
+    {
+        materialConstants.reserve(materials.size());
+        for (const auto& material : materials)
+            materialConstants.push_back(makeMaterialConstants(material, atlas));
+        computeBounds();
+    }
+
+    void Mesh::computeBounds()
+    {
+        if (vertices.empty()) return;
+        slib::vec3 lo = vertices[0], hi = vertices[0];
+        for (const auto& v : vertices)
+        {
+            lo = {std::min(lo.x, v.x), std::min(lo.y, v.y), std::min(lo.z, v.z)};
+            hi = {std::max(hi.x, v.x), std::max(hi.y, v.y), std::max(hi.z, v.z)};
+        }
+        boundsCenter = (lo + hi) * 0.5f;
+        float radiusSquared = 0;
+        for (const auto& v : vertices)
+        {
+            const slib::vec3 d = v - boundsCenter;
+            radiusSquared = std::max(radiusSquared, d.x * d.x + d.y * d.y + d.z * d.z);
+        }
+        boundsRadius = std::sqrt(radiusSquared);
+    }
+
+    size_t Mesh::AttributeBytes() const
+    {
+        if (quantized)
+            return quantized->vertices.size() * sizeof(QuantizedVertex) +
+                   quantized->textureCoords.size() * sizeof(quantized->textureCoords[0]);
+        return vertices.size_bytes() + normals.size_bytes() + textureCoords.size_bytes();
+    }
+
+    // Range that maps 0-65535 onto the bounding box of 'values' (per component).
+    template <typename T, typename Component>
+    QuantizationRange quantizationRange(std::span<const T> values, int components, Component component)
+    {
+        QuantizationRange range;
+        float* offset = &range.offset.x;
+        float* scale = &range.scale.x;
+        for (int c = 0; c < components; ++c)
+        {
+            float lo = 0, hi = 0;
+            if (!values.empty()) lo = hi = component(values[0], c);
+            for (const auto& v : values)
+            {
+                lo = std::min(lo, component(v, c));
+                hi = std::max(hi, component(v, c));
+            }
+            offset[c] = lo;
+            scale[c] = (hi - lo) / 65535;
+        }
+        return range;
+    }
+
+    Mesh Mesh::Quantized() const
+    {
+        if (quantized) return *this;
+
+        auto attributes = std::make_shared<QuantizedAttributes>();
+        attributes->hasNormals = !normals.empty();
+        attributes->positionRange =
+            quantizationRange(vertices, 3, [](const slib::vec3& v, int c) { return (&v.x)[c]; });
+        attributes->textureCoordRange =
+            quantizationRange(textureCoords, 2, [](const slib::vec2& v, int c) { return (&v.x)[c]; });
+
+        const auto& p = attributes->positionRange;
+        attributes->vertices.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i)
+        {
+            auto& q = attributes->vertices[i];
+            q.position[0] = quantizeUnorm16(vertices[i].x, p.offset.x, p.scale.x);
+            q.position[1] = quantizeUnorm16(vertices[i].y, p.offset.y, p.scale.y);
+            q.position[2] = quantizeUnorm16(vertices[i].z, p.offset.z, p.scale.z);
+            octEncode(attributes->hasNormals ? normals[i] : slib::vec3{0, 0, 1}, q.normal);
+        }
+
+        const auto& uv = attributes->textureCoordRange;
+        attributes->textureCoords.resize(textureCoords.size());
+        for (size_t i = 0; i < textureCoords.size(); ++i)
+        {
+            attributes->textureCoords[i] = {
+                quantizeUnorm16(textureCoords[i].x, uv.offset.x, uv.scale.x),
+                quantizeUnorm16(textureCoords[i].y, uv.offset.y, uv.scale.y)};
+        }
+
+        Mesh mesh = *this;
+        mesh.vertices = {};
+        mesh.textureCoords = {};
+        mesh.normals = {};
+        mesh.storage = std::make_shared<std::vector<slib::tri>>(faces.begin(), faces.end());
+        mesh.faces = *std::static_pointer_cast<const std::vector<slib::tri>>(mesh.storage);
+        mesh.quantized = std::move(attributes);
+        for (auto& lod : mesh.lods)
+            lod.mesh = std::make_shared<const Mesh>(lod.mesh->Quantized());
+        return mesh;
+    }
+} // namespace soft3d
@@ -2,33 +2,140 @@
 // Created by Steve Wheeler on 23/08/2023.
 //
 #pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
 #include <utility>
 #include <vector>
-#include <map>
 #include "slib.hpp"
 #include "smath.hpp"
+#include "Sampler.hpp"
+#include "VertexQuantization.hpp"
 #include <string>
 
 namespace soft3d
 {
+enum MaterialFlags : uint32_t
+{
+    MATERIAL_TEXTURED = 1 << 0,
+    MATERIAL_ATLAS = 1 << 1,
+    MATERIAL_FILTER_PINNED = 1 << 2, // The mtl file chose a filter; the renderer's filter setting is ignored
+    MATERIAL_SPECULAR = 1 << 3, // Has a non-zero Ks (used by the PHONG shader)
+    MATERIAL_VIRTUAL = 1 << 4 // The diffuse map is a virtual texture (sampled per level of detail)
+};
+
+constexpr int SPECULAR_LUT_SIZE = 1024;
+
+/*
+ * Per-material values the rasterizer needs, worked out once at load instead of per triangle/pixel.
+ */
+struct MaterialConstants
+{
+    uint32_t baseColor{}; // Kd packed as 0x00RRGGBB
+    uint32_t flags{};
+    SampleFn sample[2]{}; // Fetch function for the renderer's filter setting, indexed by [bilinear]
+    float specular[3]{}; // Ks scaled to 0-255
+    SampleFn sampleSpecular{}; // map_Ks (nearest), nullptr if the material has none
+    const VirtualTexture* virtualTexture{}; // virtual_Kd, nullptr if the material has none
+    std::array<float, SPECULAR_LUT_SIZE> specularLut{}; // pow(i / (SPECULAR_LUT_SIZE - 1), Ns)
+};
+
+// Compressed vertex attributes (see Mesh::Quantized).
+struct QuantizedAttributes
+{
+    QuantizationRange positionRange;
+    QuantizationRange textureCoordRange; // Only x/y used
+    std::vector<QuantizedVertex> vertices; // Position and normal
+    std::vector<std::array<uint16_t, 2>> textureCoords;
+    bool hasNormals = false;
+};
+
+struct Mesh;
+
+// A simplified version of a mesh (see GenerateLods).
+struct MeshLod
+{
+    std::shared_ptr<const Mesh> mesh;
+    float error; // How far its surface may be from the original mesh's, in model units
+};
+
 struct Mesh
 {
-    const std::vector<slib::vec3> vertices;
-    const std::vector<slib::tri> faces; // Contains the indices of the vertices and texture data
+    // Geometry. These are views into 'storage', which is either the parsed data or a memory-mapped mesh cache,
+    // so copies of a mesh share the same arrays.
+    std::span<const slib::vec3> vertices;
+    std::span<const slib::tri> faces; // Contains the indices of the vertices and texture data
     // vertex attributes
-    const std::vector<slib::vec2> textureCoords;
-    const std::vector<slib::vec3> normals; // The normal shares the same index as the associated vertex in 'vertices'
+    std::span<const slib::vec2> textureCoords;
+    std::span<const slib::vec3> normals; // The normal shares the same index as the associated vertex in 'vertices'
     // -----------------
-    const std::map<std::string, slib::material> materials;
-    bool atlas = false; // Does this mesh use a texture atlas (requires 'tiles' of a consistent size)
+    // Set on quantized meshes, which leave 'vertices', 'textureCoords' and 'normals' empty. Use the accessors
+    // below to read attributes of either kind of mesh.
+    std::shared_ptr<const QuantizedAttributes> quantized;
+    std::vector<slib::material> materials; // Indexed by slib::tri::material
+    std::vector<MaterialConstants> materialConstants; // Same indices as 'materials'
+    // Does this mesh use a texture atlas (requires 'tiles' of a consistent size). Set with SetAtlas.
+    bool atlas = false;
     int atlasTileSize = 32;
-    Mesh(const std::vector<slib::vec3>& _vertices, const std::vector<slib::tri>& _faces,
-         const std::vector<slib::vec2>& _textureCoords, const std::vector<slib::vec3>& _normals,
-         const std::map<std::string, slib::material>&  _materials) :
-        vertices(_vertices), faces(_faces), textureCoords(_textureCoords), normals(_normals),
-        materials(_materials)
+    // Marks the mesh as using a texture atlas and rebuilds the material constants accordingly.
+    void SetAtlas(int tileSize);
+    // Bounding sphere of the vertices, in model space (centred on their bounding box). Used to cull instances.
+    slib::vec3 boundsCenter{};
+    float boundsRadius = 0;
+    // Coarser versions of the mesh, finest first, with increasing 'error'. The renderer draws the coarsest one
+    // whose error covers less than a pixel or so on screen. They share the mesh's bounds.
+    std::vector<MeshLod> lods;
+
+    [[nodiscard]] size_t VertexCount() const
+    {
+        return quantized ? quantized->vertices.size() : vertices.size();
+    }
+    [[nodiscard]] bool HasNormals() const
+    {
+        return quantized ? quantized->hasNormals : !normals.empty();
+    }
+    [[nodiscard]] slib::vec3 Position(int i) const
+    {
+        return quantized ? dequantizePosition(quantized->vertices[i], quantized->positionRange) : vertices[i];
+    }
+    [[nodiscard]] slib::vec3 Normal(int i) const
     {
+        return quantized ? octDecode(quantized->vertices[i].normal) : normals[i];
     }
+    // Index -1 (no texture coordinates) gives (0, 0).
+    [[nodiscard]] slib::vec2 TextureCoord(int i) const
+    {
+        if (i < 0) return {0, 0};
+        return quantized ? dequantizeTextureCoord(quantized->textureCoords[i].data(), quantized->textureCoordRange)
+                         : textureCoords[i];
+    }
+    // Bytes used by the per-vertex attributes (positions, normals and texture coordinates).
+    [[nodiscard]] size_t AttributeBytes() const;
+
+    // Returns a copy of the mesh (and of its lods) with 16-bit positions and texture coordinates and octahedral
+    // normals. The copy does not keep the float attributes.
+    [[nodiscard]] Mesh Quantized() const;
+    Mesh(Mesh&&) noexcept = default;
+    Mesh& operator=(Mesh&&) noexcept = default;
+    Mesh(std::vector<slib::vec3> _vertices, std::vector<slib::tri> _faces,
+         std::vector<slib::vec2> _textureCoords, std::vector<slib::vec3> _normals,
+         std::vector<slib::material> _materials);
+    // Geometry owned by something else (e.g. a mapped file), kept alive by '_storage'.
+    Mesh(std::span<const slib::vec3> _vertices, std::span<const slib::tri> _faces,
+         std::span<const slib::vec2> _textureCoords, std::span<const slib::vec3> _normals,
+         std::vector<slib::material> _materials, std::shared_ptr<const void> _storage);
+
+  private:
+    std::shared_ptr<const void> storage;
+    void computeBounds();
+    // Meshes are shared through handles (AssetRegistry) rather than copied. Only Quantized copies one, and that
+    // copy shares the geometry.
+    Mesh(const Mesh&) = default;
+    Mesh& operator=(const Mesh&) = default;
 };
-}
 
+static_assert(!std::is_copy_constructible_v<Mesh> && !std::is_copy_assignable_v<Mesh>, "Mesh must not be copied");
+static_assert(std::is_nothrow_move_constructible_v<Mesh>, "Mesh must be cheap to return from loaders");
+}
@@ -0,0 +1,183 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "MeshCache.hpp"
+#include "Mesh.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+namespace soft3d
+{
+    static_assert(std::is_trivially_copyable_v<slib::vec3> && std::is_trivially_copyable_v<slib::vec2>);
+
+    namespace
+    {
+        constexpr char cacheMagic[4] = {'S', '3', 'D', 'M'};
+        constexpr uint64_t sectionAlignment = 64;
+        // Changes if any of the stored types change size
+        constexpr uint32_t layoutTag = sizeof(slib::vec3) | sizeof(slib::vec2) << 8 | sizeof(slib::tri) << 16;
+
+        enum Section
+        {
+            VERTICES,
+            FACES,
+            TEXTURE_COORDS,
+            NORMALS,
+            MATERIAL_LIBS, // '\0' separated names; 'count' is in bytes
+            SECTION_COUNT
+        };
+
+        struct CacheHeader
+        {
+            char magic[4];
+            uint32_t version;
+            uint32_t layout;
+            uint32_t materialLibCount;
+            uint64_t sourceHash;
+            struct
+            {
+                uint64_t offset;
+                uint64_t count;
+            } sections[SECTION_COUNT];
+        };
+
+        constexpr size_t elementSize[SECTION_COUNT] = {
+            sizeof(slib::vec3), sizeof(slib::tri), sizeof(slib::vec2), sizeof(slib::vec3), 1};
+
+        uint64_t align(uint64_t offset)
+        {
+            return (offset + sectionAlignment - 1) & ~(sectionAlignment - 1);
+        }
+
+        template <typename T>
+        std::span<const T> view(const MappedFile& file, const CacheHeader& header, Section section)
+        {
+            const auto& s = header.sections[section];
+            return {reinterpret_cast<const T*>(file.Data() + s.offset), static_cast<size_t>(s.count)};
+        }
+
+        inline uint64_t mix(uint64_t h)
+        {
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            return h;
+        }
+    } // namespace
+
+    // 8 bytes per step; not cryptographic, just quick to compute on every launch.
+    uint64_t HashBytes(const char* data, size_t size, uint64_t seed)
+    {
+        constexpr uint64_t prime = 0x9e3779b97f4a7c15ULL;
+        uint64_t h = seed ^ (size * prime);
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            h = (h ^ mix(word * prime)) * prime;
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, data + i, size - i);
+        h = (h ^ mix(tail * prime)) * prime;
+        return mix(h);
+    }
+
+    std::optional<MeshCache> OpenMeshCache(const char* cachePath)
+    {
+        auto file = std::make_shared<const MappedFile>(cachePath);
+        if (!file->IsOpen() || file->Size() < sizeof(CacheHeader)) return std::nullopt;
+
+        CacheHeader header{};
+        std::memcpy(&header, file->Data(), sizeof(header));
+        if (std::memcmp(header.magic, cacheMagic, 4) != 0 || header.version != MESH_CACHE_VERSION ||
+            header.layout != layoutTag)
+            return std::nullopt;
+        for (int i = 0; i < SECTION_COUNT; ++i)
+        {
+            const auto& s = header.sections[i];
+            if (s.count == 0) continue;
+            if (s.offset % sectionAlignment != 0 || s.offset > file->Size() ||
+                s.count > (file->Size() - s.offset) / elementSize[i])
+                return std::nullopt;
+        }
+
+        MeshCache cache;
+        cache.sourceHash = header.sourceHash;
+        cache.vertices = view<slib::vec3>(*file, header, VERTICES);
+        cache.faces = view<slib::tri>(*file, header, FACES);
+        cache.textureCoords = view<slib::vec2>(*file, header, TEXTURE_COORDS);
+        cache.normals = view<slib::vec3>(*file, header, NORMALS);
+
+        const auto libs = view<char>(*file, header, MATERIAL_LIBS);
+        for (size_t start = 0; cache.materialLibs.size() < header.materialLibCount && start < libs.size();)
+        {
+            const auto end = std::find(libs.begin() + static_cast<long>(start), libs.end(), '\0');
+            cache.materialLibs.emplace_back(libs.data() + start, end - (libs.begin() + static_cast<long>(start)));
+            start = end - libs.begin() + 1;
+        }
+        if (cache.materialLibs.size() != header.materialLibCount) return std::nullopt;
+        cache.file = std::move(file);
+        return cache;
+    }
+
+    bool SaveMeshCache(
+        const char* cachePath,
+        uint64_t sourceHash,
+        const std::vector<std::string>& materialLibs,
+        const Mesh& mesh)
+    {
+        std::string libs;
+        for (const auto& lib : materialLibs)
+        {
+            libs += lib;
+            libs += '\0';
+        }
+
+        CacheHeader header{};
+        std::memcpy(header.magic, cacheMagic, 4);
+        header.version = MESH_CACHE_VERSION;
+        header.layout = layoutTag;
+        header.materialLibCount = static_cast<uint32_t>(materialLibs.size());
+        header.sourceHash = sourceHash;
+
+        const std::pair<const char*, uint64_t> data[SECTION_COUNT] = {
+            {reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size()},
+            {reinterpret_cast<const char*>(mesh.faces.data()), mesh.faces.size()},
+            {reinterpret_cast<const char*>(mesh.textureCoords.data()), mesh.textureCoords.size()},
+            {reinterpret_cast<const char*>(mesh.normals.data()), mesh.normals.size()},
+            {libs.data(), libs.size()}};
+        uint64_t offset = align(sizeof(header));
+        for (int i = 0; i < SECTION_COUNT; ++i)
+        {
+            header.sections[i] = {offset, data[i].second};
+            offset = align(offset + data[i].second * elementSize[i]);
+        }
+
+        // Written to a temporary file first so a reader never maps a half-written cache
+        const std::string tmpPath = std::string(cachePath) + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::binary);
+            if (!file.is_open())
+            {
+                std::cout << "Warning: could not write mesh cache " << cachePath << std::endl;
+                return false;
+            }
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            for (int i = 0; i < SECTION_COUNT; ++i)
+            {
+                file.seekp(static_cast<std::streamoff>(header.sections[i].offset));
+                file.write(data[i].first, static_cast<std::streamsize>(data[i].second * elementSize[i]));
+            }
+            if (!file.good()) return false;
+        }
+        std::error_code error;
+        std::filesystem::rename(tmpPath, cachePath, error);
+        return !error;
+    }
+} // namespace soft3d
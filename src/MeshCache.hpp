@@ -0,0 +1,49 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include "MappedFile.hpp"
+#include "slib.hpp"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace soft3d
+{
+    struct Mesh;
+
+    /*
+     * Binary mesh cache ("<file>.obj.mesh"). Holds the geometry arrays exactly as Mesh uses them, each 64-byte
+     * aligned, so a cached mesh is memory-mapped and used in place. Materials are not cached (they own
+     * textures); the file lists the mtl libraries instead and they are loaded as usual.
+     * The header records a hash of the obj and mtl contents, so a stale cache is ignored.
+     */
+    constexpr uint32_t MESH_CACHE_VERSION = 1;
+
+    struct MeshCache
+    {
+        std::shared_ptr<const MappedFile> file; // Keeps the views below alive
+        uint64_t sourceHash = 0;
+        std::span<const slib::vec3> vertices;
+        std::span<const slib::tri> faces;
+        std::span<const slib::vec2> textureCoords;
+        std::span<const slib::vec3> normals;
+        std::vector<std::string> materialLibs;
+    };
+
+    // Hash of the contents of a file (or memory range), chained through 'seed'.
+    uint64_t HashBytes(const char* data, size_t size, uint64_t seed = 0);
+
+    // Maps a cache file and checks its layout. Returns nothing if it is missing, from another version, or corrupt.
+    std::optional<MeshCache> OpenMeshCache(const char* cachePath);
+    bool SaveMeshCache(
+        const char* cachePath,
+        uint64_t sourceHash,
+        const std::vector<std::string>& materialLibs,
+        const Mesh& mesh);
+} // namespace soft3d
@@ -0,0 +1,420 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "MeshSimplifier.hpp"
+#include "smath.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+
+namespace soft3d
+{
+    namespace
+    {
+        constexpr size_t MIN_LOD_FACES = 64;
+        // Weight of the planes that hold borders and seams in place, relative to the area of the faces
+        constexpr double BOUNDARY_WEIGHT = 10;
+        // A collapse may not turn a face by more than about 70 degrees
+        constexpr float MIN_NORMAL_COS = 0.35f;
+
+        // Sum of squared distances to a set of weighted planes (ax + by + cz + d = 0), as a symmetric 4x4 matrix.
+        struct Quadric
+        {
+            double aa = 0, ab = 0, ac = 0, ad = 0, bb = 0, bc = 0, bd = 0, cc = 0, cd = 0, dd = 0;
+
+            void AddPlane(double a, double b, double c, double d, double weight)
+            {
+                aa += weight * a * a, ab += weight * a * b, ac += weight * a * c, ad += weight * a * d;
+                bb += weight * b * b, bc += weight * b * c, bd += weight * b * d;
+                cc += weight * c * c, cd += weight * c * d;
+                dd += weight * d * d;
+            }
+            Quadric& operator+=(const Quadric& q)
+            {
+                aa += q.aa, ab += q.ab, ac += q.ac, ad += q.ad, bb += q.bb;
+                bc += q.bc, bd += q.bd, cc += q.cc, cd += q.cd, dd += q.dd;
+                return *this;
+            }
+            [[nodiscard]] double Evaluate(const slib::vec3& p) const
+            {
+                const double x = p.x, y = p.y, z = p.z;
+                return aa * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x + bb * y * y + 2 * bc * y * z +
+                       2 * bd * y + cc * z * z + 2 * cd * z + dd;
+            }
+        };
+
+        struct Face
+        {
+            int v[3];
+            int vt[3];
+            int material;
+            bool alive = true;
+
+            [[nodiscard]] int Corner(int vertex) const
+            {
+                return v[0] == vertex ? 0 : v[1] == vertex ? 1 : v[2] == vertex ? 2 : -1;
+            }
+        };
+
+        // Moving vertex 'from' onto vertex 'to'. Stale once either vertex has changed since it was queued.
+        struct Collapse
+        {
+            double cost;
+            int from, to;
+            uint32_t fromVersion, toVersion;
+
+            bool operator>(const Collapse& other) const
+            {
+                return cost > other.cost;
+            }
+        };
+
+        inline uint64_t edgeKey(int a, int b)
+        {
+            return static_cast<uint64_t>(std::min(a, b)) << 32 | static_cast<uint32_t>(std::max(a, b));
+        }
+
+        class Simplifier
+        {
+          public:
+            explicit Simplifier(const Mesh& mesh);
+
+            [[nodiscard]] size_t FaceCount() const
+            {
+                return faceCount;
+            }
+            // Collapses edges until at most 'targetFaces' remain or none can be collapsed. 'error' is raised to
+            // the largest error of the collapses made.
+            void Simplify(size_t targetFaces, float& error);
+            [[nodiscard]] MeshLod Extract(const Mesh& source, float error) const;
+
+          private:
+            std::vector<slib::vec3> positions;
+            std::vector<Face> faces;
+            std::vector<std::vector<int>> vertexFaces; // May hold dead faces until the vertex is next visited
+            std::vector<Quadric> quadrics;
+            std::vector<double> areas; // Face area behind each quadric (the boundary planes are not counted)
+            std::vector<uint32_t> versions;
+            std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> queue;
+            size_t faceCount = 0;
+
+            // Reused by canCollapse
+            std::vector<std::pair<int, int>> neighbours; // Vertex, number of faces on the edge
+            std::vector<std::pair<int, int>> wedges;     // Texture coordinate of 'from', of 'to'
+            std::vector<int> edgeMaterials;
+            std::vector<int> toNeighbours;
+
+            void liveFaces(int vertex);
+            void push(int from, int to);
+            bool canCollapse(int from, int to);
+            void collapse(int from, int to);
+        };
+
+        Simplifier::Simplifier(const Mesh& mesh)
+            : positions(mesh.VertexCount()),
+              vertexFaces(mesh.VertexCount()),
+              quadrics(mesh.VertexCount()),
+              areas(mesh.VertexCount()),
+              versions(mesh.VertexCount())
+        {
+            for (size_t i = 0; i < positions.size(); ++i)
+                positions[i] = mesh.Position(static_cast<int>(i));
+
+            faces.reserve(mesh.faces.size());
+            std::unordered_map<uint64_t, std::vector<int>> edgeFaces;
+            for (const auto& t : mesh.faces)
+            {
+                const int f = static_cast<int>(faces.size());
+                Face face{{t.v1, t.v2, t.v3}, {t.vt1, t.vt2, t.vt3}, t.material};
+                if (t.v1 == t.v2 || t.v2 == t.v3 || t.v1 == t.v3) continue;
+                faces.push_back(face);
+
+                const slib::vec3 normal = smath::cross(
+                    positions[t.v2] - positions[t.v1], positions[t.v3] - positions[t.v1]);
+                const double length = std::sqrt(smath::dot(normal, normal));
+                const double area = length / 2;
+                for (int c = 0; c < 3; ++c)
+                {
+                    vertexFaces[face.v[c]].push_back(f);
+                    edgeFaces[edgeKey(face.v[c], face.v[(c + 1) % 3])].push_back(f);
+                    if (length <= 0) continue;
+                    const double a = normal.x / length, b = normal.y / length, cz = normal.z / length;
+                    const slib::vec3& p = positions[face.v[c]];
+                    quadrics[face.v[c]].AddPlane(a, b, cz, -(a * p.x + b * p.y + cz * p.z), area);
+                    areas[face.v[c]] += area;
+                }
+            }
+            faceCount = faces.size();
+
+            // Edges that must keep their place: open borders, UV seams, material boundaries (and non-manifold
+            // edges). Each gets a plane through it, perpendicular to its faces.
+            for (const auto& [key, list] : edgeFaces)
+            {
+                const int a = static_cast<int>(key >> 32), b = static_cast<int>(key & 0xffffffff);
+                bool boundary = list.size() != 2;
+                if (!boundary)
+                {
+                    const Face& f0 = faces[list[0]];
+                    const Face& f1 = faces[list[1]];
+                    boundary = f0.material != f1.material || f0.vt[f0.Corner(a)] != f1.vt[f1.Corner(a)] ||
+                               f0.vt[f0.Corner(b)] != f1.vt[f1.Corner(b)];
+                }
+                if (!boundary) continue;
+                for (int f : list)
+                {
+                    const Face& face = faces[f];
+                    const slib::vec3 normal = smath::normalize(smath::cross(
+                        positions[face.v[1]] - positions[face.v[0]], positions[face.v[2]] - positions[face.v[0]]));
+                    const slib::vec3 edge = positions[b] - positions[a];
+                    const slib::vec3 side = smath::cross(edge, normal);
+                    const double length = std::sqrt(smath::dot(side, side));
+                    if (!(length > 0)) continue;
+                    const double x = side.x / length, y = side.y / length, z = side.z / length;
+                    const slib::vec3& p = positions[a];
+                    const double weight = BOUNDARY_WEIGHT * smath::dot(edge, edge);
+                    for (int v : {a, b})
+                        quadrics[v].AddPlane(x, y, z, -(x * p.x + y * p.y + z * p.z), weight);
+                }
+            }
+
+            for (const auto& entry : edgeFaces)
+            {
+                const int a = static_cast<int>(entry.first >> 32), b = static_cast<int>(entry.first & 0xffffffff);
+                push(a, b);
+                push(b, a);
+            }
+        }
+
+        void Simplifier::liveFaces(int vertex)
+        {
+            std::erase_if(vertexFaces[vertex], [this](int f) { return !faces[f].alive; });
+        }
+
+        void Simplifier::push(int from, int to)
+        {
+            Quadric q = quadrics[from];
+            q += quadrics[to];
+            queue.push({std::max(q.Evaluate(positions[to]), 0.0), from, to, versions[from], versions[to]});
+        }
+
+        /*
+         * The collapse must keep the surface a manifold (the edge's two vertices share no neighbour other than
+         * the ones across its faces) and must not fold any face over. Every texture coordinate and material that
+         * 'from' uses must continue on the edge's faces, so a vertex on a seam, material boundary or border only
+         * slides along it.
+         */
+        bool Simplifier::canCollapse(int from, int to)
+        {
+            liveFaces(from);
+            liveFaces(to);
+            neighbours.clear();
+            wedges.clear();
+            edgeMaterials.clear();
+            int edgeFaceCount = 0;
+            for (int f : vertexFaces[from])
+            {
+                const Face& face = faces[f];
+                const int corner = face.Corner(from);
+                for (int c : {(corner + 1) % 3, (corner + 2) % 3})
+                {
+                    auto it = std::find_if(neighbours.begin(), neighbours.end(), [&](const auto& n) {
+                        return n.first == face.v[c];
+                    });
+                    if (it == neighbours.end())
+                        neighbours.emplace_back(face.v[c], 1);
+                    else
+                        ++it->second;
+                }
+                const int toCorner = face.Corner(to);
+                if (toCorner < 0) continue;
+                ++edgeFaceCount;
+                edgeMaterials.push_back(face.material);
+                for (const auto& [vt, toVt] : wedges)
+                {
+                    if (vt == face.vt[corner] && toVt != face.vt[toCorner]) return false;
+                }
+                wedges.emplace_back(face.vt[corner], face.vt[toCorner]);
+            }
+            if (edgeFaceCount == 0) return false;
+
+            bool border = false;
+            int edgeCount = 0;
+            for (const auto& [vertex, count] : neighbours)
+            {
+                if (count > 2) return false;
+                border = border || count == 1;
+                if (vertex == to) edgeCount = count;
+            }
+            if (border && edgeCount != 1) return false;
+
+            toNeighbours.clear();
+            for (int f : vertexFaces[to])
+            {
+                for (int v : faces[f].v)
+                {
+                    if (v != to && v != from) toNeighbours.push_back(v);
+                }
+            }
+            std::sort(toNeighbours.begin(), toNeighbours.end());
+            toNeighbours.erase(std::unique(toNeighbours.begin(), toNeighbours.end()), toNeighbours.end());
+            int shared = 0;
+            for (const auto& n : neighbours)
+                shared += std::binary_search(toNeighbours.begin(), toNeighbours.end(), n.first);
+            if (shared != edgeFaceCount) return false;
+
+            for (int f : vertexFaces[from])
+            {
+                const Face& face = faces[f];
+                if (face.Corner(to) >= 0) continue;
+                const int corner = face.Corner(from);
+                const bool wedge = std::any_of(wedges.begin(), wedges.end(), [&](const auto& w) {
+                    return w.first == face.vt[corner];
+                });
+                const bool material =
+                    std::find(edgeMaterials.begin(), edgeMaterials.end(), face.material) != edgeMaterials.end();
+                if (!wedge || !material) return false;
+
+                slib::vec3 p[3] = {positions[face.v[0]], positions[face.v[1]], positions[face.v[2]]};
+                const slib::vec3 before = smath::cross(p[1] - p[0], p[2] - p[0]);
+                p[corner] = positions[to];
+                const slib::vec3 after = smath::cross(p[1] - p[0], p[2] - p[0]);
+                const float lengths = std::sqrt(smath::dot(before, before) * smath::dot(after, after));
+                if (!(smath::dot(before, after) > MIN_NORMAL_COS * lengths)) return false;
+            }
+            return true;
+        }
+
+        // Moves 'from' onto 'to', removing the faces of the edge. Assumes canCollapse (which leaves the
+        // texture coordinates to carry over in 'wedges').
+        void Simplifier::collapse(int from, int to)
+        {
+            for (int f : vertexFaces[from])
+            {
+                Face& face = faces[f];
+                if (face.Corner(to) >= 0)
+                {
+                    face.alive = false;
+                    --faceCount;
+                    continue;
+                }
+                const int corner = face.Corner(from);
+                face.v[corner] = to;
+                for (const auto& [vt, toVt] : wedges)
+                {
+                    if (vt == face.vt[corner])
+                    {
+                        face.vt[corner] = toVt;
+                        break;
+                    }
+                }
+                vertexFaces[to].push_back(f);
+            }
+            vertexFaces[from].clear();
+            quadrics[to] += quadrics[from];
+            areas[to] += areas[from];
+            ++versions[from];
+            ++versions[to];
+
+            liveFaces(to);
+            toNeighbours.clear();
+            for (int f : vertexFaces[to])
+            {
+                for (int v : faces[f].v)
+                {
+                    if (v != to) toNeighbours.push_back(v);
+                }
+            }
+            std::sort(toNeighbours.begin(), toNeighbours.end());
+            toNeighbours.erase(std::unique(toNeighbours.begin(), toNeighbours.end()), toNeighbours.end());
+            for (int v : toNeighbours)
+            {
+                push(v, to);
+                push(to, v);
+            }
+        }
+
+        void Simplifier::Simplify(size_t targetFaces, float& error)
+        {
+            while (faceCount > targetFaces && !queue.empty())
+            {
+                const Collapse next = queue.top();
+                queue.pop();
+                if (next.fromVersion != versions[next.from] || next.toVersion != versions[next.to]) continue;
+                if (!canCollapse(next.from, next.to)) continue;
+                // Root mean square distance over the area the two vertices stand for
+                const double area = std::max(areas[next.from] + areas[next.to], 1e-20);
+                error = std::max(error, static_cast<float>(std::sqrt(next.cost / area)));
+                collapse(next.from, next.to);
+            }
+        }
+
+        MeshLod Simplifier::Extract(const Mesh& source, float error) const
+        {
+            std::vector<int> vertexIds(positions.size(), -1);
+            std::unordered_map<int, int> textureCoordIds;
+            std::vector<slib::vec3> vertices, normals;
+            std::vector<slib::vec2> textureCoords;
+            std::vector<slib::tri> tris;
+            tris.reserve(faceCount);
+            const bool hasNormals = source.HasNormals();
+            for (const auto& face : faces)
+            {
+                if (!face.alive) continue;
+                int v[3], vt[3];
+                for (int c = 0; c < 3; ++c)
+                {
+                    int& id = vertexIds[face.v[c]];
+                    if (id < 0)
+                    {
+                        id = static_cast<int>(vertices.size());
+                        vertices.push_back(positions[face.v[c]]);
+                        if (hasNormals) normals.push_back(source.Normal(face.v[c]));
+                    }
+                    v[c] = id;
+                    vt[c] = -1;
+                    if (face.vt[c] < 0) continue;
+                    const auto [it, added] =
+                        textureCoordIds.try_emplace(face.vt[c], static_cast<int>(textureCoords.size()));
+                    if (added) textureCoords.push_back(source.TextureCoord(face.vt[c]));
+                    vt[c] = it->second;
+                }
+                tris.push_back({v[0], v[1], v[2], vt[0], vt[1], vt[2], face.material});
+            }
+
+            auto mesh = std::make_shared<Mesh>(
+                std::move(vertices),
+                std::move(tris),
+                std::move(textureCoords),
+                std::move(normals),
+                source.materials);
+            if (source.atlas) mesh->SetAtlas(source.atlasTileSize);
+            mesh->boundsCenter = source.boundsCenter;
+            mesh->boundsRadius = source.boundsRadius;
+            return {std::move(mesh), error};
+        }
+    } // namespace
+
+    std::vector<MeshLod> GenerateLods(const Mesh& mesh, int maxLevels)
+    {
+        std::vector<MeshLod> lods;
+        if (maxLevels <= 0 || mesh.faces.size() < 2 * MIN_LOD_FACES) return lods;
+
+        Simplifier simplifier(mesh);
+        float error = 0;
+        for (int level = 0; level < maxLevels; ++level)
+        {
+            const size_t faces = simplifier.FaceCount();
+            if (faces / 2 < MIN_LOD_FACES) break;
+            simplifier.Simplify(faces / 2, error);
+            // Seams and borders can leave too little to collapse for another level to be worth drawing
+            if (simplifier.FaceCount() > faces * 3 / 4) break;
+            lods.push_back(simplifier.Extract(mesh, error));
+        }
+        return lods;
+    }
+} // namespace soft3d
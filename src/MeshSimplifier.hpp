@@ -0,0 +1,20 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include "Mesh.hpp"
+#include <vector>
+
+namespace soft3d
+{
+    /*
+     * Builds up to 'maxLevels' simplified versions of the mesh (for Mesh::lods), each with about half the faces
+     * of the one before, by collapsing the edges whose quadric error (Garland-Heckbert, area weighted) is
+     * lowest. A vertex only collapses onto a neighbour that continues its UV seams, material boundaries and open
+     * borders, so textures stay attached and the outline keeps its shape. Stops early once the mesh cannot be
+     * halved any more.
+     */
+    std::vector<MeshLod> GenerateLods(const Mesh& mesh, int maxLevels);
+} // namespace soft3d
@@ -3,41 +3,37 @@
 //
 
 #include "ObjParser.hpp"
+#include "AssetRegistry.hpp"
 #include "constants.hpp"
-#include "lodepng.h"
+#include "JobSystem.hpp"
+#include "MappedFile.hpp"
+#include "MeshCache.hpp"
+#include "MeshSimplifier.hpp"
 #include "smath.hpp"
+#include "TextureLoader.hpp"
 #include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <regex>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 
-slib::texture DecodePng(const char* filename)
+/*
+ * A texture map named by an mtl file. Maps are loaded together once every library has been parsed, so that
+ * duplicates are only decoded once and the rest are decoded in parallel.
+ */
+struct TextureSlot
 {
-    std::vector<unsigned char> buffer;
-    std::vector<unsigned char> image; // the raw pixels
-    lodepng::load_file(buffer, filename);
-    unsigned width, height;
-
-    lodepng::State state;
-
-    // decode
-    unsigned error = lodepng::decode(image, width, height, state, buffer);
-    const LodePNGColorMode& color = state.info_png.color;
-    auto bpp = lodepng_get_bpp(&color);
-    // if there's an error, display it
-    if (error)
-    {
-        std::cout << "decoder error " << error << ": " << lodepng_error_text(error) << std::endl;
-        exit(1);
-    }
-
-    // the pixels are now in the vector "image", 4 bytes per pixel, ordered RGBARGBA..., use it as texture, draw
-    // it, ...
-    return {static_cast<int>(width), static_cast<int>(height), image, 4};
-}
+    size_t material;
+    std::shared_ptr<const slib::texture> slib::material::*map;
+    std::string path;
+};
 
 std::string trim(const std::string& input)
 {
@@ -54,36 +50,124 @@ std::string trim(const std::string& input)
 
 struct tri_tmp
 {
-    const int v1, v2, v3;
-    const int vt1, vt2, vt3;
-    const int vn1, vn2, vn3;
-    const std::string material;
+    int v1, v2, v3;
+    int vt1, vt2, vt3;
+    int vn1, vn2, vn3;
+    int material;
 };
 
+inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* skipBlanks(const char* p, const char* end)
+{
+    while (p < end && isBlank(*p))
+        ++p;
+    return p;
+}
+
+// std::from_chars does not accept a leading '+'. Leaves 'value' untouched if there is no number at 'p'.
+inline const char* parseFloat(const char* p, const char* end, float& value)
+{
+    p = skipBlanks(p, end);
+    if (p < end && *p == '+') ++p;
+    return std::from_chars(p, end, value).ptr;
+}
+
+inline const char* parseInt(const char* p, const char* end, int& value)
+{
+    if (p < end && *p == '+') ++p;
+    return std::from_chars(p, end, value).ptr;
+}
+
+// The rest of the line with surrounding whitespace removed.
+inline std::string_view lineArgument(const char* p, const char* end)
+{
+    p = skipBlanks(p, end);
+    while (end > p && isBlank(end[-1]))
+        --end;
+    return {p, static_cast<size_t>(end - p)};
+}
+
 std::array<float, 3> parseVectorLine(const std::string& input)
 {
-    std::stringstream ss(input);
     std::array<float, 3> arr{};
+    const char* p = input.data();
+    const char* end = p + input.size();
+    for (float& f : arr)
+        p = parseFloat(p, end, f);
+    return arr;
+}
+
+/*
+ * Parses the options that may precede the file name of a texture map (e.g. "map_Kd -clamp on texture.png").
+ * Supported: -clamp on|off (standard), -mirror on|off and -filter nearest|linear (extensions). Any other option
+ * and its numeric/on/off arguments are skipped.
+ * Returns the file name.
+ */
+std::string parseTextureOptions(const std::string& input, slib::sampler& sampler)
+{
+    std::stringstream ss(input);
+    std::vector<std::string> tokens;
     std::string token;
-    int i = 0;
-    while (std::getline(ss, token, ' '))
+    while (ss >> token)
+        tokens.push_back(token);
+
+    auto isArgument = [](const std::string& arg) {
+        return arg == "on" || arg == "off" || arg.find_first_not_of("+-.0123456789") == std::string::npos;
+    };
+
+    size_t i = 0;
+    while (i < tokens.size() && tokens[i][0] == '-')
     {
-        arr.at(i++) = std::stof(token);
+        const std::string& option = tokens[i++];
+        if (i >= tokens.size()) break;
+        if (option == "-clamp")
+        {
+            if (tokens[i++] == "on") sampler.addressMode = slib::CLAMP;
+        }
+        else if (option == "-mirror")
+        {
+            if (tokens[i++] == "on") sampler.addressMode = slib::MIRROR;
+        }
+        else if (option == "-filter")
+        {
+            const std::string& filter = tokens[i++];
+            if (filter == "nearest")
+                sampler.filter = slib::FILTER_NEAREST;
+            else if (filter == "linear")
+                sampler.filter = slib::FILTER_LINEAR;
+        }
+        else
+        {
+            // Leave at least one token for the file name
+            while (i + 1 < tokens.size() && isArgument(tokens[i]))
+                ++i;
+        }
     }
-    return arr;
+
+    std::string path;
+    for (; i < tokens.size(); ++i)
+    {
+        if (!path.empty()) path += ' ';
+        path += tokens[i];
+    }
+    return path;
 }
 
-std::map<std::string, slib::material> parseMtlFile(const char* path)
+// Empty (and 'error') if the file cannot be opened.
+std::vector<slib::material> parseMtlFile(const char* path, std::vector<TextureSlot>& textures, std::string& error)
 {
     std::ifstream mtl(path);
     if (!mtl.is_open())
     {
-        std::cout << "Failed to open materials file" << std::endl;
-        exit(1);
+        error = std::string("could not open materials file ") + path;
+        return {};
     }
 
-    std::map<std::string, slib::material> toReturn;
-    std::string materialKey;
+    std::vector<slib::material> toReturn;
     std::string line;
     slib::material material{};
 
@@ -93,30 +177,30 @@ std::map<std::string, slib::material> parseMtlFile(const char* path)
         if (line[0] == '#') continue;
         if (line.find("newmtl") != std::string::npos)
         {
-            if (!materialKey.empty()) // Store the previous material
+            if (!material.name.empty()) // Store the previous material
             {
-                toReturn.insert({materialKey, material});
+                toReturn.push_back(std::move(material));
                 material = {};
             }
-            materialKey = line.substr(line.find("newmtl") + std::string("newmtl ").length());
+            material.name = line.substr(line.find("newmtl") + std::string("newmtl ").length());
         }
         else if (line.find("map_Kd") != std::string::npos)
         {
-            std::string mtlPath = line.substr(line.find("map_Kd") + std::string("map_Kd ").length());
-            material.map_Kd = DecodePng(std::string(RES_PATH + mtlPath).c_str());
-            ;
+            std::string mtlPath = parseTextureOptions(
+                line.substr(line.find("map_Kd") + std::string("map_Kd ").length()), material.texSampler);
+            textures.push_back({toReturn.size(), &slib::material::map_Kd, RES_PATH + mtlPath});
         }
         else if (line.find("map_Ks") != std::string::npos)
         {
-            std::string mtlPath = line.substr(line.find("map_Ks") + std::string("map_Ks ").length());
-            material.map_Ks = DecodePng(std::string(RES_PATH + mtlPath).c_str());
-            ;
+            std::string mtlPath = parseTextureOptions(
+                line.substr(line.find("map_Ks") + std::string("map_Ks ").length()), material.texSampler);
+            textures.push_back({toReturn.size(), &slib::material::map_Ks, RES_PATH + mtlPath});
         }
         else if (line.find("map_Ns") != std::string::npos)
         {
-            std::string mtlPath = line.substr(line.find("map_Ns") + std::string("map_Ns ").length());
-            material.map_Ns = DecodePng(std::string(RES_PATH + mtlPath).c_str());
-            ;
+            std::string mtlPath = parseTextureOptions(
+                line.substr(line.find("map_Ns") + std::string("map_Ns ").length()), material.texSampler);
+            textures.push_back({toReturn.size(), &slib::material::map_Ns, RES_PATH + mtlPath});
         }
         else if (line.find("map_Disp") != std::string::npos)
         {
@@ -177,193 +261,489 @@ std::map<std::string, slib::material> parseMtlFile(const char* path)
         }
     }
 
-    toReturn.insert({materialKey, material});
+    toReturn.push_back(std::move(material));
 
     mtl.close();
     return toReturn;
 }
 
-slib::vec3 getVector(const std::string& line)
+/*
+ * Everything parsed from one line-aligned chunk of the obj file. Chunks are parsed in parallel and know nothing
+ * about each other, so anything that depends on earlier lines is recorded here and resolved while merging:
+ * - Face material ids are indices into 'materialNames' (-1: whatever material the previous chunk ended with).
+ * - Negative (relative) indices are stored as a 'fixup' against this chunk's element counts.
+ */
+struct ObjChunk
 {
-    std::array<float, 3> arr = parseVectorLine(line);
-    return {arr.at(0), arr.at(1), arr.at(2)};
-}
+    struct IndexFixup
+    {
+        int face;
+        int slot;  // 0-2: v, 3-5: vt, 6-8: vn
+        int index; // Relative to the start of this chunk (may be negative)
+    };
+
+    std::vector<slib::vec3> vertices;
+    std::vector<slib::vec2> textureCoords;
+    std::vector<slib::vec3> normals;
+    std::vector<tri_tmp> faces;
+    std::vector<std::string> materialNames;
+    std::vector<std::string> materialLibs;
+    std::vector<IndexFixup> fixups;
+    std::string error; // The first malformed face, if any; the chunk is not parsed past it
+};
+
+constexpr int tri_tmp::* triSlots[9] = {
+    &tri_tmp::v1,
+    &tri_tmp::v2,
+    &tri_tmp::v3,
+    &tri_tmp::vt1,
+    &tri_tmp::vt2,
+    &tri_tmp::vt3,
+    &tri_tmp::vn1,
+    &tri_tmp::vn2,
+    &tri_tmp::vn3};
 
-slib::vec2 getTextureVector(const std::string& line)
+struct FaceCorner
 {
-    std::array<float, 3> arr = parseVectorLine(line);
-    return {arr.at(0), arr.at(1)};
-}
+    int index[3];     // v, vt, vn (-1 if absent)
+    bool relative[3]; // Negative index in the file; 'index' is relative to the start of the chunk
+};
 
-tri_tmp getFace(const std::string& line, std::string material)
+/*
+ * Parses "f" lines with any number of corners in any of the v, v/vt, v//vn and v/vt/vn forms. Polygons are
+ * triangulated as a fan around the first corner. False if the line is malformed.
+ */
+bool parseFace(const char* p, const char* end, ObjChunk& chunk, int material, std::vector<FaceCorner>& corners)
 {
-    enum VertexFormat
+    corners.clear();
+    const int counts[3] = {
+        static_cast<int>(chunk.vertices.size()),
+        static_cast<int>(chunk.textureCoords.size()),
+        static_cast<int>(chunk.normals.size())};
+    bool anyRelative = false;
+
+    while ((p = skipBlanks(p, end)) < end)
     {
-        V,
-        V_VN,
-        V_VT_VN,
-        INVALID
-    };
+        FaceCorner corner{{-1, -1, -1}, {}};
+        for (int attribute = 0; attribute < 3; ++attribute)
+        {
+            if (attribute > 0)
+            {
+                if (p >= end || *p != '/') break;
+                ++p;
+                if (attribute == 1 && p < end && *p == '/') continue; // v//vn
+            }
+            int index = 0;
+            const char* next = parseInt(p, end, index);
+            if (next == p || index == 0) return false;
+            p = next;
+            corner.relative[attribute] = index < 0;
+            corner.index[attribute] = index > 0 ? index - 1 : counts[attribute] + index;
+            anyRelative |= index < 0;
+        }
+        if (p < end && !isBlank(*p)) return false;
+        corners.push_back(corner);
+    }
+    if (corners.size() < 3) return false;
 
-    std::string output = line;
-    output.erase(0, 2);
-    std::stringstream ss(output);
-    std::vector<int> vertices;
-    std::vector<int> textureCoords;
-    std::vector<int> normals;
-    std::string token;
+    for (size_t i = 1; i + 1 < corners.size(); ++i)
+    {
+        const FaceCorner* tri[3] = {&corners[0], &corners[i], &corners[i + 1]};
+        chunk.faces.push_back(
+            {tri[0]->index[0],
+             tri[1]->index[0],
+             tri[2]->index[0],
+             tri[0]->index[1],
+             tri[1]->index[1],
+             tri[2]->index[1],
+             tri[0]->index[2],
+             tri[1]->index[2],
+             tri[2]->index[2],
+             material});
+        if (!anyRelative) continue;
 
-    std::regex v_pattern(R"(^\d+ \d+ \d+\s*$)");
-    std::regex v_vn_pattern(R"(^\d+//\d+ \d+//\d+ \d+//\d+\s*$)");
-    std::regex v_vt_vn_pattern(R"(^\d+/\d+/\d+ \d+/\d+/\d+ \d+/\d+/\d+\s*$)");
+        for (int k = 0; k < 3; ++k)
+            for (int attribute = 0; attribute < 3; ++attribute)
+                if (tri[k]->relative[attribute])
+                    chunk.fixups.push_back(
+                        {static_cast<int>(chunk.faces.size() - 1), attribute * 3 + k, tri[k]->index[attribute]});
+    }
+    return true;
+}
 
-    VertexFormat format = INVALID;
-    if (std::regex_match(output, v_pattern))
-        format = V;
-    else if (std::regex_match(output, v_vn_pattern))
-        format = V_VN;
-    else if (std::regex_match(output, v_vt_vn_pattern))
-        format = V_VT_VN;
+void parseChunk(const char* p, const char* end, ObjChunk& chunk)
+{
+    std::vector<FaceCorner> corners;
+    int material = -1;
+    while (p < end)
+    {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!lineEnd) lineEnd = end;
+        const char* c = skipBlanks(p, lineEnd);
+        const auto length = lineEnd - c;
 
-    if (format == INVALID)
+        if (length >= 2 && c[0] == 'v' && isBlank(c[1]))
+        {
+            slib::vec3 v{};
+            const char* q = parseFloat(c + 2, lineEnd, v.x);
+            q = parseFloat(q, lineEnd, v.y);
+            parseFloat(q, lineEnd, v.z);
+            chunk.vertices.push_back(v);
+        }
+        else if (length >= 3 && c[0] == 'v' && c[1] == 't' && isBlank(c[2]))
+        {
+            slib::vec2 vt{};
+            const char* q = parseFloat(c + 3, lineEnd, vt.x);
+            parseFloat(q, lineEnd, vt.y);
+            chunk.textureCoords.push_back(vt);
+        }
+        else if (length >= 3 && c[0] == 'v' && c[1] == 'n' && isBlank(c[2]))
+        {
+            slib::vec3 vn{};
+            const char* q = parseFloat(c + 3, lineEnd, vn.x);
+            q = parseFloat(q, lineEnd, vn.y);
+            parseFloat(q, lineEnd, vn.z);
+            chunk.normals.push_back(vn);
+        }
+        else if (length >= 2 && c[0] == 'f' && isBlank(c[1]))
+        {
+            if (!parseFace(c + 2, lineEnd, chunk, material, corners))
+            {
+                chunk.error = "malformed face: " + std::string(c, lineEnd);
+                return;
+            }
+        }
+        else if (length > 7 && std::string_view(c, 6) == "usemtl" && isBlank(c[6]))
+        {
+            chunk.materialNames.emplace_back(lineArgument(c + 7, lineEnd));
+            material = static_cast<int>(chunk.materialNames.size()) - 1;
+        }
+        else if (length > 7 && std::string_view(c, 6) == "mtllib" && isBlank(c[6]))
+        {
+            chunk.materialLibs.emplace_back(lineArgument(c + 7, lineEnd));
+        }
+        p = lineEnd + 1;
+    }
+}
+
+// Splits [data, data + size) into roughly equal chunks that start at the beginning of a line.
+std::vector<std::pair<const char*, const char*>> splitLines(const char* data, size_t size, int count)
+{
+    std::vector<std::pair<const char*, const char*>> chunks;
+    const char* end = data + size;
+    const char* start = data;
+    for (int i = 1; i <= count && start < end; ++i)
     {
-        std::cout << "Error. Failed to parse faces in obj file." << '\n';
-        std::cout << "Face string: " << output << std::endl;
-        exit(1);
+        const char* split = i == count ? end : data + size * i / count;
+        if (split < start) continue;
+        split = static_cast<const char*>(std::memchr(split, '\n', end - split));
+        split = split ? split + 1 : end;
+        chunks.emplace_back(start, split);
+        start = split;
     }
+    return chunks;
+}
 
-    while (std::getline(ss, token, ' '))
+// A map that fails to load is reported and left empty; the material is then drawn with its flat colour.
+void loadTextureMaps(
+    std::vector<slib::material>& materials,
+    const std::vector<TextureSlot>& textures,
+    const ObjParser::Options& options)
+{
+    const bool streamed = options.virtualTextures && options.assets && options.atlasTileSize <= 0;
+    std::vector<soft3d::TextureRequest> requests;
+    std::vector<const TextureSlot*> slots;
+    requests.reserve(textures.size());
+    for (const auto& slot : textures)
     {
-        switch (format)
-        {
-        case V:
-            vertices.push_back(std::stoi(token) - 1);
-            break;
-        case V_VN:
-            vertices.push_back(std::stoi(token.substr(0, token.find("//"))) - 1);
-            normals.push_back(std::stoi(token.substr(token.find("//") + 2)) - 1);
-            break;
-        case V_VT_VN:
-            vertices.push_back(std::stoi(token.substr(0, token.find('/'))) - 1);
-            token.erase(0, token.find('/') + 1);
-            textureCoords.push_back(std::stoi(token.substr(0, token.find('/'))) - 1);
-            token.erase(0, token.find('/') + 1);
-            normals.push_back(std::stoi(token) - 1);
+        if (streamed && slot.map == &slib::material::map_Kd)
+        {
+            std::string error;
+            auto texture = options.assets->VirtualTextures().Open(slot.path, error);
+            if (texture)
+                materials[slot.material].virtual_Kd = std::move(texture);
+            else
+                std::cout << "Warning: could not load texture " << slot.path << " (" << error << ")" << std::endl;
+            continue;
         }
+        requests.push_back({slot.path, options.compressTextures ? slib::BC1 : slib::RGBA8});
+        slots.push_back(&slot);
     }
 
-    switch (format)
+    const auto loaded = options.assets ? options.assets->LoadTextures(requests, options.cacheTextures)
+                                       : soft3d::LoadTextures(requests, options.cacheTextures);
+    for (size_t i = 0; i < slots.size(); ++i)
     {
-    case V:
-        return {vertices.at(0), vertices.at(1), vertices.at(2), -1, -1, -1, -1, -1, -1, ""};
-    case V_VN:
-        return {
-            vertices.at(0),
-            vertices.at(1),
-            vertices.at(2),
-            -1,
-            -1,
-            -1,
-            normals.at(0),
-            normals.at(1),
-            normals.at(2),
-            ""};
-    case V_VT_VN:
-        return {
-            vertices.at(0),
-            vertices.at(1),
-            vertices.at(2),
-            textureCoords.at(0),
-            textureCoords.at(1),
-            textureCoords.at(2),
-            normals.at(0),
-            normals.at(1),
-            normals.at(2),
-            std::move(material)};
+        if (!loaded[i].texture)
+        {
+            std::cout << "Warning: could not load texture " << slots[i]->path << " (" << loaded[i].error << ")"
+                      << std::endl;
+            continue;
+        }
+        materials[slots[i]->material].*slots[i]->map = loaded[i].texture;
     }
 }
 
-namespace ObjParser
+/*
+ * Loads the materials of every library, in order; a later definition of a name wins. Falls back to a single grey
+ * material so that faces always index a valid one. 'materialIds' (optional) receives the name -> id map.
+ * Empty (and 'error') if a library cannot be opened.
+ */
+std::vector<slib::material> loadMaterials(
+    const std::vector<std::string>& libs,
+    const ObjParser::Options& options,
+    std::unordered_map<std::string, int>* materialIds,
+    std::string& error)
 {
-    soft3d::Mesh ParseObj(const char* objPath)
+    std::vector<slib::material> materials;
+    std::vector<TextureSlot> textures;
+    for (const auto& lib : libs)
     {
-        std::ifstream obj(objPath);
-        if (!obj.is_open())
+        const size_t firstTexture = textures.size();
+        auto libMaterials = parseMtlFile((RES_PATH + lib).c_str(), textures, error);
+        if (!error.empty()) return {};
+        for (size_t i = firstTexture; i < textures.size(); ++i)
+            textures[i].material += materials.size();
+        for (auto& material : libMaterials)
         {
-            std::cout << "Failed to open file" << std::endl;
-            exit(1);
+            if (materialIds) (*materialIds)[material.name] = static_cast<int>(materials.size());
+            materials.push_back(std::move(material));
         }
+    }
+    if (options.loadTextures) loadTextureMaps(materials, textures, options);
+    if (materials.empty())
+    {
+        slib::material fallback{};
+        fallback.name = "default";
+        fallback.Kd = {0.8f, 0.8f, 0.8f};
+        materials.push_back(fallback);
+    }
+    return materials;
+}
 
-        std::map<std::string, slib::material> materials;
-        std::string currentTextureName;
-        std::vector<slib::vec3> vertices;
-        std::vector<slib::vec3> normals; // Normals stored at same index as the corresponding vertex
-        std::vector<slib::vec2> textureCoords;
-        std::vector<slib::vec3> raw_normals; // The normals as listed in the obj file
-        std::vector<tri_tmp> raw_faces;      // faces with normal data
-        std::vector<slib::tri> faces;        // faces stripped of normal data
-        std::string line;
+// Content hash of the obj file and the mtl libraries it uses (identifies the source of a mesh cache).
+uint64_t sourceHash(const soft3d::MappedFile& obj, const std::vector<std::string>& libs)
+{
+    uint64_t hash = soft3d::HashBytes(obj.Data(), obj.Size(), soft3d::MESH_CACHE_VERSION);
+    for (const auto& lib : libs)
+    {
+        const soft3d::MappedFile mtl((RES_PATH + lib).c_str());
+        hash = soft3d::HashBytes(lib.data(), lib.size(), hash);
+        hash = soft3d::HashBytes(mtl.Data(), mtl.Size(), hash);
+    }
+    return hash;
+}
+
+void reportProgress(const ObjParser::Options& options, float progress)
+{
+    if (options.progress) options.progress->store(progress, std::memory_order_relaxed);
+}
 
-        while (getline(obj, line))
+// Uses the mesh cache in place if it is up to date with the obj/mtl files and its indices are valid. Sets
+// 'error' if its materials cannot be loaded.
+std::optional<soft3d::Mesh> loadCachedMesh(
+    const soft3d::MappedFile& obj,
+    const std::string& cachePath,
+    const ObjParser::Options& options,
+    std::string& error)
+{
+    auto cache = soft3d::OpenMeshCache(cachePath.c_str());
+    if (!cache || cache->sourceHash != sourceHash(obj, cache->materialLibs)) return std::nullopt;
+    if (!cache->normals.empty() && cache->normals.size() != cache->vertices.size()) return std::nullopt;
+    reportProgress(options, 0.3f);
+
+    auto materials = loadMaterials(cache->materialLibs, options, nullptr, error);
+    if (!error.empty()) return std::nullopt;
+    reportProgress(options, 0.9f);
+    const int vertexCount = static_cast<int>(cache->vertices.size());
+    const int textureCoordCount = static_cast<int>(cache->textureCoords.size());
+    const int materialCount = static_cast<int>(materials.size());
+    const auto& faces = cache->faces;
+    std::atomic<bool> valid = true;
+    soft3d::JobSystem::Get().ParallelForRange(0, static_cast<int>(faces.size()), [&](int first, int last) {
+        bool rangeValid = true;
+        for (int i = first; i < last; ++i)
         {
-            line = trim(line);
-            if (line.size() < 2) continue;
-            if (line[0] == '#') continue;
+            const auto& t = faces[i];
+            for (int v : {t.v1, t.v2, t.v3})
+                rangeValid = rangeValid && v >= 0 && v < vertexCount;
+            for (int vt : {t.vt1, t.vt2, t.vt3})
+                rangeValid = rangeValid && vt >= -1 && vt < textureCoordCount;
+            rangeValid = rangeValid && t.material >= 0 && t.material < materialCount;
+        }
+        if (!rangeValid) valid = false;
+    });
+    if (!valid) return std::nullopt;
 
-            if (line.substr(0, 2) == "v ")
-            {
-                vertices.push_back(getVector(line.erase(0, 2)));
-            }
-            else if (line.substr(0, 2) == "f ")
-            {
-                raw_faces.push_back(getFace(line, currentTextureName));
-            }
-            else if (line.substr(0, 2) == "vt")
-            {
-                textureCoords.push_back(getTextureVector(line.erase(0, 3)));
-            }
-            else if (line.substr(0, 2) == "vn")
-            {
-                raw_normals.push_back(getVector(line.erase(0, 3)));
-            }
-            else if (line.find("usemtl") != std::string::npos)
-            {
-                currentTextureName = line.substr(line.find("usemtl") + std::string("usemtl ").length());
-            }
-            else if (line.find("mtllib") != std::string::npos)
+    reportProgress(options, 1);
+    return soft3d::Mesh(
+        cache->vertices, cache->faces, cache->textureCoords, cache->normals, std::move(materials), cache->file);
+}
+
+namespace ObjParser
+{
+    std::optional<soft3d::Mesh> ParseObj(const char* objPath, const Options& options, std::string& error)
+    {
+        const soft3d::MappedFile obj(objPath);
+        if (!obj.IsOpen())
+        {
+            error = std::string("could not open ") + objPath;
+            return std::nullopt;
+        }
+
+        const std::string cachePath = std::string(objPath) + ".mesh";
+        if (options.useMeshCache)
+        {
+            auto mesh = loadCachedMesh(obj, cachePath, options, error);
+            if (!error.empty()) return std::nullopt;
+            if (mesh)
             {
-                auto path =
-                    std::string(RES_PATH + line.substr(line.find("mtllib") + std::string("mtllib ").length()));
-                materials = parseMtlFile(path.c_str());
+                if (options.atlasTileSize > 0) mesh->SetAtlas(options.atlasTileSize);
+                mesh->lods = soft3d::GenerateLods(*mesh, options.lodLevels);
+                return mesh;
             }
         }
 
-        // Get the vertex normals of each triangle and store them in the 'normals' vector at the same index as in
-        // the 'vertices' vector.
-        normals.resize(vertices.size());
-        faces.reserve(raw_faces.size());
+        // Parse line-aligned chunks in parallel. Small files are not worth splitting.
+        constexpr size_t minChunkSize = 64 * 1024;
+        auto& jobs = soft3d::JobSystem::Get();
+        const int chunkCount = static_cast<int>(
+            std::clamp<size_t>(obj.Size() / minChunkSize, 1, static_cast<size_t>(jobs.ThreadCount()) * 4));
+        const auto ranges = splitLines(obj.Data(), obj.Size(), chunkCount);
+        std::vector<ObjChunk> chunks(ranges.size());
+        jobs.ParallelFor(
+            0,
+            static_cast<int>(ranges.size()),
+            [&](int i) { parseChunk(ranges[i].first, ranges[i].second, chunks[i]); },
+            1);
+        for (const auto& chunk : chunks)
+        {
+            if (chunk.error.empty()) continue;
+            error = chunk.error + " in " + objPath;
+            return std::nullopt;
+        }
+        reportProgress(options, 0.4f);
+
+        // Materials
+        std::vector<std::string> materialLibs;
+        for (const auto& chunk : chunks)
+            materialLibs.insert(materialLibs.end(), chunk.materialLibs.begin(), chunk.materialLibs.end());
+        std::unordered_map<std::string, int> materialIds; // Material names are only used while parsing
+        std::vector<slib::material> materials = loadMaterials(materialLibs, options, &materialIds, error);
+        if (!error.empty()) return std::nullopt;
+        reportProgress(options, 0.8f);
 
-#pragma omp parallel for default(none) shared(raw_faces, normals, raw_normals, faces)
-        for (const tri_tmp& tri : raw_faces)
+        // Offsets of each chunk's elements in the merged arrays
+        std::vector<std::array<int, 4>> bases(chunks.size() + 1); // vertices, textureCoords, normals, faces
+        for (size_t i = 0; i < chunks.size(); ++i)
         {
-            auto n1 = raw_normals[tri.vn1];
-            auto n2 = raw_normals[tri.vn2];
-            auto n3 = raw_normals[tri.vn3];
-            normals[tri.v1] = n1;
-            normals[tri.v2] = n2;
-            normals[tri.v3] = n3;
+            bases[i + 1] = {
+                bases[i][0] + static_cast<int>(chunks[i].vertices.size()),
+                bases[i][1] + static_cast<int>(chunks[i].textureCoords.size()),
+                bases[i][2] + static_cast<int>(chunks[i].normals.size()),
+                bases[i][3] + static_cast<int>(chunks[i].faces.size())};
         }
-#pragma omp barrier
+        const auto& totals = bases.back();
 
-        // Strip normal indices from faces (should now be accessed using the 'v1' (etc.) index with the normals
-        // vector)
-        for (const tri_tmp& t : raw_faces)
+        // Resolve each chunk's material names, carrying the current material across chunk boundaries
+        std::vector<int> startMaterial(chunks.size());
+        std::vector<std::vector<int>> chunkMaterialIds(chunks.size());
+        int currentMaterial = 0;
+        for (size_t i = 0; i < chunks.size(); ++i)
         {
-            slib::tri toPush = {t.v1, t.v2, t.v3, t.vt1, t.vt2, t.vt3, t.material};
-            faces.push_back(toPush);
+            startMaterial[i] = currentMaterial;
+            for (const auto& name : chunks[i].materialNames)
+            {
+                const auto it = materialIds.find(name);
+                if (it == materialIds.end())
+                {
+                    std::cout << "Warning: unknown material '" << name << "'. Falling back to the first material."
+                              << std::endl;
+                    currentMaterial = 0;
+                }
+                else
+                {
+                    currentMaterial = it->second;
+                }
+                chunkMaterialIds[i].push_back(currentMaterial);
+            }
         }
 
-        obj.close();
-        return {vertices, faces, textureCoords, normals, materials};
+        std::vector<slib::vec3> vertices(totals[0]);
+        std::vector<slib::vec2> textureCoords(totals[1]);
+        std::vector<slib::vec3> raw_normals(totals[2]); // The normals as listed in the obj file
+        std::vector<tri_tmp> raw_faces(totals[3]);      // faces with normal data
+        std::atomic<bool> validIndices = true;
+
+        jobs.ParallelFor(
+            0,
+            static_cast<int>(chunks.size()),
+            [&](int i) {
+                auto& chunk = chunks[i];
+                const auto& base = bases[i];
+                std::copy(chunk.vertices.begin(), chunk.vertices.end(), vertices.begin() + base[0]);
+                std::copy(
+                    chunk.textureCoords.begin(), chunk.textureCoords.end(), textureCoords.begin() + base[1]);
+                std::copy(chunk.normals.begin(), chunk.normals.end(), raw_normals.begin() + base[2]);
+                for (const auto& fixup : chunk.fixups)
+                    chunk.faces[fixup.face].*triSlots[fixup.slot] = base[fixup.slot / 3] + fixup.index;
+
+                for (size_t f = 0; f < chunk.faces.size(); ++f)
+                {
+                    tri_tmp tri = chunk.faces[f];
+                    tri.material = tri.material < 0 ? startMaterial[i] : chunkMaterialIds[i][tri.material];
+                    for (int slot = 0; slot < 9; ++slot)
+                    {
+                        const int index = tri.*triSlots[slot];
+                        if (index < -1 || index >= totals[slot / 3] || (slot < 3 && index < 0))
+                            validIndices = false;
+                    }
+                    raw_faces[base[3] + f] = tri;
+                }
+            },
+            1);
+        if (!validIndices)
+        {
+            error = std::string("face index out of range in ") + objPath;
+            return std::nullopt;
+        }
+
+        // Get the vertex normals of each triangle and store them in the 'normals' vector at the same index as in
+        // the 'vertices' vector. Meshes without normal data keep an empty 'normals' vector.
+        std::vector<slib::vec3> normals; // Normals stored at same index as the corresponding vertex
+        if (!raw_normals.empty()) normals.resize(vertices.size());
+        std::vector<slib::tri> faces(raw_faces.size()); // faces stripped of normal data
+
+        jobs.ParallelFor(0, static_cast<int>(raw_faces.size()), [&](int i) {
+            const tri_tmp& t = raw_faces[i];
+            if (!raw_normals.empty())
+            {
+                if (t.vn1 >= 0) normals[t.v1] = raw_normals[t.vn1];
+                if (t.vn2 >= 0) normals[t.v2] = raw_normals[t.vn2];
+                if (t.vn3 >= 0) normals[t.v3] = raw_normals[t.vn3];
+            }
+            // Strip normal indices from faces (should now be accessed using the 'v1' (etc.) index with the
+            // normals vector)
+            faces[i] = {t.v1, t.v2, t.v3, t.vt1, t.vt2, t.vt3, t.material};
+        });
+
+        soft3d::Mesh mesh(
+            std::move(vertices),
+            std::move(faces),
+            std::move(textureCoords),
+            std::move(normals),
+            std::move(materials));
+        if (options.useMeshCache)
+            soft3d::SaveMeshCache(cachePath.c_str(), sourceHash(obj, materialLibs), materialLibs, mesh);
+        if (options.atlasTileSize > 0) mesh.SetAtlas(options.atlasTileSize);
+        mesh.lods = soft3d::GenerateLods(mesh, options.lodLevels);
+        reportProgress(options, 1);
+        return mesh;
+    }
+
+    std::vector<slib::material> LoadMaterials(
+        const std::vector<std::string>& libs, const Options& options, std::string& error)
+    {
+        return loadMaterials(libs, options, nullptr, error);
     }
 } // namespace ObjParser
\ No newline at end of file
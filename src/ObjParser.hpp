@@ -3,13 +3,44 @@
 //
 
 #pragma once
+#include <atomic>
 #include <vector>
 #include <array>
+#include <optional>
+#include <string>
 #include "slib.hpp"
 #include "Mesh.hpp"
 
+namespace soft3d
+{
+    class AssetRegistry;
+}
 
 namespace ObjParser
 {
-    soft3d::Mesh ParseObj(const char* objPath);
+    struct Options
+    {
+        bool compressTextures = false; // Store textures block-compressed (BC1). Lossy, but 8x smaller.
+        // Write the decoded (or compressed) pixels next to the png, for later loads to read instead of decoding.
+        // Off by default so that loading never writes into the asset tree; bake_assets turns it on.
+        bool cacheTextures = false;
+        bool loadTextures = true; // False: materials are parsed but their texture maps are left empty
+        bool useMeshCache = true; // Map the binary cache ("<obj>.mesh") if it is up to date, else write one
+        int atlasTileSize = 0; // > 0: the textures are atlases of tiles this size (see Mesh::SetAtlas)
+        int lodLevels = 0; // > 0: simplify the mesh into up to this many levels of detail (Mesh::lods)
+        std::atomic<float>* progress = nullptr; // Advanced towards 1 as the model loads (for loading screens)
+        soft3d::AssetRegistry* assets = nullptr; // Reuse textures that other meshes in the registry have loaded
+        // Stream the diffuse maps in pages (slib::material::virtual_Kd) from the registry's virtual texture pool
+        // instead of loading them whole. Needs 'assets'; ignored for atlases.
+        bool virtualTextures = false;
+    };
+
+    // std::nullopt (and 'error') if the obj file or one of its mtl libraries cannot be opened, or a face is
+    // malformed or indexes past the data. Safe to call from loader threads: a bad file never ends the process.
+    std::optional<soft3d::Mesh> ParseObj(const char* objPath, const Options& options, std::string& error);
+    // Loads the materials of the mtl libraries (paths relative to RES_PATH), in order, with their texture maps as
+    // ParseObj would. Never empty unless a library cannot be opened ('error'): a grey default material stands in
+    // for none.
+    std::vector<slib::material> LoadMaterials(
+        const std::vector<std::string>& libs, const Options& options, std::string& error);
 };
\ No newline at end of file
@@ -14,174 +14,188 @@ namespace soft3d
 
     inline void bufferPixels(SDL_Surface* surface, int x, int y, unsigned char r, unsigned char g, unsigned char b)
     {
-        auto* pixels = (unsigned char*)surface->pixels;
-        pixels[4 * (y * surface->w + x) + 0] = b;
-        pixels[4 * (y * surface->w + x) + 1] = g;
-        pixels[4 * (y * surface->w + x) + 2] = r;
-        pixels[4 * (y * surface->w + x) + 3] = 255;
+        auto* pixel = (unsigned char*)surface->pixels + y * surface->pitch + 4 * x;
+        pixel[0] = b;
+        pixel[1] = g;
+        pixel[2] = r;
+        pixel[3] = 255;
     }
 
-    // GL_NEAREST
-    inline void texNearestNeighbour(
-        const slib::texture& texture, float lum, float uvx, float uvy, int& r, int& g, int& b)
+    // A pixel already packed as bufferPixels writes it.
+    inline void bufferPixel(SDL_Surface* surface, int x, int y, uint32_t colour)
     {
-        // Convert to texture space
-        auto tx = static_cast<int>(uvx * texture.w);
-        auto ty = static_cast<int>(uvy * texture.h);
-
-        // Grab the corresponding pixel color on the texture
-        int index = (ty * texture.w + tx) * texture.bpp;
-
-        if (lum > 1)
-        {
-            r = std::max(0, std::min(static_cast<int>(texture.data[index] * lum), 255));
-            g = std::max(0, std::min(static_cast<int>(texture.data[index + 1] * lum), 255));
-            b = std::max(0, std::min(static_cast<int>(texture.data[index + 2] * lum), 255));
-            return;
-        }
-
-        r = texture.data[index];
-        g = texture.data[index + 1];
-        b = texture.data[index + 2];
+        auto* row = (unsigned char*)surface->pixels + y * surface->pitch;
+        reinterpret_cast<uint32_t*>(row)[x] = colour;
     }
-    // GL_LINEAR
-    inline void texBilinear(
-        const slib::texture& texture,
-        bool textureAtlas,
-        int tileSize,
-        float lum,
-        float uvx,
-        float uvy,
-        int& r,
-        int& g,
-        int& b)
+
+    /*
+     * Accumulates one light's diffuse term into 'lum' and, if 'view' is set, its Blinn-Phong specular term into
+     * 'spec'. Lights are white; 'intensity' scales the diffuse term only (specular is capped at 1 per light).
+     */
+    inline void Rasterizer::addLight(
+        const Light& light,
+        const slib::vec3& normal,
+        const slib::vec3& position,
+        const slib::vec3* view,
+        float& lum,
+        float& spec) const
     {
-        float tx = uvx * texture.w;
-        float ty = uvy * texture.h;
+        slib::vec3 L{};
+        const float attenuation = lightAttenuation(light, position, L);
+        if (attenuation <= 0) return;
+        const float nl = smath::dot(normal, L);
+        if (nl <= 0) return; // Light is behind the surface
+        lum += light.intensity * attenuation * nl;
+
+        if (!view) return;
+        const float nh = smath::dot(normal, smath::fastNormalize(L + *view));
+        if (nh <= 0) return;
+        spec += attenuation * std::min(light.intensity, 1.0f) *
+                materialConstants.specularLut[static_cast<int>(std::min(nh, 1.0f) * (SPECULAR_LUT_SIZE - 1))];
+    }
 
-        int left = static_cast<int>(tx);
-        int top = static_cast<int>(ty);
-        int right = left + 1;
-        int bottom = top + 1;
+    // Sums every directional light plus the point/spot lights assigned to the pixel's tile.
+    inline void Rasterizer::shade(
+        const slib::vec3& normal,
+        const slib::vec3& position,
+        int x,
+        int y,
+        bool specular,
+        float& lum,
+        float& spec) const
+    {
+        const auto& lights = *lightGrid.lights;
+        slib::vec3 view{};
+        if (specular) view = smath::fastNormalize(viewPosition - position);
+        const slib::vec3* viewPtr = specular ? &view : nullptr;
+
+        lum = 0;
+        spec = 0;
+        for (const uint16_t index : lightGrid.globalLights)
+            addLight(lights[index], normal, position, viewPtr, lum, spec);
+        if (!lightGrid.HasLocalLights()) return;
+        const auto& tile = lightGrid.TileAt(x, y);
+        for (int i = 0; i < tile.count; ++i)
+            addLight(lights[tile.lights[i]], normal, position, viewPtr, lum, spec);
+    }
 
-        // If the texture uses an atlas, we need to ensure the pixels being sampled do not exceed the current
-        // tile's bounds
-        if (textureAtlas)
+    // Adds the accumulated specular highlight, scaled by the material's Ks (and map_Ks if present).
+    inline void Rasterizer::applySpecular(float spec, float uvx, float uvy, int& r, int& g, int& b) const
+    {
+        if (spec <= 0) return;
+        if (materialConstants.sampleSpecular)
         {
-            int tileIndexX = tx / tileSize;
-            int tileIndexY = ty / tileSize;
-            int tileStartX = tileIndexX * tileSize;
-            int tileStartY = tileIndexY * tileSize;
-            right = ((right - tileStartX) % tileSize) + tileStartX;
-            bottom = ((bottom - tileStartY) % tileSize) + tileStartY;
+            int ks, unused1, unused2;
+            materialConstants.sampleSpecular(*material.map_Ks, 0, 1, uvx, uvy, ks, unused1, unused2);
+            spec *= static_cast<float>(ks) / 255;
         }
 
-        // Get the mantissa of the u/v
-        float fracU = tx - static_cast<float>(left);
-        float fracV = ty - static_cast<float>(top);
-
-        // Calculate the distance (weight) for each corner
-        float ul = (1.0f - fracU) * (1.0f - fracV);
-        float ll = (1.0f - fracU) * fracV;
-        float ur = fracU * (1.0f - fracV);
-        float lr = fracU * fracV;
-
-        // Texture index of above pixel samples
-        auto topLeft = (top * texture.w + left) * texture.bpp;
-        auto topRight = (top * texture.w + right) * texture.bpp;
-        auto bottomLeft = (bottom * texture.w + left) * texture.bpp;
-        auto bottomRight = (bottom * texture.w + right) * texture.bpp;
-
-        float red = ul * texture.data[topLeft] + ll * texture.data[bottomLeft] + ur * texture.data[topRight] +
-                    lr * texture.data[bottomRight];
-        float green = ul * texture.data[topLeft + 1] + ll * texture.data[bottomLeft + 1] +
-                      ur * texture.data[topRight + 1] + lr * texture.data[bottomRight + 1];
-        float blue = ul * texture.data[topLeft + 2] + ll * texture.data[bottomLeft + 2] +
-                     ur * texture.data[topRight + 2] + lr * texture.data[bottomRight + 2];
-
-        r = std::max(0, std::min(static_cast<int>(red * lum), 255));
-        g = std::max(0, std::min(static_cast<int>(green * lum), 255));
-        b = std::max(0, std::min(static_cast<int>(blue * lum), 255));
+        r = std::min(r + static_cast<int>(spec * materialConstants.specular[0]), 255);
+        g = std::min(g + static_cast<int>(spec * materialConstants.specular[1]), 255);
+        b = std::min(b + static_cast<int>(spec * materialConstants.specular[2]), 255);
     }
 
-    inline void Rasterizer::drawPixel(float x, float y, const slib::vec3& coords, float lum)
+    inline void Rasterizer::drawPixel(float x, float y, const slib::vec3& coords, float lum, Block* block)
     {
         // zBuffer.
         float interpolated_z = coords.x * p1.w + coords.y * p2.w + coords.z * p3.w;
-        int zIndex = y * static_cast<int>(SCREEN_WIDTH) + x;
+        int zIndex = y * zBuffer->width + x;
         if (!(interpolated_z < zBuffer->buffer[zIndex] || zBuffer->buffer[zIndex] == 0)) return;
         zBuffer->buffer[zIndex] = interpolated_z;
 
+        uint32_t cached;
+        const int px = static_cast<int>(x);
+        const int py = static_cast<int>(y);
+        if (shadingCache && shadingCache->Lookup(px, py, interpolated_z, cached))
+        {
+            bufferPixel(surface, px, py, cached);
+            ++reusedPixels;
+            return;
+        }
+        ++shadedPixels;
+        // Pixels the texture feedback samples are always shaded, so it sees the pages they would use
+        if (block && block->colour != 0 && !(feedback && virtualTexture && feedback->Samples(px, py)))
+        {
+            bufferPixel(surface, px, py, block->colour);
+            return;
+        }
+
         // Lighting
-        if (fragmentShader == GOURAUD)
+        const bool specular = fragmentShader == PHONG && materialConstants.flags & MATERIAL_SPECULAR;
+        float spec = 0;
+        if (block && block->lit)
+        {
+            lum = block->lum;
+            spec = block->spec;
+        }
+        else if (fragmentShader != FLAT)
+        {
+            slib::vec3 interpolated_normal{};
+            if (fragmentShader == GOURAUD)
+                interpolated_normal = smath::normalize(n1 * coords.x + n2 * coords.y + n3 * coords.z);
+            else
+                interpolated_normal = smath::fastNormalize(n1 * coords.x + n2 * coords.y + n3 * coords.z);
+
+            slib::vec3 position{};
+            if (!worldPoints.empty())
+                position =
+                    worldPoints[t.v1] * coords.x + worldPoints[t.v2] * coords.y + worldPoints[t.v3] * coords.z;
+            shade(interpolated_normal, position, x, y, specular, lum, spec);
+        }
+        if (block && !block->lit)
         {
-            auto interpolated_normal = n1 * coords.x + n2 * coords.y + n3 * coords.z;
-            interpolated_normal = smath::normalize(interpolated_normal);
-            lum = smath::dot(interpolated_normal, lightingDirection);
+            block->lit = true;
+            block->lum = lum;
+            block->spec = spec;
         }
 
         int r = 1, g = 1, b = 1;
+        float uvx = 0, uvy = 0;
 
         // If no texture.
-        if (material.map_Kd.data.empty())
+        if (!(materialConstants.flags & (MATERIAL_TEXTURED | MATERIAL_VIRTUAL)))
         {
-            float kdR = material.Kd[0];
-            float kdG = material.Kd[1];
-            float kdB = material.Kd[2];
-
-            kdR = std::fmod(kdR, 1.0f);
-            kdG = std::fmod(kdG, 1.0f);
-            kdB = std::fmod(kdB, 1.0f);
-
-            kdR = kdR < 0 ? 1.0f + kdR : kdR;
-            kdG = kdG < 0 ? 1.0f + kdG : kdG;
-            kdB = kdB < 0 ? 1.0f + kdB : kdB;
-
-            r = (static_cast<int>(kdR * 255));
-            g = (static_cast<int>(kdG * 255));
-            b = (static_cast<int>(kdB * 255));
+            r = static_cast<int>(materialConstants.baseColor >> 16 & 0xFF);
+            g = static_cast<int>(materialConstants.baseColor >> 8 & 0xFF);
+            b = static_cast<int>(materialConstants.baseColor & 0xFF);
 
             r = std::max(0, std::min(static_cast<int>(r * lum), 255));
             g = std::max(0, std::min(static_cast<int>(g * lum), 255));
             b = std::max(0, std::min(static_cast<int>(b * lum), 255));
-
-            bufferPixels(surface, x, y, r, g, b);
-            return;
+        }
+        else
+        {
+            // Texturing
+            const auto at = slib::vec3({tx1.x, tx1.y, 1.0f}) / viewW1;
+            const auto bt = slib::vec3({tx2.x, tx2.y, 1.0f}) / viewW2;
+            const auto ct = slib::vec3({tx3.x, tx3.y, 1.0f}) / viewW3;
+            const float wt = coords.x * at.z + coords.y * bt.z + coords.z * ct.z;
+            // "coords" are the barycentric coordinates of the current pixel
+            // "at", "bt", "ct" are the texture coordinates of the corners of the current triangle
+            uvx = (coords.x * at.x + coords.y * bt.x + coords.z * ct.x) / wt;
+            uvy = (coords.x * at.y + coords.y * bt.y + coords.z * ct.y) / wt;
+
+            if (virtualTexture)
+            {
+                // 1 / wt is the pixel's view depth: the footprint of a texel shrinks with distance
+                const float lod = lodBase - std::log2(wt);
+                const slib::AddressMode mode = material.texSampler.addressMode;
+                virtualTexture->Sample(uvx, uvy, lod, mode, bilinear, lum, r, g, b);
+                if (feedback && feedback->Samples(x, y))
+                    feedback->Record(x, y, virtualTexture->FeedbackKey(uvx, uvy, lod, mode));
+            }
+            else
+            {
+                // Addressing (repeat/clamp/mirror) and filtering are resolved per material when the mesh is
+                // loaded. The V flip is baked into the texture at load time.
+                sampleTexture(*material.map_Kd, mesh.atlasTileSize, lum, uvx, uvy, r, g, b);
+            }
         }
 
-        // Texturing
-        const auto at = slib::vec3({tx1.x, tx1.y, 1.0f}) / viewW1;
-        const auto bt = slib::vec3({tx2.x, tx2.y, 1.0f}) / viewW2;
-        const auto ct = slib::vec3({tx3.x, tx3.y, 1.0f}) / viewW3;
-        const float wt = coords.x * at.z + coords.y * bt.z + coords.z * ct.z;
-        // "coords" are the barycentric coordinates of the current pixel
-        // "at", "bt", "ct" are the texture coordinates of the corners of the current triangle
-        float uvx = (coords.x * at.x + coords.y * bt.x + coords.z * ct.x) / wt;
-        float uvy = (coords.x * at.y + coords.y * bt.y + coords.z * ct.y) / wt;
-
-        // GL_CLAMP
-        //    uvx = std::clamp(uvx, 0.0f, 1.0f);
-        //    uvy = std::clamp(uvy, 0.0f, 1.0f);
-
-        // GL_REPEAT
-        uvx = fmod(uvx, 1.0f);
-        uvy = fmod(uvy, 1.0f);
-
-        // Ensure uvx and uvy are positive
-        uvx = uvx < 0 ? 1.0f + uvx : uvx;
-        uvy = uvy < 0 ? 1.0f + uvy : uvy;
-
-        // Flip Y texture coordinate to account screen coordinates
-        // (Textures start from bottom left corner. Our screen starts from the top left.)
-        uvy = 1 - uvy;
-
-        if (textureFilter == NEIGHBOUR)
-            texNearestNeighbour(material.map_Kd, lum, uvx, uvy, r, g, b);
-        else if (textureFilter == BILINEAR)
-            texBilinear(
-                material.map_Kd, renderable.mesh.atlas, renderable.mesh.atlasTileSize, lum, uvx, uvy, r, g, b);
+        if (specular) applySpecular(spec, uvx, uvy, r, g, b);
 
         bufferPixels(surface, x, y, r, g, b);
+        if (block && block->shareColour) block->colour = 0xFF000000 | r << 16 | g << 8 | b;
     }
 
     void Rasterizer::rasterizeTriangle(float area)
@@ -196,77 +210,166 @@ namespace soft3d
         // Precalculate lighting (flat shading)
         if (fragmentShader == FLAT)
         {
-            if (!renderable.mesh.normals.empty())
+            if (mesh.HasNormals())
                 normal = smath::normalize((n1 + n2 + n3) / 3);
             else
             {
-                normal = smath::facenormal(
-                    t, renderable.mesh.vertices); // Dynamic face normal if no vertex normal data present
+                // Dynamic face normal if no vertex normal data present
+                normal = smath::normal(mesh.Position(t.v1), mesh.Position(t.v2), mesh.Position(t.v3));
             }
 
-            lum = smath::dot(normal, lightingDirection);
+            // One sample per triangle, so point/spot lights are evaluated at the centroid against every light
+            // rather than the tile's list.
+            lum = 0;
+            float unused = 0;
+            for (const uint16_t index : lightGrid.globalLights)
+                addLight((*lightGrid.lights)[index], normal, {}, nullptr, lum, unused);
+            if (lightGrid.HasLocalLights() && !worldPoints.empty())
+            {
+                const auto centroid = (worldPoints[t.v1] + worldPoints[t.v2] + worldPoints[t.v3]) / 3;
+                for (const uint16_t index : lightGrid.localLights)
+                    addLight((*lightGrid.lights)[index], normal, centroid, nullptr, lum, unused);
+            }
+        }
+
+        // Texels per pixel, from the ratio of the triangle's texture area to its screen area (0 if either is 0)
+        auto texelDensity = [&](const float textureWidth, const float textureHeight) {
+            const slib::vec2 e1 = tx2 - tx1;
+            const slib::vec2 e2 = tx3 - tx1;
+            const float texelArea = textureWidth * textureHeight;
+            const float texels = std::abs(e1.x * e2.y - e1.y * e2.x) * texelArea;
+            return texels > 0 && area != 0 ? texels / std::abs(area) : 0.0f;
+        };
+        if (virtualTexture)
+        {
+            // Screen area is measured at the mean depth of the vertices; drawPixel corrects for each pixel's own
+            // depth.
+            const float density = texelDensity(
+                static_cast<float>(virtualTexture->Width()), static_cast<float>(virtualTexture->Height()));
+            const float meanW = (viewW1 + viewW2 + viewW3) / 3;
+            if (density > 0 && meanW > 0) lodBase = 0.5f * std::log2(density) - std::log2(meanW);
         }
 
-        // Get bounding box.
+        // Get bounding box (the surface is the size of the frame's render resolution).
         const int xmin = std::max(static_cast<int>(std::floor(std::min({p1.x, p2.x, p3.x}))), 0);
-        const int xmax =
-            std::min(static_cast<int>(std::ceil(std::max({p1.x, p2.x, p3.x}))), static_cast<int>(SCREEN_WIDTH));
+        const int xmax = std::min(static_cast<int>(std::ceil(std::max({p1.x, p2.x, p3.x}))), surface->w - 1);
         const int ymin = std::max(static_cast<int>(std::floor(std::min({p1.y, p2.y, p3.y}))), 0);
-        const int ymax =
-            std::min(static_cast<int>(std::ceil(std::max({p1.y, p2.y, p3.y}))), static_cast<int>(SCREEN_HEIGHT));
+        const int ymax = std::min(static_cast<int>(std::ceil(std::max({p1.y, p2.y, p3.y}))), surface->h - 1);
+
+        auto drawIfCovered = [&](int x, int y, Block* block) {
+            if (checkerParity >= 0 && !Checkerboard::Shaded(x, y, checkerParity)) return;
+            slib::vec3 coords{};
+            coords.x = (x - p2.x) * EY1 - (y - p2.y) * EX1;
+            // signed area of the triangle v1v2p multiplied by 2
+            coords.y = (x - p3.x) * EY2 - (y - p3.y) * EX2;
+            // signed area of the triangle v2v0p multiplied by 2
+            coords.z = area - coords.x - coords.y;
+            // signed area of the triangle v0v1p multiplied by 2
+
+            if (coords.x >= 0 && coords.y >= 0 && coords.z >= 0)
+            {
+                coords /= area;
+                drawPixel(x, y, coords, lum, block);
+            }
+        };
 
-        slib::vec3 coords{};
+        // Small triangles cover too few pixels of any block to save much by sharing
+        if (!shadingRate || std::abs(area) < 2 * ShadingRate::MIN_AREA)
+        {
+            // Iterate over every pixel in the triangle
+            for (int x = xmin; x <= xmax; ++x)
+            {
+                for (int y = ymin; y <= ymax; ++y)
+                    drawIfCovered(x, y, nullptr);
+            }
+            return;
+        }
 
-        // Iterate over every pixel in the triangle
-        // #pragma omp parallel for default(none) shared(xmin, xmax, ymin, ymax, area, EY1, EY2, EX1, EX2, coords,
-        // lum)
-        for (int x = xmin; x <= xmax; ++x)
+        const bool textured = materialConstants.flags & (MATERIAL_TEXTURED | MATERIAL_VIRTUAL);
+        float density = 0;
+        if (virtualTexture)
+            density = texelDensity(
+                static_cast<float>(virtualTexture->Width()), static_cast<float>(virtualTexture->Height()));
+        else if (textured)
+            density = texelDensity(static_cast<float>(material.map_Kd->w), static_cast<float>(material.map_Kd->h));
+        const bool specular = fragmentShader == PHONG && materialConstants.flags & MATERIAL_SPECULAR;
+        const int materialRate = ShadingRate::MaterialRate(textured, specular, density);
+
+        const int lightingRate = fragmentShader == FLAT ? 1 : ShadingRate::LIGHTING_RATE;
+
+        // Columns of MAX_RATE pixels, which blocks never cross. Going down one, the rate is looked up at each
+        // tile boundary and the blocks of the row it is in are kept until the next row of blocks starts.
+        constexpr int maxRate = ShadingRate::MAX_RATE;
+        for (int columnX = xmin - xmin % maxRate; columnX <= xmax; columnX += maxRate)
         {
+            const int xFirst = std::max(columnX, xmin);
+            const int xLast = std::min(columnX + maxRate - 1, xmax);
+            int rate = 1;
+            bool shareColour = false;
+            Block blocks[maxRate];
             for (int y = ymin; y <= ymax; ++y)
             {
-                coords.x = (x - p2.x) * EY1 - (y - p2.y) * EX1;
-                // signed area of the triangle v1v2p multiplied by 2
-                coords.y = (x - p3.x) * EY2 - (y - p3.y) * EX2;
-                // signed area of the triangle v2v0p multiplied by 2
-                coords.z = area - coords.x - coords.y;
-                // signed area of the triangle v0v1p multiplied by 2
-
-                if (coords.x >= 0 && coords.y >= 0 && coords.z >= 0)
+                if (y == ymin || y % maxRate == 0)
                 {
-                    coords /= area;
-                    drawPixel(x, y, coords, lum);
+                    const int colourRate = std::max(materialRate, shadingRate->RateAt(columnX, y));
+                    rate = std::max(colourRate, lightingRate);
+                    shareColour = colourRate == rate;
                 }
+                if (y == ymin || y % rate == 0)
+                    std::fill(std::begin(blocks), std::end(blocks), Block{shareColour});
+                for (int x = xFirst; x <= xLast; ++x)
+                    drawIfCovered(x, y, rate > 1 ? &blocks[(x - columnX) / rate] : nullptr);
             }
         }
     }
 
     Rasterizer::Rasterizer(
         ZBuffer* _zBuffer,
-        const Renderable& _renderable,
+        const Mesh& _mesh,
         const std::vector<slib::zvec2>& screenPoints,
         const std::vector<slib::vec4>& projectedPoints,
         const std::vector<slib::vec3>& normals,
+        const std::vector<slib::vec3>& _worldPoints,
+        const slib::vec3& _viewPosition,
+        const LightGrid& _lightGrid,
         const slib::tri& _t,
         SDL_Surface* const _surface,
         FragmentShader _fragmentShader,
-        TextureFilter _textureFilter)
+        TextureFilter _textureFilter,
+        FeedbackBuffer* _feedback,
+        int _checkerParity,
+        const FrameHistory* _shadingCache,
+        const ShadingRate* _shadingRate)
         : surface(_surface),
           zBuffer(_zBuffer),
           t(_t),
-          renderable(_renderable),
+          mesh(_mesh),
+          lightGrid(_lightGrid),
           p1(screenPoints[t.v1]),
           p2(screenPoints[t.v2]),
           p3(screenPoints[t.v3]),
-          tx1(_renderable.mesh.textureCoords[t.vt1]),
-          tx2(_renderable.mesh.textureCoords[t.vt2]),
-          tx3(_renderable.mesh.textureCoords[t.vt3]),
-          material(renderable.mesh.materials.at(t.material)),
+          tx1(_mesh.TextureCoord(t.vt1)),
+          tx2(_mesh.TextureCoord(t.vt2)),
+          tx3(_mesh.TextureCoord(t.vt3)),
+          material(mesh.materials[t.material]),
+          materialConstants(mesh.materialConstants[t.material]),
           viewW1(projectedPoints[t.v1].w),
           viewW2(projectedPoints[t.v2].w),
           viewW3(projectedPoints[t.v3].w),
           n1(normals[t.v1]),
           n2(normals[t.v2]),
           n3(normals[t.v3]),
+          worldPoints(_worldPoints),
+          viewPosition(_viewPosition),
           fragmentShader(_fragmentShader),
-          textureFilter(_textureFilter){};
+          textureFilter(_textureFilter),
+          sampleTexture(materialConstants.sample[textureFilter == BILINEAR]),
+          virtualTexture(materialConstants.virtualTexture),
+          feedback(_feedback),
+          bilinear(
+              materialConstants.flags & MATERIAL_FILTER_PINNED ? material.texSampler.filter == slib::FILTER_LINEAR
+                                                               : textureFilter == BILINEAR),
+          checkerParity(_checkerParity),
+          shadingCache(_shadingCache),
+          shadingRate(_shadingRate){};
 } // namespace soft3d
\ No newline at end of file
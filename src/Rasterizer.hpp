@@ -4,7 +4,13 @@
 
 #pragma once
 
-#include "Renderable.hpp"
+#include "Checkerboard.hpp"
+#include "FrameHistory.hpp"
+#include "LightGrid.hpp"
+#include "Mesh.hpp"
+#include "Sampler.hpp"
+#include "ShadingRate.hpp"
+#include "VirtualTexture.hpp"
 #include "ZBuffer.hpp"
 #include <SDL2/SDL.h>
 
@@ -30,10 +36,10 @@ namespace soft3d
         ZBuffer* const zBuffer;
         // The triangle being rasterized
         const slib::tri& t;
-        const Renderable& renderable;
+        const Mesh& mesh;
 
         // slib::vec3 coords{}; // Barycentric/Edge-finding coordinates
-        const slib::vec3 lightingDirection{1, 1, 1.5};
+        const LightGrid& lightGrid;
         slib::vec3 normal{};
 
         // Screen points of each vertex
@@ -42,11 +48,12 @@ namespace soft3d
         const slib::zvec2& p3;
 
         // Texture coordinates of each vertex
-        const slib::vec2& tx1;
-        const slib::vec2& tx2;
-        const slib::vec2& tx3;
+        const slib::vec2 tx1;
+        const slib::vec2 tx2;
+        const slib::vec2 tx3;
 
         const slib::material& material;
+        const MaterialConstants& materialConstants;
 
         // Depth from view space stage at each vertex (used for perspecitve-correct texturing)
         const float viewW1;
@@ -58,23 +65,83 @@ namespace soft3d
         const slib::vec3& n2;
         const slib::vec3& n3;
 
+        // World space vertex positions (only filled for PHONG or when the scene has point/spot lights) and the
+        // camera position
+        const std::vector<slib::vec3>& worldPoints;
+        const slib::vec3& viewPosition;
+
         const FragmentShader fragmentShader;
         const TextureFilter textureFilter;
-
-        void drawPixel(float x, float y, const slib::vec3& coords, float lum);
+        const SampleFn sampleTexture; // nullptr if the material has no diffuse texture
+
+        // Virtual textures only (MATERIAL_VIRTUAL)
+        const VirtualTexture* const virtualTexture;
+        FeedbackBuffer* const feedback; // Records the pages this triangle samples; may be nullptr
+        const bool bilinear;
+        const int checkerParity; // Only the pixels of this Checkerboard parity are drawn; -1 for all of them
+        // Colours of the previous frame, reused instead of shading the pixels that saw the same surface (may be
+        // nullptr)
+        const FrameHistory* const shadingCache;
+        int reusedPixels = 0, shadedPixels = 0;
+        // Tiles to shade coarsely (may be nullptr: every pixel is shaded)
+        const ShadingRate* const shadingRate;
+        float lodBase = 0; // Mip level of the triangle at w = 1; the level at a pixel is lodBase - log2(1 / w)
+
+        // Shading shared by a coarsely shaded block's pixels: the first one drawn fills it in, the rest copy it
+        struct Block
+        {
+            bool shareColour = false; // Otherwise only the lighting is shared, and the texture sampled per pixel
+            bool lit = false;
+            float lum = 0, spec = 0;
+            uint32_t colour = 0; // 0 until shaded
+        };
+
+        void drawPixel(float x, float y, const slib::vec3& coords, float lum, Block* block = nullptr);
+        void addLight(
+            const Light& light,
+            const slib::vec3& normal,
+            const slib::vec3& position,
+            const slib::vec3* view,
+            float& lum,
+            float& spec) const;
+        void shade(
+            const slib::vec3& normal,
+            const slib::vec3& position,
+            int x,
+            int y,
+            bool specular,
+            float& lum,
+            float& spec) const;
+        void applySpecular(float spec, float uvx, float uvy, int& r, int& g, int& b) const;
 
       public:
         void rasterizeTriangle(float area);
+        // Pixels that passed the depth test, taken from the shading cache and shaded
+        [[nodiscard]] int ReusedPixels() const
+        {
+            return reusedPixels;
+        }
+        [[nodiscard]] int ShadedPixels() const
+        {
+            return shadedPixels;
+        }
 
         Rasterizer(
             ZBuffer* const _zBuffer,
-            const Renderable& _renderable,
+            const Mesh& _mesh,
             const std::vector<slib::zvec2>& screenPoints,
             const std::vector<slib::vec4>& projectedPoints,
             const std::vector<slib::vec3>& normals,
+            const std::vector<slib::vec3>& _worldPoints,
+            const slib::vec3& _viewPosition,
+            const LightGrid& _lightGrid,
             const slib::tri& _t,
             SDL_Surface* const _surface,
             FragmentShader _fragmentShader,
-            TextureFilter _textureFilter);
+            TextureFilter _textureFilter,
+            FeedbackBuffer* _feedback = nullptr,
+            int _checkerParity = -1,
+            const FrameHistory* _shadingCache = nullptr,
+            const ShadingRate* _shadingRate = nullptr);
     };
 } // namespace soft3d
@@ -4,23 +4,88 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
 #include <utility>
+#include <vector>
 #include "Mesh.hpp"
+#include "smath.hpp"
 
 namespace soft3d
 {
 struct Renderable
 {
-    const Mesh mesh;
+    std::shared_ptr<const Mesh> mesh; // Shared with every other renderable (and scene) that uses the same model
     slib::vec3 position;
     slib::vec3 eulerAngles;
     slib::vec3 scale;
     slib::Color col;
     bool ignoreLighting = false;
-    Renderable(Mesh  _mesh, slib::vec3 _position, slib::vec3 _eulerAngles, slib::vec3 _scale,
+    Renderable(std::shared_ptr<const Mesh> _mesh, slib::vec3 _position, slib::vec3 _eulerAngles, slib::vec3 _scale,
                slib::Color _col)
         : mesh(std::move(_mesh)), position(_position), eulerAngles(_eulerAngles), scale(_scale), col(_col)
     {};
 
 };
+
+/*
+ * One mesh drawn many times. Each instance only stores its transform and bounding sphere; the renderer culls
+ * instances against the view frustum, sorts the visible ones front to back and transforms them one at a time
+ * through the same buffers, so memory grows with the unique geometry rather than the instance count.
+ */
+struct InstancedRenderable
+{
+    struct Instance
+    {
+        smath::mat4 model; // Model to world (the full transform of a Renderable)
+        std::array<float, 9> normal; // 3x3 row-major inverse transpose of scale and rotation (not unit length)
+        slib::vec3 center; // World space bounding sphere
+        float radius;
+    };
+
+    std::shared_ptr<const Mesh> mesh;
+    slib::Color col;
+    bool ignoreLighting = false;
+    std::vector<Instance> instances;
+
+    // Adds an instance placed like a Renderable with the same position, rotation and scale.
+    void Add(const slib::vec3& position, const slib::vec3& eulerAngles, const slib::vec3& scale)
+    {
+        instances.push_back(Place(*mesh, position, eulerAngles, scale));
+    }
+
+    // The transform and bounding sphere of 'mesh' placed like a Renderable.
+    static Instance Place(
+        const Mesh& mesh, const slib::vec3& position, const slib::vec3& eulerAngles, const slib::vec3& scale)
+    {
+        const slib::mat rotation = smath::rotationMatrix(eulerAngles);
+        const smath::mat4 scaleRotation = smath::flatten(smath::scaleMatrix(scale) * rotation);
+        // Normals of a non-uniformly scaled model are scaled by the reciprocal instead, or they lean over
+        const smath::mat4 normalTransform =
+            smath::flatten(smath::scaleMatrix(smath::normalScale(scale)) * rotation);
+        Instance instance{};
+        instance.model = smath::multiply(smath::flatten(smath::translationMatrix(position)), scaleRotation);
+        float maxScaleSquared = 0;
+        for (int c = 0; c < 3; ++c)
+        {
+            for (int r = 0; r < 3; ++r)
+                instance.normal[r * 3 + c] = normalTransform[r * 4 + c];
+            const float x = scaleRotation[c], y = scaleRotation[4 + c], z = scaleRotation[8 + c];
+            maxScaleSquared = std::max(maxScaleSquared, x * x + y * y + z * z);
+        }
+        const auto& m = instance.model;
+        const slib::vec3& c = mesh.boundsCenter;
+        instance.center = {
+            m[0] * c.x + m[1] * c.y + m[2] * c.z + m[3],
+            m[4] * c.x + m[5] * c.y + m[6] * c.z + m[7],
+            m[8] * c.x + m[9] * c.y + m[10] * c.z + m[11]};
+        instance.radius = mesh.boundsRadius * std::sqrt(maxScaleSquared);
+        return instance;
+    }
+
+    InstancedRenderable(std::shared_ptr<const Mesh> _mesh, slib::Color _col) : mesh(std::move(_mesh)), col(_col)
+    {};
+};
 }
\ No newline at end of file
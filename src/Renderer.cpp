@@ -4,18 +4,24 @@
 
 #include "Renderer.hpp"
 #include "constants.hpp"
+#include "JobSystem.hpp"
 #include "Rasterizer.hpp"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
 #include <iostream>
 
 namespace soft3d
 {
 
-    inline void createScreenSpace(std::vector<slib::vec4>& projectedPoints, std::vector<slib::zvec2>& screenPoints)
+    inline void createScreenSpace(
+        std::vector<slib::vec4>& projectedPoints, std::vector<slib::zvec2>& screenPoints, int width, int height)
     {
-// Convert to screen
-#pragma omp parallel for default(none) shared(projectedPoints, screenPoints, SCREEN_WIDTH, SCREEN_HEIGHT)
-        for (int i = 0; i < projectedPoints.size(); ++i)
-        {
+        const double halfWidth = width / 2.0;
+        const double halfHeight = height / 2.0;
+        // Convert to screen
+        JobSystem::Get().ParallelFor(0, static_cast<int>(projectedPoints.size()), [&](int i) {
             auto& v = projectedPoints[i];
             // NDC Space
             if (v.w != 0)
@@ -28,12 +34,28 @@ namespace soft3d
             //-----------------------------
 
             // Screen space
-            const auto x = static_cast<float>(SCREEN_WIDTH / 2 + v.x * SCREEN_WIDTH / 2);
-            const auto y = static_cast<float>(SCREEN_HEIGHT / 2 - v.y * SCREEN_HEIGHT / 2);
+            const auto x = static_cast<float>(halfWidth + v.x * halfWidth);
+            const auto y = static_cast<float>(halfHeight - v.y * halfHeight);
             screenPoints[i] = {x, y, v.z};
             //-----------------------------
-        }
-#pragma omp barrier
+        });
+    }
+
+    // True if the triangle lies entirely outside one of the frustum planes.
+    inline bool outsideFrustum(const slib::tri& face, const std::vector<slib::vec4>& projectedPoints)
+    {
+        const auto& v1 = projectedPoints[face.v1];
+        const auto& v2 = projectedPoints[face.v2];
+        const auto& v3 = projectedPoints[face.v3];
+
+        if (v1.x > v1.w && v2.x > v2.w && v3.x > v3.w) return true;
+        if (v1.x < -v1.w && v2.x < -v2.w && v3.x < -v3.w) return true;
+        if (v1.y > v1.w && v2.y > v2.w && v3.y > v3.w) return true;
+        if (v1.y < -v1.w && v2.y < -v2.w && v3.y < -v3.w) return true;
+        if (v1.z < 0.0f && v2.z < 0.0f && v3.z < 0.0f) return true;
+        // TODO: far plane clipping doesn't work?
+        // if (v1.z > v1.w && v2.z > v2.w && v3.z > v3.w) return true;
+        return false;
     }
 
     inline bool makeClipSpace(
@@ -48,43 +70,67 @@ namespace soft3d
         // // if inside == 2, form a quad.
         // // if inside == 1, form triangle.
 
-        const auto& v1 = projectedPoints[face.v1];
-        const auto& v2 = projectedPoints[face.v2];
-        const auto& v3 = projectedPoints[face.v3];
-
-        if (v1.x > v1.w && v2.x > v2.w && v3.x > v3.w) return false;
-        if (v1.x < -v1.w && v2.x < -v2.w && v3.x < -v3.w) return false;
-        if (v1.y > v1.w && v2.y > v2.w && v3.y > v3.w) return false;
-        if (v1.y < -v1.w && v2.y < -v2.w && v3.y < -v3.w) return false;
-        if (v1.z < 0.0f && v2.z < 0.0f && v3.z < 0.0f) return false;
-        // TODO: far plane clipping doesn't work?
-        // if (v1.z > v1.w && v2.z > v2.w && v3.z > v3.w) return false;
+        if (outsideFrustum(face, projectedPoints)) return false;
 
         processedFaces.push_back(face);
         return true;
         // clip *all* triangles against 1 edge, then all against the next, and the next.
     }
 
+    // Clears the part of the surface the frame covers (its rows are the frame texture's, so may be longer).
     inline void Renderer::clearBuffer()
     {
         auto* pixels = (unsigned char*)sdlSurface->pixels;
-#pragma omp parallel for default(none) shared(pixels)
-        for (int i = 0; i < screenSize * 4; ++i)
-            pixels[i] = 0;
-#pragma omp barrier
+        const int pitch = sdlSurface->pitch;
+        const int rowBytes = sdlSurface->w * 4;
+        JobSystem::Get().ParallelForRange(0, sdlSurface->h, [pixels, pitch, rowBytes](int first, int last) {
+            for (int y = first; y < last; ++y)
+                std::fill_n(pixels + y * pitch, rowBytes, 0);
+        });
     }
 
     void Renderer::RenderBuffer()
     {
         SDL_RenderPresent(sdlRenderer);
+        if (shownInputTime == 0) return;
+        const double ms = static_cast<double>(SDL_GetTicks() - shownInputTime); // Event timestamps are ticks
+        inputLatency = inputLatency == 0 ? ms : inputLatency + (ms - inputLatency) * LATENCY_SMOOTHING;
+        shownInputTime = 0;
+    }
+
+    /*
+     * Points the surface at the frame texture's memory (its contents are undefined once locked) and clears it.
+     * Frames below the full resolution use the top left corner of the texture, and the surface is narrowed to it.
+     */
+    void Renderer::beginFrame(const Frame& frame)
+    {
+        frameRect = {0, 0, frame.width, frame.height};
+        sdlSurface->w = frame.width;
+        sdlSurface->h = frame.height;
+        if (frameTexture)
+        {
+            void* pixels;
+            int pitch;
+            if (SDL_LockTexture(frameTexture, &frameRect, &pixels, &pitch) != 0)
+            {
+                std::cout << "Error: could not lock the frame texture: " << SDL_GetError() << std::endl;
+                exit(1);
+            }
+            sdlSurface->pixels = pixels;
+            sdlSurface->pitch = pitch;
+        }
         clearBuffer();
     }
 
-    inline void pushBuffer(SDL_Renderer* renderer, SDL_Surface* surface)
+    /*
+     * Hands the frame to SDL. The texture is unlocked and copied as is (no allocation or conversion per frame),
+     * stretched over the whole output with the upscale filter if the frame is smaller.
+     */
+    void Renderer::endFrame()
     {
-        SDL_Texture* tex = SDL_CreateTextureFromSurface(renderer, surface);
-        SDL_RenderCopy(renderer, tex, nullptr, nullptr);
-        SDL_DestroyTexture(tex);
+        if (!frameTexture) return;
+        SDL_UnlockTexture(frameTexture);
+        SDL_RenderCopy(sdlRenderer, frameTexture, &frameRect, nullptr);
     }
 
     inline void Renderer::updateViewMatrix()
@@ -94,115 +140,757 @@ namespace soft3d
         camera.UpdateDirectionVectors(viewMatrix);
     }
 
-    inline void createProjectedSpace(
+    /*
+     * Transforms every vertex of the renderable to clip space (and its normal, and optionally its position, to
+     * world space). 'Quantized' meshes are dequantized on the fly, so only 10 bytes are fetched per vertex.
+     */
+    template <bool Quantized>
+    void createProjectedSpace(
         const Renderable& renderable,
+        const Mesh& mesh,
         const slib::mat& viewMatrix,
         const slib::mat& perspectiveMat,
         std::vector<slib::vec4>& projectedPoints,
-        std::vector<slib::vec3>& normals)
+        std::vector<slib::vec3>& normals,
+        std::vector<slib::vec3>& worldPoints)
     {
-        bool hasNormalData = !renderable.mesh.normals.empty();
-#pragma omp parallel for default(none)                                                                            \
-    shared(renderable, viewMatrix, perspectiveMat, projectedPoints, normals, hasNormalData)
-        for (int i = 0; i < renderable.mesh.vertices.size(); i++)
-        {
-            slib::mat scaleMatrix = smath::scaleMatrix(renderable.scale);
-            slib::mat rotationMatrix = smath::rotationMatrix(renderable.eulerAngles);
-            slib::mat translationMatrix = smath::translationMatrix(renderable.position);
+        const bool hasNormalData = mesh.HasNormals();
+        const bool keepWorldPoints = !worldPoints.empty();
+        const int vertexCount = static_cast<int>(mesh.VertexCount());
 
-            // World Space Transform
-            slib::mat normalTransformMat =
-                scaleMatrix * rotationMatrix; // Normal transforms do not need to be translated
-            slib::mat fullTransformMat = normalTransformMat * translationMatrix;
-            slib::vec4 v4(
-                {renderable.mesh.vertices[i].x, renderable.mesh.vertices[i].y, renderable.mesh.vertices[i].z, 1});
-            auto transformedVector = viewMatrix * fullTransformMat * v4;
+        // World Space Transform (the same for every vertex)
+        const slib::mat scaleMatrix = smath::scaleMatrix(renderable.scale);
+        const slib::mat rotationMatrix = smath::rotationMatrix(renderable.eulerAngles);
+        const slib::mat translationMatrix = smath::translationMatrix(renderable.position);
+        const slib::mat scaleRotationMat = scaleMatrix * rotationMatrix;
+        const slib::mat fullTransformMat = scaleRotationMat * translationMatrix;
+        // Normals are not translated, and take the inverse transpose of the scale (see smath::normalScale)
+        const slib::mat normalTransformMat =
+            smath::scaleMatrix(smath::normalScale(renderable.scale)) * rotationMatrix;
+        const slib::mat viewTransformMat = viewMatrix * fullTransformMat;
+
+        JobSystem::Get().ParallelFor(0, vertexCount, [&](int i) {
+            slib::vec3 position;
+            if constexpr (Quantized)
+                position = dequantizePosition(mesh.quantized->vertices[i], mesh.quantized->positionRange);
+            else
+                position = mesh.vertices[i];
+            const slib::vec4 v4({position.x, position.y, position.z, 1});
+            const auto transformedVector = viewTransformMat * v4;
+            if (keepWorldPoints)
+            {
+                auto worldVector = translationMatrix * (scaleRotationMat * v4);
+                worldPoints[i] = {worldVector.x, worldVector.y, worldVector.z};
+            }
 
             // Projection transform
             projectedPoints[i] = perspectiveMat * transformedVector;
 
             // Transform normal data to world space
-            if (!hasNormalData) continue;
-            slib::vec4 n4(
-                {renderable.mesh.normals[i].x, renderable.mesh.normals[i].y, renderable.mesh.normals[i].z, 0});
+            if (!hasNormalData) return;
+            slib::vec3 normal;
+            if constexpr (Quantized)
+                normal = octDecode(mesh.quantized->vertices[i].normal);
+            else
+                normal = mesh.normals[i];
+            const slib::vec4 n4({normal.x, normal.y, normal.z, 0});
             auto transformedNormal = normalTransformMat * n4;
             normals[i] = {transformedNormal.x, transformedNormal.y, transformedNormal.z};
+        });
+    }
+
+    /*
+     * createProjectedSpace followed by createScreenSpace for one instance, in a single pass. The transforms are
+     * flat matrices worked out once per instance, so the loop is plain multiply-adds that the compiler can
+     * vectorize. 'projectedPoints' keep the clip space positions (for the frustum tests and w).
+     */
+    template <bool Quantized>
+    void transformInstance(
+        const Mesh& mesh,
+        const InstancedRenderable::Instance& instance,
+        const smath::mat4& modelViewProjection,
+        std::vector<slib::vec4>& projectedPoints,
+        std::vector<slib::zvec2>& screenPoints,
+        std::vector<slib::vec3>& normals,
+        std::vector<slib::vec3>& worldPoints,
+        int width,
+        int height)
+    {
+        const bool hasNormalData = !normals.empty();
+        const bool keepWorldPoints = !worldPoints.empty();
+        const int vertexCount = static_cast<int>(mesh.VertexCount());
+        const float* mvp = modelViewProjection.data();
+        const float* model = instance.model.data();
+        const float* normalMat = instance.normal.data();
+        const float halfWidth = static_cast<float>(width) / 2;
+        const float halfHeight = static_cast<float>(height) / 2;
+
+        JobSystem::Get().ParallelForRange(0, vertexCount, [&](int first, int last) {
+#pragma omp simd
+            for (int i = first; i < last; i++)
+            {
+                slib::vec3 p;
+                if constexpr (Quantized)
+                    p = dequantizePosition(mesh.quantized->vertices[i], mesh.quantized->positionRange);
+                else
+                    p = mesh.vertices[i];
+                const slib::vec4 clip{
+                    mvp[0] * p.x + mvp[1] * p.y + mvp[2] * p.z + mvp[3],
+                    mvp[4] * p.x + mvp[5] * p.y + mvp[6] * p.z + mvp[7],
+                    mvp[8] * p.x + mvp[9] * p.y + mvp[10] * p.z + mvp[11],
+                    mvp[12] * p.x + mvp[13] * p.y + mvp[14] * p.z + mvp[15]};
+                projectedPoints[i] = clip;
+                const float invW = clip.w != 0 ? 1 / clip.w : 1;
+                screenPoints[i] = {
+                    halfWidth + clip.x * invW * halfWidth, halfHeight - clip.y * invW * halfHeight, clip.z * invW};
+
+                if (keepWorldPoints)
+                {
+                    worldPoints[i] = {
+                        model[0] * p.x + model[1] * p.y + model[2] * p.z + model[3],
+                        model[4] * p.x + model[5] * p.y + model[6] * p.z + model[7],
+                        model[8] * p.x + model[9] * p.y + model[10] * p.z + model[11]};
+                }
+                if (hasNormalData)
+                {
+                    slib::vec3 n;
+                    if constexpr (Quantized)
+                        n = octDecode(mesh.quantized->vertices[i].normal);
+                    else
+                        n = mesh.normals[i];
+                    normals[i] = {
+                        normalMat[0] * n.x + normalMat[1] * n.y + normalMat[2] * n.z,
+                        normalMat[3] * n.x + normalMat[4] * n.y + normalMat[5] * n.z,
+                        normalMat[6] * n.x + normalMat[7] * n.y + normalMat[8] * n.z};
+                }
+            }
+        });
+    }
+
+    /*
+     * Screen rectangle and clip w range of a world space sphere, from the corners of its bounding box (so it
+     * holds for spheres near the edges of the screen too). A box reaching behind the camera covers the screen.
+     */
+    inline void sphereScreenBounds(
+        const smath::mat4& viewProjection,
+        int width,
+        int height,
+        const slib::vec3& center,
+        float radius,
+        float& xmin,
+        float& xmax,
+        float& ymin,
+        float& ymax,
+        float& minW,
+        float& maxW)
+    {
+        const float* m = viewProjection.data();
+        xmin = ymin = minW = FLT_MAX;
+        xmax = ymax = maxW = -FLT_MAX;
+        bool behindCamera = false;
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            const float x = center.x + (corner & 1 ? radius : -radius);
+            const float y = center.y + (corner & 2 ? radius : -radius);
+            const float z = center.z + (corner & 4 ? radius : -radius);
+            const float cx = m[0] * x + m[1] * y + m[2] * z + m[3];
+            const float cy = m[4] * x + m[5] * y + m[6] * z + m[7];
+            const float w = m[12] * x + m[13] * y + m[14] * z + m[15];
+            minW = std::min(minW, w);
+            maxW = std::max(maxW, w);
+            if (w <= 1e-4f)
+            {
+                behindCamera = true;
+                continue;
+            }
+            const float sx = static_cast<float>(width / 2.0 + cx / w * width / 2.0);
+            const float sy = static_cast<float>(height / 2.0 - cy / w * height / 2.0);
+            xmin = std::min(xmin, sx);
+            xmax = std::max(xmax, sx);
+            ymin = std::min(ymin, sy);
+            ymax = std::max(ymax, sy);
+        }
+        if (behindCamera)
+        {
+            xmin = ymin = 0;
+            xmax = static_cast<float>(width - 1);
+            ymax = static_cast<float>(height - 1);
+            return;
         }
-#pragma omp barrier
+        xmin = std::clamp(xmin, 0.0f, static_cast<float>(width - 1));
+        xmax = std::clamp(xmax, 0.0f, static_cast<float>(width - 1));
+        ymin = std::clamp(ymin, 0.0f, static_cast<float>(height - 1));
+        ymax = std::clamp(ymax, 0.0f, static_cast<float>(height - 1));
     }
 
-    void Renderer::Render()
+    // Area of the triangle multiplied by 2. Negative if the triangle is facing away from the camera.
+    inline float signedArea(const slib::zvec2& p1, const slib::zvec2& p2, const slib::zvec2& p3)
     {
-        zBuffer->clear();
+        return (p3.x - p1.x) * (p2.y - p1.y) - (p3.y - p1.y) * (p2.x - p1.x);
+    }
+
+    // Gives each screen tile the depth range of the visible triangles touching it, then bins the point/spot
+    // lights into the tiles they can reach.
+    void Renderer::buildLightGrid(Frame& frame)
+    {
+        frame.lightGrid.ResetDepth();
+        // Each thread takes a slice of every renderable's faces and of the instances, and merges its own depth
+        // ranges at the end
+        auto& jobs = JobSystem::Get();
+        const int slices = static_cast<int>(jobs.ThreadCount());
+        std::mutex mergeMutex;
+        auto sliceOf = [slices](size_t count, int slice, size_t& first, size_t& last) {
+            first = count * slice / slices;
+            last = count * (slice + 1) / slices;
+        };
+        jobs.ParallelFor(
+            0,
+            slices,
+            [&](int slice) {
+                std::vector<float> minDepths(frame.lightGrid.TileCount(), FLT_MAX);
+                std::vector<float> maxDepths(frame.lightGrid.TileCount(), -FLT_MAX);
+                size_t first, last;
+                for (const auto& g : frame.geometry)
+                {
+                    sliceOf(g.processedFaces.size(), slice, first, last);
+                    for (size_t i = first; i < last; ++i)
+                    {
+                        const auto& t = g.processedFaces[i];
+                        const auto& p1 = g.screenPoints[t.v1];
+                        const auto& p2 = g.screenPoints[t.v2];
+                        const auto& p3 = g.screenPoints[t.v3];
+                        if (signedArea(p1, p2, p3) < 0) continue;
+                        const float w1 = g.projectedPoints[t.v1].w;
+                        const float w2 = g.projectedPoints[t.v2].w;
+                        const float w3 = g.projectedPoints[t.v3].w;
+                        frame.lightGrid.ExpandDepth(
+                            minDepths,
+                            maxDepths,
+                            std::min({p1.x, p2.x, p3.x}),
+                            std::max({p1.x, p2.x, p3.x}),
+                            std::min({p1.y, p2.y, p3.y}),
+                            std::max({p1.y, p2.y, p3.y}),
+                            std::min({w1, w2, w3}),
+                            std::max({w1, w2, w3}));
+                    }
+                }
+                // Instances are transformed just before they are drawn, so their bounding spheres stand in for
+                // them
+                sliceOf(frame.visibleInstances.size(), slice, first, last);
+                for (size_t i = first; i < last; ++i)
+                {
+                    const auto& visible = frame.visibleInstances[i];
+                    float xmin, xmax, ymin, ymax, minW, maxW;
+                    sphereScreenBounds(
+                        frame.viewProjection,
+                        frame.width,
+                        frame.height,
+                        visible.instance->center,
+                        visible.instance->radius,
+                        xmin,
+                        xmax,
+                        ymin,
+                        ymax,
+                        minW,
+                        maxW);
+                    frame.lightGrid.ExpandDepth(minDepths, maxDepths, xmin, xmax, ymin, ymax, minW, maxW);
+                }
+                std::lock_guard lock(mergeMutex);
+                frame.lightGrid.MergeDepth(minDepths, maxDepths);
+            },
+            1);
+        frame.lightGrid.Cull(smath::transpose(viewMatrix), perspectiveMat);
+        if (frame.lightGrid.DroppedLights() != 0 && !lightOverflowReported)
+        {
+            std::cout << "Warning: more than " << LightGrid::MAX_LIGHTS_PER_TILE
+                      << " lights reach some tiles; the extra ones are not drawn there" << std::endl;
+            lightOverflowReported = true;
+        }
+    }
+
+    /*
+     * Tests every instance's bounding sphere against the planes of the clip tests in makeClipSpace
+     * (-w <= x <= w, -w <= y <= w, z >= 0) and sorts the visible ones front to back.
+     */
+    void Renderer::cullInstances(Frame& frame)
+    {
+        frame.visibleInstances.clear();
+        if (instancedRenderables.empty() && streamingMeshes.empty()) return;
+
+        // World space planes (a, b, c, d): a point is inside when ax + by + cz + d >= 0
+        const auto& m = frame.viewProjection;
+        std::array<std::array<float, 4>, 5> planes{};
+        std::array<float, 5> lengths{};
+        for (int c = 0; c < 4; ++c)
+        {
+            planes[0][c] = m[12 + c] - m[c];
+            planes[1][c] = m[12 + c] + m[c];
+            planes[2][c] = m[12 + c] - m[4 + c];
+            planes[3][c] = m[12 + c] + m[4 + c];
+            planes[4][c] = m[8 + c];
+        }
+        for (int i = 0; i < 5; ++i)
+            lengths[i] = std::sqrt(
+                planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+
+        auto cullBatch = [&](const InstancedRenderable* batch) {
+            for (const auto& instance : batch->instances)
+            {
+                const slib::vec3& p = instance.center;
+                bool visible = true;
+                for (int i = 0; i < 5 && visible; ++i)
+                {
+                    const auto& plane = planes[i];
+                    visible = plane[0] * p.x + plane[1] * p.y + plane[2] * p.z + plane[3] >=
+                              -instance.radius * lengths[i];
+                }
+                if (!visible) continue;
+                const float depth = m[12] * p.x + m[13] * p.y + m[14] * p.z + m[15];
+                const Mesh& mesh = *batch->mesh;
+                if (mesh.lods.empty())
+                {
+                    frame.visibleInstances.push_back({&instance, batch->mesh, depth});
+                    continue;
+                }
+                const slib::vec3 d = p - frame.cameraPosition;
+                const float distance = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z) - instance.radius;
+                const float scale = mesh.boundsRadius > 0 ? instance.radius / mesh.boundsRadius : 1;
+                frame.visibleInstances.push_back(
+                    {&instance,
+                     selectLod(batch->mesh, scale, distance, frame.height, instanceLods[&instance]),
+                     depth});
+            }
+        };
+        for (const auto* batch : instancedRenderables)
+            cullBatch(batch);
+        for (const auto* mesh : streamingMeshes)
+        {
+            for (const auto& chunk : mesh->Chunks())
+                cullBatch(&chunk);
+        }
+        // Nearest first, so the depth test rejects most of the hidden pixels before they are shaded
+        std::sort(frame.visibleInstances.begin(), frame.visibleInstances.end(), [](const auto& a, const auto& b) {
+            return a.depth < b.depth;
+        });
+    }
+
+    inline void Renderer::drawTriangle(
+        const Frame& frame, const Mesh& mesh, const RenderableGeometry& g, const slib::tri& t)
+    {
+        const auto& p1 = g.screenPoints[t.v1];
+        const auto& p2 = g.screenPoints[t.v2];
+        const auto& p3 = g.screenPoints[t.v3];
+
+        const float area = signedArea(p1, p2, p3);
+        if (area < 0) return; // Backface culling
+        Rasterizer rasterizer(
+            zBuffer.get(),
+            mesh,
+            g.screenPoints,
+            g.projectedPoints,
+            g.normals,
+            g.worldPoints,
+            frame.cameraPosition,
+            frame.lightGrid,
+            t,
+            sdlSurface,
+            frame.fragmentShader,
+            frame.textureFilter,
+            virtualTextures ? &feedback : nullptr,
+            frame.checkerboard ? checkerboard.Parity() : -1,
+            shadingCache,
+            frame.variableRate ? &shadingRate : nullptr);
+        rasterizer.rasterizeTriangle(area);
+        if (rasterizer.ReusedPixels() != 0) reusedPixels.fetch_add(rasterizer.ReusedPixels());
+        if (rasterizer.ShadedPixels() != 0) shadedPixels.fetch_add(rasterizer.ShadedPixels());
+    }
+
+    // Transforms the instance into the shared instance buffers and rasterizes it.
+    void Renderer::drawInstance(const Frame& frame, const VisibleInstance& visible)
+    {
+        const Mesh& mesh = *visible.mesh;
+        auto& g = instanceGeometry;
+        const size_t vertexCount = mesh.VertexCount();
+        g.normals.resize(mesh.HasNormals() ? vertexCount : 0);
+        g.projectedPoints.resize(vertexCount);
+        g.screenPoints.resize(vertexCount);
+        g.worldPoints.resize(frame.needWorldPoints ? vertexCount : 0);
+
+        const smath::mat4 modelViewProjection = smath::multiply(frame.viewProjection, visible.instance->model);
+        if (mesh.quantized)
+            transformInstance<true>(
+                mesh, *visible.instance, modelViewProjection, g.projectedPoints, g.screenPoints, g.normals,
+                g.worldPoints, frame.width, frame.height);
+        else
+            transformInstance<false>(
+                mesh, *visible.instance, modelViewProjection, g.projectedPoints, g.screenPoints, g.normals,
+                g.worldPoints, frame.width, frame.height);
+
+        // Faces are clip tested as they are drawn instead of being collected first (processedFaces)
+        JobSystem::Get().ParallelFor(0, static_cast<int>(mesh.faces.size()), [&](int i) {
+            const auto& t = mesh.faces[i];
+            if (outsideFrustum(t, g.projectedPoints)) return;
+            drawTriangle(frame, mesh, g, t);
+        });
+    }
+
+    // Geometry pass: everything up to rasterization, written to 'frame' only.
+    void Renderer::prepareFrame(Frame& frame)
+    {
+        frame.inputTime = cameraInput ? cameraInput->Apply(camera) : 0;
+        for (auto* mesh : streamingMeshes)
+            mesh->Update(camera.pos);
         updateViewMatrix();
-        for (auto& renderable : renderables)
-        {
-            std::vector<slib::vec3> normals;
-            normals.resize(renderable->mesh.normals.size());
-            std::vector<slib::vec4> projectedPoints;
-            projectedPoints.resize(renderable->mesh.vertices.size());
-            std::vector<slib::tri> processedFaces;
-            processedFaces.reserve(renderable->mesh.faces.size());
-            std::vector<slib::zvec2> screenPoints;
-            screenPoints.resize(renderable->mesh.vertices.size());
-
-            createProjectedSpace(*renderable, viewMatrix, perspectiveMat, projectedPoints, normals);
-            // Culling and clipping
-            for (const auto& f : renderable->mesh.faces)
+        frame.viewProjection =
+            smath::multiply(smath::flatten(perspectiveMat), smath::transpose(smath::flatten(viewMatrix)));
+        frame.cameraPosition = camera.pos;
+        frame.fragmentShader = fragmentShader;
+        frame.textureFilter = textureFilter;
+        frame.checkerboard = checkerboardEnabled;
+        frame.reprojectionCache = reprojectionRefresh > 0;
+        frame.variableRate = variableRateShading;
+        frame.needWorldPoints = fragmentShader == PHONG || frame.lightGrid.HasLocalLights();
+        // The scale is the same on both axes, so the projection (and its aspect ratio) does not change with it
+        frame.width = std::max(1, static_cast<int>(std::lround(width * resolutionScale)));
+        frame.height = std::max(1, static_cast<int>(std::lround(height * resolutionScale)));
+        frame.lightGrid.Resize(frame.width, frame.height);
+        frame.geometry.resize(renderables.size());
+        renderableLods.resize(renderables.size());
+
+        auto& jobs = JobSystem::Get();
+        // Instance culling does not need the renderables' vertices, so it runs alongside their transforms; the
+        // light grid needs both
+        const auto culled = jobs.Run([this, &frame] { cullInstances(frame); });
+        const auto transformed = jobs.Run([this, &frame, &jobs] {
+            const int count = static_cast<int>(renderables.size());
+            jobs.ParallelFor(0, count, [this, &frame](int i) { transformRenderable(frame, i); }, 1);
+        });
+        const auto binned = jobs.Run(
+            [this, &frame] {
+                if (frame.lightGrid.HasLocalLights()) buildLightGrid(frame);
+            },
+            {culled, transformed});
+        jobs.Wait(binned);
+    }
+
+    // Transforms, clips and projects renderable 'i' into its slot of 'frame'.
+    void Renderer::transformRenderable(Frame& frame, size_t i)
+    {
+        const auto& renderable = renderables[i];
+        auto& g = frame.geometry[i];
+        g.mesh = renderable->mesh.get();
+        if (!g.mesh->lods.empty())
+        {
+            // Distance from the camera to the mesh's bounding sphere, in world space
+            const auto sphere = InstancedRenderable::Place(
+                *g.mesh, renderable->position, renderable->eulerAngles, renderable->scale);
+            const slib::vec3 d = sphere.center - camera.pos;
+            const float distance = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z) - sphere.radius;
+            const float scale = g.mesh->boundsRadius > 0 ? sphere.radius / g.mesh->boundsRadius : 1;
+            g.mesh = selectLod(renderable->mesh, scale, distance, frame.height, renderableLods[i]).get();
+        }
+        const Mesh& mesh = *g.mesh;
+        const size_t vertexCount = mesh.VertexCount();
+        g.normals.resize(mesh.HasNormals() ? vertexCount : 0);
+        g.projectedPoints.resize(vertexCount);
+        g.processedFaces.clear();
+        g.processedFaces.reserve(mesh.faces.size());
+        g.screenPoints.resize(vertexCount);
+        g.worldPoints.resize(frame.needWorldPoints ? vertexCount : 0);
+
+        if (mesh.quantized)
+            createProjectedSpace<true>(
+                *renderable, mesh, viewMatrix, perspectiveMat, g.projectedPoints, g.normals, g.worldPoints);
+        else
+            createProjectedSpace<false>(
+                *renderable, mesh, viewMatrix, perspectiveMat, g.projectedPoints, g.normals, g.worldPoints);
+        // Culling and clipping
+        for (const auto& f : mesh.faces)
+        {
+            makeClipSpace(f, g.projectedPoints, g.processedFaces);
+        }
+        createScreenSpace(g.projectedPoints, g.screenPoints, frame.width, frame.height);
+    }
+
+    // Raster pass: reads 'frame', and writes the z-buffer, the frame's pixels and the texture feedback.
+    void Renderer::rasterize(const Frame& frame)
+    {
+        const bool keepHistory = frame.checkerboard || frame.reprojectionCache;
+        if (keepHistory)
+            history.Begin(frame.width, frame.height, frame.viewProjection);
+        else
+            history.Invalidate();
+        // Every reprojectionRefresh-th frame is shaded in full, so reused colours are never more than that many
+        // frames old,
+        // and a change to the settings or the scene (shader, filter, lights...) is never drawn with old colours.
+        const bool reuse = frame.reprojectionCache && !frame.settingsChanged && history.Valid() &&
+                           framesSinceRefresh + 1 < reprojectionRefresh;
+        framesSinceRefresh = reuse ? framesSinceRefresh + 1 : 0;
+        shadingCache = reuse ? &history : nullptr;
+        // The rates come from the last frame drawn with them
+        if (frame.variableRate)
+            shadingRate.Resize(frame.width, frame.height);
+        else
+            shadingRate.Reset();
+
+        for (const auto& g : frame.geometry)
+        {
+            JobSystem::Get().ParallelFor(0, static_cast<int>(g.processedFaces.size()), [&](int i) {
+                drawTriangle(frame, *g.mesh, g, g.processedFaces[i]);
+            });
+        }
+        for (const auto& visible : frame.visibleInstances)
+        {
+            drawInstance(frame, visible);
+        }
+        if (frame.checkerboard)
+            checkerboard.Resolve(sdlSurface, *zBuffer, history);
+        else if (frame.reprojectionCache)
+            storeHistory();
+        if (keepHistory) history.Commit();
+        if (frame.variableRate) shadingRate.Update(sdlSurface, *zBuffer);
+
+        const uint64_t reused = reusedPixels.exchange(0);
+        const uint64_t shaded = shadedPixels.exchange(0);
+        reuseRate = reused + shaded ? static_cast<float>(reused) / static_cast<float>(reused + shaded) : 0;
+    }
+
+    // Records the frame, as drawn, in the history.
+    void Renderer::storeHistory()
+    {
+        auto* pixels = static_cast<unsigned char*>(sdlSurface->pixels);
+        JobSystem::Get().ParallelForRange(0, sdlSurface->h, [&](int first, int last) {
+            for (int y = first; y < last; ++y)
             {
-                makeClipSpace(f, projectedPoints, processedFaces);
+                history.StoreRow(
+                    y,
+                    reinterpret_cast<const uint32_t*>(pixels + y * sdlSurface->pitch),
+                    zBuffer->buffer.data() + y * zBuffer->width);
             }
-            createScreenSpace(projectedPoints, screenPoints);
+        });
+    }
 
-#pragma omp parallel for default(none) shared(processedFaces, screenPoints, renderable, projectedPoints, normals)
-            for (const auto& t : processedFaces)
+    void Renderer::rasterLoop()
+    {
+        std::unique_lock lock(rasterMutex);
+        while (true)
+        {
+            rasterWake.wait(lock, [this] { return stopping || rasterJob; });
+            if (!rasterJob) return;
+            const Frame* job = rasterJob;
+            lock.unlock();
+            rasterize(*job);
+            lock.lock();
+            rasterJob = nullptr;
+            rasterWake.notify_all();
+        }
+    }
+
+    /*
+     * The next frame is prepared before waiting for the one in flight, so its geometry pass overlaps that frame's
+     * raster pass (and whatever the application did since the last Render: GUI, present, events). Everything
+     * the raster pass touches besides its Frame (z-buffer, pixels, feedback, virtual texture pages) is only
+     * changed here once it has finished.
+     */
+    void Renderer::Render()
+    {
+        const bool wasStill = settleFrames == 0;
+        const float previousScale = resolutionScale;
+        if (dynamicResolution)
+        {
+            // The time since the last Render is the frame time the scale has to hold, whatever part of it the
+            // renderer is responsible for. Not if the view was still: the application may have idled since.
+            const Uint64 now = SDL_GetPerformanceCounter();
+            if (lastRenderTime != 0 && !wasStill)
             {
-                const auto& p1 = screenPoints[t.v1];
-                const auto& p2 = screenPoints[t.v2];
-                const auto& p3 = screenPoints[t.v3];
-
-                const float area = (p3.x - p1.x) * (p2.y - p1.y) -
-                                   (p3.y - p1.y) * (p2.x - p1.x); // area of the triangle multiplied by 2
-                if (area < 0) continue;                           // Backface culling
-                Rasterizer rasterizer(
-                    zBuffer.get(),
-                    *renderable,
-                    screenPoints,
-                    projectedPoints,
-                    normals,
-                    t,
-                    sdlSurface,
-                    fragmentShader,
-                    textureFilter);
-                rasterizer.rasterizeTriangle(area);
+                const double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+                const double frameMs = static_cast<double>(now - lastRenderTime) * 1000 / frequency;
+                resolutionScale = dynamicResolution->Update(frameMs);
             }
+            lastRenderTime = now;
+        }
+        Frame& frame = frames[nextFrame];
+        prepareFrame(frame);
+        nextFrame ^= 1;
+        Flush();
+
+        if (virtualTextures)
+        {
+            virtualTextures->Update(feedback);
+            feedback.Reset(frameCount++);
         }
+        // Anything that can make this frame differ from the last starts the settling frames again
+        frame.settingsChanged = changeCount != drawnChangeCount;
+        const bool changed = cameraMoved() || frame.settingsChanged || resolutionScale != previousScale;
+        settleFrames = changed || streaming() ? std::max(SETTLE_FRAMES, reprojectionRefresh)
+                                              : std::max(settleFrames - 1, 0);
+        drawnChangeCount = changeCount;
+        drawnCameraPos = camera.pos;
+        drawnCameraRotation = camera.rotation;
+
+        beginFrame(frame);
+        zBuffer->resize(frame.width, frame.height);
+        zBuffer->clear();
+        if (!pipelined)
+        {
+            rasterize(frame);
+            endFrame();
+            shownInputTime = frame.inputTime;
+            return;
+        }
+        std::lock_guard lock(rasterMutex);
+        if (!rasterThread.joinable()) rasterThread = std::thread(&Renderer::rasterLoop, this);
+        rasterJob = &frame;
+        inFlight = true;
+        inFlightInputTime = frame.inputTime;
+        rasterWake.notify_all();
+    }
+
+    void Renderer::Flush()
+    {
+        std::unique_lock lock(rasterMutex);
+        if (!inFlight) return;
+        rasterWake.wait(lock, [this] { return !rasterJob; });
+        inFlight = false;
+        endFrame();
+        shownInputTime = inFlightInputTime;
+    }
+
+    bool Renderer::cameraMoved() const
+    {
+        return camera.pos.x != drawnCameraPos.x || camera.pos.y != drawnCameraPos.y ||
+               camera.pos.z != drawnCameraPos.z || camera.rotation.x != drawnCameraRotation.x ||
+               camera.rotation.y != drawnCameraRotation.y || camera.rotation.z != drawnCameraRotation.z;
+    }
+
+    // Whether virtual texture pages or mesh chunks are still on their way.
+    bool Renderer::streaming()
+    {
+        if (virtualTextures && virtualTextures->PendingPages() != 0) return true;
+        return std::any_of(streamingMeshes.begin(), streamingMeshes.end(), [](StreamingMesh* mesh) {
+            return mesh->PendingChunks() != 0;
+        });
+    }
+
+    bool Renderer::NeedsRender() const
+    {
+        if (cameraInput && cameraInput->Pending()) return true;
+        return settleFrames > 0 || cameraMoved() || changeCount != drawnChangeCount;
+    }
+
+    void Renderer::RedrawLastFrame()
+    {
+        Flush();
+        if (frameTexture) SDL_RenderCopy(sdlRenderer, frameTexture, &frameRect, nullptr);
+    }
+
+    void Renderer::SetCameraInput(CameraInput* input)
+    {
+        ++changeCount;
+        cameraInput = input;
+    }
+
+    void Renderer::SetPipelined(bool enabled)
+    {
+        if (!enabled) Flush();
+        pipelined = enabled;
+    }
 
-        pushBuffer(sdlRenderer, sdlSurface);
+    const std::shared_ptr<const Mesh>& Renderer::selectLod(
+        const std::shared_ptr<const Mesh>& mesh, float scale, float distance, int frameHeight, int& level) const
+    {
+        const int levels = static_cast<int>(mesh->lods.size());
+        if (lodPixelError <= 0)
+        {
+            level = 0;
+            return mesh;
+        }
+        // Pixels covered by one model unit at that distance
+        const float pixelsPerUnit =
+            scale * perspectiveMat.data[1][1] * static_cast<float>(frameHeight) / 2 / std::max(distance, zNear);
+        int coarsest = 0;           // Coarsest level within the error
+        int coarsestWithMargin = 0; // Coarsest level within the error less the hysteresis
+        for (int i = 0; i < levels; ++i)
+        {
+            const float error = mesh->lods[i].error * pixelsPerUnit;
+            if (error <= lodPixelError) coarsest = i + 1;
+            if (error <= lodPixelError * (1 - lodHysteresis)) coarsestWithMargin = i + 1;
+        }
+        // Refine as soon as the level drawn is too coarse, but only coarsen with some margin
+        level = std::clamp(level, coarsestWithMargin, coarsest);
+        return level == 0 ? mesh : mesh->lods[level - 1].mesh;
     }
 
     void Renderer::AddRenderable(const Renderable* renderable)
     {
+        ++changeCount;
         renderables.push_back(renderable);
     }
 
+    void Renderer::AddInstances(const InstancedRenderable* batch)
+    {
+        ++changeCount;
+        instancedRenderables.push_back(batch);
+    }
+
+    void Renderer::AddStreamingMesh(StreamingMesh* mesh)
+    {
+        ++changeCount;
+        streamingMeshes.push_back(mesh);
+    }
+
+    void Renderer::SetVirtualTextures(VirtualTexturePool* pool)
+    {
+        Flush();
+        ++changeCount;
+        virtualTextures = pool;
+    }
+
     void Renderer::ClearRenderables()
     {
+        Flush();
+        ++changeCount;
         renderables.clear();
+        instancedRenderables.clear();
+        streamingMeshes.clear();
+        for (auto& frame : frames)
+        {
+            frame.geometry.clear();
+            frame.visibleInstances.clear();
+        }
+        renderableLods.clear();
+        instanceLods.clear();
+    }
+
+    void Renderer::SetLights(const std::vector<Light>& _lights)
+    {
+        Flush();
+        ++changeCount;
+        lights = _lights;
+        lightOverflowReported = false;
+        // The original hard-coded light: direction (1, 1, 1.5), unnormalised
+        if (lights.empty()) lights.push_back(Light::Directional({1, 1, 1.5}, std::sqrt(4.25f)));
+        for (auto& frame : frames)
+            frame.lightGrid.SetLights(&lights);
     }
 
     void Renderer::setShader(FragmentShader shader)
     {
-        if (shader == GOURAUD)
+        ++changeCount;
+        if (shader == GOURAUD || shader == PHONG)
         {
+            bool hasNormals = true;
             for (auto& renderable : renderables)
+                hasNormals = hasNormals && renderable->mesh->HasNormals();
+            for (auto& batch : instancedRenderables)
+                hasNormals = hasNormals && batch->mesh->HasNormals();
+            for (auto* mesh : streamingMeshes)
+                hasNormals = hasNormals && mesh->HasNormals();
+            if (!hasNormals)
             {
-                if (renderable->mesh.normals.empty())
-                {
-                    std::cout << "Warning: renderable does not have vertex normals. Falling back to flat shading.";
-                    fragmentShader = FLAT;
-                    return;
-                }
+                std::cout << "Warning: renderable does not have vertex normals. Falling back to flat shading.";
+                fragmentShader = FLAT;
+                return;
             }
         }
         fragmentShader = shader;
@@ -210,23 +898,138 @@ namespace soft3d
 
     void Renderer::setTextureFilter(TextureFilter filter)
     {
+        ++changeCount;
         textureFilter = filter;
     }
 
+    void Renderer::SetReprojectionCache(int refreshInterval)
+    {
+        ++changeCount;
+        reprojectionRefresh = std::max(refreshInterval, 0);
+    }
+
+    void Renderer::SetVariableRateShading(bool enabled)
+    {
+        ++changeCount;
+        variableRateShading = enabled;
+    }
+
+    void Renderer::SetCheckerboard(bool enabled)
+    {
+        ++changeCount;
+        checkerboardEnabled = enabled;
+    }
+
+    void Renderer::SetLodError(float pixels, float hysteresis)
+    {
+        ++changeCount;
+        lodPixelError = pixels;
+        lodHysteresis = std::clamp(hysteresis, 0.0f, 1.0f);
+    }
+
+    void Renderer::SetResolution(int _width, int _height)
+    {
+        Flush();
+        ++changeCount;
+        width = std::max(1, _width);
+        height = std::max(1, _height);
+        const float aspect = static_cast<float>(width) / static_cast<float>(height);
+        perspectiveMat = smath::perspective(zFar, zNear, aspect, fov);
+
+        if (frameTexture) SDL_DestroyTexture(frameTexture);
+        if (sdlSurface) SDL_FreeSurface(sdlSurface);
+        frameTexture = nullptr;
+        if (sdlRenderer)
+        {
+            frameTexture =
+                SDL_CreateTexture(sdlRenderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STREAMING, width, height);
+        }
+        if (frameTexture)
+        {
+            // The frame is opaque (the format has no alpha), so the copy needs no blending
+            SDL_SetTextureBlendMode(frameTexture, SDL_BLENDMODE_NONE);
+            SetUpscaleFilter(upscaleFilter);
+            sdlSurface = SDL_CreateRGBSurfaceFrom(nullptr, width, height, 32, width * 4, 0, 0, 0, 0);
+        }
+        else
+        {
+            sdlSurface = SDL_CreateRGBSurface(0, width, height, 32, 0, 0, 0, 0);
+        }
+        feedback.Resize(width, height);
+        zBuffer->resize(width, height);
+    }
+
+    void Renderer::SetResolutionScale(float scale)
+    {
+        ++changeCount;
+        dynamicResolution.reset();
+        resolutionScale = std::clamp(scale, 1.0f / static_cast<float>(std::min(width, height)), 1.0f);
+    }
+
+    void Renderer::SetDynamicResolution(double targetMs, float minScale)
+    {
+        ++changeCount;
+        if (targetMs <= 0)
+        {
+            dynamicResolution.reset();
+            return;
+        }
+        dynamicResolution = std::make_unique<DynamicResolution>(targetMs, minScale, 1.0f);
+        resolutionScale = dynamicResolution->Scale();
+        lastRenderTime = 0;
+    }
+
+    void Renderer::SetUpscaleFilter(TextureFilter filter)
+    {
+        ++changeCount;
+        upscaleFilter = filter;
+        if (frameTexture)
+            SDL_SetTextureScaleMode(frameTexture, filter == BILINEAR ? SDL_ScaleModeLinear : SDL_ScaleModeNearest);
+    }
+
+    std::vector<unsigned char> Renderer::ReadFrame()
+    {
+        Flush();
+        if (frameTexture)
+        {
+            int outputWidth, outputHeight;
+            SDL_GetRendererOutputSize(sdlRenderer, &outputWidth, &outputHeight);
+            std::vector<unsigned char> pixels(outputWidth * outputHeight * 4);
+            SDL_RenderReadPixels(sdlRenderer, nullptr, SDL_PIXELFORMAT_RGB888, pixels.data(), outputWidth * 4);
+            return pixels;
+        }
+        std::vector<unsigned char> pixels(sdlSurface->w * sdlSurface->h * 4);
+        const auto* rows = static_cast<const unsigned char*>(sdlSurface->pixels);
+        for (int y = 0; y < sdlSurface->h; ++y)
+            std::copy_n(rows + y * sdlSurface->pitch, sdlSurface->w * 4, pixels.data() + y * sdlSurface->w * 4);
+        return pixels;
+    }
+
     Renderer::~Renderer()
     {
+        Flush();
+        if (rasterThread.joinable())
+        {
+            {
+                std::lock_guard lock(rasterMutex);
+                stopping = true;
+            }
+            rasterWake.notify_all();
+            rasterThread.join();
+        }
+        if (frameTexture) SDL_DestroyTexture(frameTexture);
         SDL_FreeSurface(sdlSurface);
     }
 
     Renderer::Renderer(SDL_Renderer* _sdlRenderer)
         : zBuffer(std::make_unique<ZBuffer>()),
           sdlRenderer(_sdlRenderer),
-          perspectiveMat(smath::perspective(zFar, zNear, aspect, fov)),
+          perspectiveMat(smath::perspective(zFar, zNear, SCREEN_WIDTH / SCREEN_HEIGHT, fov)),
           viewMatrix(smath::fpsview({0, 0, 0}, 0, 0)),
-          sdlSurface(SDL_CreateRGBSurface(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, 0, 0, 0, 0)),
           camera(soft3d::Camera({0, 0, 5}, {0, 0, 0}, {0, 0, -1}, {0, 1, 0}, zFar, zNear))
     {
-        SDL_SetSurfaceBlendMode(sdlSurface, SDL_BLENDMODE_BLEND);
+        SetResolution(static_cast<int>(SCREEN_WIDTH), static_cast<int>(SCREEN_HEIGHT));
+        SetLights({});
     }
 
 } // namespace soft3d
\ No newline at end of file
@@ -4,14 +4,29 @@
 
 #pragma once
 #include "Camera.hpp"
+#include "CameraInput.hpp"
+#include "Checkerboard.hpp"
 #include "constants.hpp"
+#include "DynamicResolution.hpp"
+#include "Light.hpp"
+#include "LightGrid.hpp"
 #include "Mesh.hpp"
 #include "Rasterizer.hpp"
 #include "Renderable.hpp"
+#include "ShadingRate.hpp"
 #include "slib.hpp"
 #include "smath.hpp"
+#include "StreamingMesh.hpp"
+#include "VirtualTexture.hpp"
 #include "ZBuffer.hpp"
 #include <SDL2/SDL.h>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace soft3d
@@ -22,9 +37,7 @@ namespace soft3d
 
         static constexpr float zFar = 1000;
         static constexpr float zNear = 0.1;
-        static constexpr float aspect = SCREEN_WIDTH / SCREEN_HEIGHT;
         static constexpr float fov = 90;
-        static constexpr unsigned long screenSize = SCREEN_WIDTH * SCREEN_HEIGHT;
 
         std::unique_ptr<ZBuffer> zBuffer;
         void updateViewMatrix();
@@ -32,8 +45,139 @@ namespace soft3d
         SDL_Renderer* sdlRenderer;
         slib::mat perspectiveMat;
         slib::mat viewMatrix;
-        SDL_Surface* sdlSurface;
+        // The frame being drawn. With an SDL renderer its pixels are the locked frame texture, so the frame is
+        // drawn straight into the memory SDL copies to the screen; without one the surface owns them.
+        SDL_Surface* sdlSurface = nullptr;
+        SDL_Texture* frameTexture = nullptr; // Streaming, created once per resolution
+        SDL_Rect frameRect{};                // Part of the texture the frame covers
+        TextureFilter upscaleFilter = BILINEAR;
+
+        // Output resolution (the texture's), and the fraction of it on each axis that frames are drawn at
+        int width = 0, height = 0;
+        float resolutionScale = 1;
+        std::unique_ptr<DynamicResolution> dynamicResolution;
+        Uint64 lastRenderTime = 0;
+
+        CameraInput* cameraInput = nullptr;
+        // Input to present latency (see SetCameraInput)
+        static constexpr double LATENCY_SMOOTHING = 0.1; // Weight of each new frame in the average
+        Uint32 shownInputTime = 0; // Frame::inputTime of the frame handed to SDL, until it is presented
+        double inputLatency = 0;   // ms
+
+        struct Frame;
+        void beginFrame(const Frame& frame);
+        void endFrame();
         std::vector<const Renderable*> renderables;
+        std::vector<const InstancedRenderable*> instancedRenderables;
+        std::vector<StreamingMesh*> streamingMeshes;
+        std::vector<Light> lights;
+        bool lightOverflowReported = false; // Some tile had more lights than it takes (see SetLights)
+
+        // Per-renderable intermediate data, kept between the geometry and raster passes (and reused across
+        // frames).
+        struct RenderableGeometry
+        {
+            std::vector<slib::vec3> normals;
+            std::vector<slib::vec4> projectedPoints;
+            std::vector<slib::tri> processedFaces;
+            std::vector<slib::zvec2> screenPoints;
+            std::vector<slib::vec3> worldPoints;
+            const Mesh* mesh = nullptr; // The level of detail being drawn
+        };
+
+        // An instance that passed frustum culling. Drawn in order of increasing depth (clip w of its centre).
+        struct VisibleInstance
+        {
+            const InstancedRenderable::Instance* instance;
+            // The level of detail to draw. Held, since a streaming mesh may swap the batch's mesh before the
+            // frame is drawn.
+            std::shared_ptr<const Mesh> mesh;
+            float depth;
+        };
+
+        /*
+         * Everything the raster pass of one frame reads, so that the next frame can be prepared while it is
+         * drawn (see SetPipelined).
+         */
+        struct Frame
+        {
+            std::vector<RenderableGeometry> geometry;
+            std::vector<VisibleInstance> visibleInstances;
+            smath::mat4 viewProjection{}; // World to clip space, for the instances
+            slib::vec3 cameraPosition{};
+            LightGrid lightGrid;
+            FragmentShader fragmentShader = FLAT;
+            TextureFilter textureFilter = NEIGHBOUR;
+            bool needWorldPoints = false; // Only for specular and for point/spot light falloff
+            int width = 0, height = 0;    // Render resolution
+            bool checkerboard = false;
+            bool reprojectionCache = false;
+            bool settingsChanged = false; // A setting or the scene changed: shade in full, reuse nothing
+            bool variableRate = false;
+            Uint32 inputTime = 0; // Timestamp of the latest input it shows (CameraInput::Apply), 0 if none new
+        };
+        std::array<Frame, 2> frames;
+        int nextFrame = 0; // Slot the next frame is prepared in
+        RenderableGeometry instanceGeometry; // Shared by every instance: they are transformed and drawn in turn
+        void prepareFrame(Frame& frame);
+        void transformRenderable(Frame& frame, size_t i);
+        void cullInstances(Frame& frame);
+        void buildLightGrid(Frame& frame);
+        void rasterize(const Frame& frame);
+        void drawInstance(const Frame& frame, const VisibleInstance& visible);
+        void drawTriangle(const Frame& frame, const Mesh& mesh, const RenderableGeometry& g, const slib::tri& t);
+
+        // Draws a prepared frame while Render prepares the next one. Started by the first pipelined frame.
+        bool pipelined = false;
+        std::thread rasterThread;
+        std::mutex rasterMutex;
+        std::condition_variable rasterWake;
+        const Frame* rasterJob = nullptr; // Handed to the raster thread, nullptr once drawn
+        bool inFlight = false;            // A frame has been handed over and not yet passed to SDL
+        Uint32 inFlightInputTime = 0;     // Its Frame::inputTime
+        bool stopping = false;
+        void rasterLoop();
+
+        float lodPixelError = 1;
+        float lodHysteresis = 0.25f;
+        std::vector<int> renderableLods; // Level drawn last frame (0 = the renderable's own mesh)
+        std::unordered_map<const InstancedRenderable::Instance*, int> instanceLods;
+        // The level of 'mesh' to draw when its bounds, scaled by 'scale', are 'distance' from the camera in a
+        // frame 'frameHeight' pixels high. 'level' is the level drawn last time (0 = the mesh itself), and is
+        // updated.
+        const std::shared_ptr<const Mesh>& selectLod(
+            const std::shared_ptr<const Mesh>& mesh,
+            float scale,
+            float distance,
+            int frameHeight,
+            int& level) const;
+
+        VirtualTexturePool* virtualTextures = nullptr;
+        FeedbackBuffer feedback; // Pages sampled during the last frame, handed to the pool at the next
+
+        bool checkerboardEnabled = false;
+        int reprojectionRefresh = 0; // 0 when the reprojection cache is off
+        bool variableRateShading = false;
+        // Used by the raster pass only
+        Checkerboard checkerboard;
+        FrameHistory history;
+        const FrameHistory* shadingCache = nullptr; // The history, while frames reuse shading from it
+        int framesSinceRefresh = 0;
+        std::atomic<uint64_t> reusedPixels = 0, shadedPixels = 0;
+        std::atomic<float> reuseRate = 0; // Of the last frame drawn
+        ShadingRate shadingRate;
+        void storeHistory();
+        uint64_t frameCount = 0;
+
+        // Change tracking (see NeedsRender)
+        static constexpr int SETTLE_FRAMES = 2; // Drawn after a change: both checkerboard halves, the rate map
+        uint64_t changeCount = 1;               // Bumped by every setting and every change to the scene
+        uint64_t drawnChangeCount = 0;          // As of the last Render
+        slib::vec3 drawnCameraPos{}, drawnCameraRotation{};
+        int settleFrames = 0; // Frames still to draw before the view is still
+        [[nodiscard]] bool cameraMoved() const;
+        [[nodiscard]] bool streaming();
+
         FragmentShader fragmentShader = FLAT;
         TextureFilter textureFilter = NEIGHBOUR;
 
@@ -41,11 +185,115 @@ namespace soft3d
         bool wireFrame = false;
         Camera camera;
         void RenderBuffer();
+        /*
+         * Prepares a frame (streaming, culling, levels of detail, vertex transforms, light grid) and draws it.
+         * Pipelined (off by default), the frame is drawn on another thread while the next Render prepares the
+         * next one, and is handed to SDL by that next Render: frames reach the screen one Render late.
+         */
         void Render();
+        // Waits for the frame being drawn and hands it to SDL. Anything the frame reads (meshes, renderables)
+        // must not change until then.
+        void Flush();
+        /*
+         * Whether Render would draw anything new: the camera, a setting or the scene has changed since the last
+         * frame, or the frames after a change are still settling (assets streaming in, checkerboard halves,
+         * reprojection cache refreshes). If not, RedrawLastFrame shows the same frame for next to nothing.
+         */
+        [[nodiscard]] bool NeedsRender() const;
+        // Hands the last frame drawn to SDL again (finishing it first if it is in flight).
+        void RedrawLastFrame();
+        /*
+         * Takes the camera from 'input' (may be nullptr) at the start of each frame's geometry pass, the latest
+         * point it can still be drawn from, and measures the time from the latest input a frame shows to its
+         * present: from the SDL timestamp of the input's event to SDL_GetTicks after the present, in ms.
+         */
+        void SetCameraInput(CameraInput* input);
+        // Average time (ms) from input to the present of the first frame showing it.
+        [[nodiscard]] double InputLatency() const
+        {
+            return inputLatency;
+        }
+        void SetPipelined(bool enabled);
         void AddRenderable(const Renderable* renderable);
+        // Draws every instance of the batch. Like renderables, the batch must outlive its use by the renderer.
+        void AddInstances(const InstancedRenderable* batch);
+        // Draws the mesh's chunks as instances, updating which are resident before each frame. Like renderables,
+        // the mesh must outlive its use by the renderer.
+        void AddStreamingMesh(StreamingMesh* mesh);
         void ClearRenderables();
+        /*
+         * An empty list restores the default directional light. A tile takes at most
+         * LightGrid::MAX_LIGHTS_PER_TILE point and spot lights, the first ones in the list; the others are not
+         * drawn there (reported once per light list).
+         */
+        void SetLights(const std::vector<Light>& _lights);
         void setShader(FragmentShader shader);
         void setTextureFilter(TextureFilter filter);
+        /*
+         * Meshes with lods are drawn at the coarsest level whose error projects to at most 'pixels' on screen (0
+         * always draws the full meshes). A coarser level is only taken once its error is below
+         * pixels * (1 - hysteresis), so objects near a threshold do not flip between two levels.
+         */
+        void SetLodError(float pixels, float hysteresis = 0.25f);
+        // Shades half the pixels of each frame and reconstructs the rest from the previous one (Checkerboard).
+        void SetCheckerboard(bool enabled);
+        [[nodiscard]] bool Checkerboarded() const
+        {
+            return checkerboardEnabled;
+        }
+        /*
+         * Reuses the previous frame's colour for the pixels where it saw the same surface (the depths agree once
+         * reprojected; see FrameHistory), shading only the rest. Every 'refreshInterval' frames the frame is
+         * shaded in full, which bounds how stale a colour can get. 0 turns it off. Only meant for static scenes:
+         * moving lights or objects are not detected.
+         */
+        void SetReprojectionCache(int refreshInterval);
+        [[nodiscard]] int ReprojectionCache() const
+        {
+            return reprojectionRefresh;
+        }
+        /*
+         * Shades one pixel per 2x2 or 4x4 block where the previous frame was smooth or the material does not
+         * need more (untextured or heavily minified; see ShadingRate), and copies it to the block's other
+         * pixels. Coverage and depth stay per pixel.
+         */
+        void SetVariableRateShading(bool enabled);
+        [[nodiscard]] bool VariableRateShading() const
+        {
+            return variableRateShading;
+        }
+        // Fraction of the fragments of the last frame drawn whose colour came from the reprojection cache.
+        [[nodiscard]] float ReuseRate() const
+        {
+            return reuseRate;
+        }
+        // The pool that streams the virtual textures of the scene's meshes (may be nullptr). Updated between
+        // frames from what the previous frame sampled.
+        void SetVirtualTextures(VirtualTexturePool* pool);
+        /*
+         * The output resolution (SCREEN_WIDTH x SCREEN_HEIGHT to begin with). Frames are drawn at a fraction of
+         * it, the resolution scale, and stretched over the whole output with the upscale filter (BILINEAR or
+         * NEIGHBOUR) when they are handed to SDL.
+         */
+        void SetResolution(int _width, int _height);
+        // A fixed scale, in (0, 1]. Turns dynamic resolution off.
+        void SetResolutionScale(float scale);
+        /*
+         * Adjusts the scale between 'minScale' and 1 before each frame to keep the time between Render calls at
+         * 'targetMs': resolution goes before frame rate. 0 turns it off, keeping the current scale.
+         */
+        void SetDynamicResolution(double targetMs, float minScale = 0.5f);
+        [[nodiscard]] float ResolutionScale() const
+        {
+            return resolutionScale;
+        }
+        void SetUpscaleFilter(TextureFilter filter);
+        /*
+         * Copy of the last frame drawn (BGRA, rows packed), after a Flush. With an SDL renderer it is read back
+         * from the render target at the output size, so call it before anything else is drawn over it; without
+         * one it is the frame as drawn, at the render resolution.
+         */
+        [[nodiscard]] std::vector<unsigned char> ReadFrame();
 
         ~Renderer();
         explicit Renderer(SDL_Renderer* _sdlRenderer);
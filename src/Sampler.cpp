@@ -0,0 +1,45 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "Sampler.hpp"
+
+namespace soft3d
+{
+    template <slib::TextureFormat Format, slib::AddressMode Mode, bool Pow2>
+    SampleFn selectFilter(bool bilinear, bool atlas)
+    {
+        if (!bilinear) return &sampleNearest<Format, Mode, Pow2>;
+        return atlas ? &sampleBilinear<Format, Mode, Pow2, true> : &sampleBilinear<Format, Mode, Pow2, false>;
+    }
+
+    template <slib::TextureFormat Format, slib::AddressMode Mode>
+    SampleFn selectWrap(bool pow2, bool bilinear, bool atlas)
+    {
+        return pow2 ? selectFilter<Format, Mode, true>(bilinear, atlas)
+                    : selectFilter<Format, Mode, false>(bilinear, atlas);
+    }
+
+    template <slib::TextureFormat Format>
+    SampleFn selectAddressMode(slib::AddressMode addressMode, bool pow2, bool bilinear, bool atlas)
+    {
+        switch (addressMode)
+        {
+        case slib::CLAMP:
+            return selectWrap<Format, slib::CLAMP>(pow2, bilinear, atlas);
+        case slib::MIRROR:
+            return selectWrap<Format, slib::MIRROR>(pow2, bilinear, atlas);
+        case slib::REPEAT:
+        default:
+            return selectWrap<Format, slib::REPEAT>(pow2, bilinear, atlas);
+        }
+    }
+
+    SampleFn ResolveSampler(const slib::texture* texture, slib::AddressMode addressMode, bool bilinear, bool atlas)
+    {
+        if (!texture || texture->data.empty()) return nullptr;
+        const bool pow2 = (texture->w & (texture->w - 1)) == 0 && (texture->h & (texture->h - 1)) == 0;
+        if (texture->format == slib::BC1) return selectAddressMode<slib::BC1>(addressMode, pow2, bilinear, atlas);
+        return selectAddressMode<slib::RGBA8>(addressMode, pow2, bilinear, atlas);
+    }
+} // namespace soft3d
@@ -0,0 +1,160 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include "slib.hpp"
+#include "TextureCompression.hpp"
+#include <algorithm>
+
+namespace soft3d
+{
+    // Signature shared by every texture fetch function. 'tileSize' is only used by the atlas variants.
+    using SampleFn =
+        void (*)(const slib::texture& texture, int tileSize, float lum, float u, float v, int& r, int& g, int& b);
+
+    // Floor without going through libm (uv can be negative when repeating/mirroring).
+    inline int floorToInt(float f)
+    {
+        const int i = static_cast<int>(f);
+        return i - (f < static_cast<float>(i));
+    }
+
+    // Maps any texel coordinate into [0, size) for the given address mode.
+    // 'Pow2' lets the compiler use a bitmask instead of a modulo.
+    template <slib::AddressMode Mode, bool Pow2>
+    inline int wrapTexel(int i, int size)
+    {
+        if constexpr (Mode == slib::CLAMP)
+        {
+            return std::clamp(i, 0, size - 1);
+        }
+        else if constexpr (Mode == slib::REPEAT)
+        {
+            if constexpr (Pow2) return i & (size - 1);
+            i %= size;
+            return i < 0 ? i + size : i;
+        }
+        else // MIRROR
+        {
+            const int period = size << 1;
+            if constexpr (Pow2)
+                i &= period - 1;
+            else
+            {
+                i %= period;
+                i = i < 0 ? i + period : i;
+            }
+            return i < size ? i : period - 1 - i;
+        }
+    }
+
+    /*
+     * Returns the colour of texel (x, y). Compressed texels are decoded into 'scratch' (at least 3 bytes).
+     * 'Cached' decodes BC1 blocks through the per-thread block cache.
+     */
+    template <slib::TextureFormat Format, bool Cached = false>
+    inline const unsigned char* fetchTexel(const slib::texture& texture, int x, int y, unsigned char* scratch)
+    {
+        if constexpr (Format == slib::BC1)
+        {
+            if constexpr (Cached)
+                std::memcpy(scratch, bc1BlockCache.Texel(texture, x, y), 3);
+            else
+                DecodeBC1Texel(bc1Block(texture, x, y), x & 3, y & 3, scratch);
+            return scratch;
+        }
+        else
+        {
+            return texture.data.data() + (y * texture.w + x) * texture.bpp;
+        }
+    }
+
+    // GL_NEAREST
+    template <slib::TextureFormat Format, slib::AddressMode Mode, bool Pow2>
+    void sampleNearest(const slib::texture& texture, int, float lum, float u, float v, int& r, int& g, int& b)
+    {
+        // Convert to texture space
+        const int tx = wrapTexel<Mode, Pow2>(floorToInt(u * texture.w), texture.w);
+        const int ty = wrapTexel<Mode, Pow2>(floorToInt(v * texture.h), texture.h);
+
+        // Grab the corresponding pixel color on the texture
+        unsigned char scratch[3];
+        const unsigned char* texel = fetchTexel<Format>(texture, tx, ty, scratch);
+
+        if (lum > 1)
+        {
+            r = std::max(0, std::min(static_cast<int>(texel[0] * lum), 255));
+            g = std::max(0, std::min(static_cast<int>(texel[1] * lum), 255));
+            b = std::max(0, std::min(static_cast<int>(texel[2] * lum), 255));
+            return;
+        }
+
+        r = texel[0];
+        g = texel[1];
+        b = texel[2];
+    }
+
+    // GL_LINEAR
+    template <slib::TextureFormat Format, slib::AddressMode Mode, bool Pow2, bool Atlas>
+    void sampleBilinear(
+        const slib::texture& texture, int tileSize, float lum, float u, float v, int& r, int& g, int& b)
+    {
+        const float tx = u * texture.w;
+        const float ty = v * texture.h;
+        const int x = floorToInt(tx);
+        const int y = floorToInt(ty);
+
+        // Get the mantissa of the u/v
+        const float fracU = tx - static_cast<float>(x);
+        const float fracV = ty - static_cast<float>(y);
+
+        const int left = wrapTexel<Mode, Pow2>(x, texture.w);
+        const int top = wrapTexel<Mode, Pow2>(y, texture.h);
+        int right, bottom;
+
+        // If the texture uses an atlas, we need to ensure the pixels being sampled do not exceed the current
+        // tile's bounds
+        if constexpr (Atlas)
+        {
+            const int tileStartX = left - left % tileSize;
+            const int tileStartY = top - top % tileSize;
+            right = ((left + 1 - tileStartX) % tileSize) + tileStartX;
+            bottom = ((top + 1 - tileStartY) % tileSize) + tileStartY;
+        }
+        else
+        {
+            right = wrapTexel<Mode, Pow2>(x + 1, texture.w);
+            bottom = wrapTexel<Mode, Pow2>(y + 1, texture.h);
+        }
+
+        // Calculate the distance (weight) for each corner
+        const float ul = (1.0f - fracU) * (1.0f - fracV);
+        const float ll = (1.0f - fracU) * fracV;
+        const float ur = fracU * (1.0f - fracV);
+        const float lr = fracU * fracV;
+
+        // Above pixel samples
+        unsigned char scratch[4][3];
+        const unsigned char* tl = fetchTexel<Format, true>(texture, left, top, scratch[0]);
+        const unsigned char* tr = fetchTexel<Format, true>(texture, right, top, scratch[1]);
+        const unsigned char* bl = fetchTexel<Format, true>(texture, left, bottom, scratch[2]);
+        const unsigned char* br = fetchTexel<Format, true>(texture, right, bottom, scratch[3]);
+
+        const float red = ul * tl[0] + ll * bl[0] + ur * tr[0] + lr * br[0];
+        const float green = ul * tl[1] + ll * bl[1] + ur * tr[1] + lr * br[1];
+        const float blue = ul * tl[2] + ll * bl[2] + ur * tr[2] + lr * br[2];
+
+        r = std::max(0, std::min(static_cast<int>(red * lum), 255));
+        g = std::max(0, std::min(static_cast<int>(green * lum), 255));
+        b = std::max(0, std::min(static_cast<int>(blue * lum), 255));
+    }
+
+    /*
+     * Picks the fetch function specialised for the texture's format, the sampler's address mode, the filter and
+     * whether the texture's dimensions are powers of two. Returns nullptr if there is no texture or it is empty.
+     */
+    SampleFn ResolveSampler(
+        const slib::texture* texture, slib::AddressMode addressMode, bool bilinear, bool atlas);
+} // namespace soft3d
@@ -1,22 +1,83 @@
 //
 // Created by Steve Wheeler on 29/09/2023.
 //
+#include <chrono>
 #include <iostream>
 #include "Scene.hpp"
 
 namespace soft3d
 {
 
+void Scene::Prefetch()
+{
+    if (data || pending.valid()) return;
+    progress = 0;
+    error.clear();
+    pending = std::async(std::launch::async, [this] {
+        auto loaded = loader(assets, progress, error);
+        if (!loaded && error.empty()) error = "unknown error";
+        progress = 1;
+        return loaded;
+    });
+}
+
+bool Scene::IsLoaded()
+{
+    if (!data && pending.valid() && pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        data = pending.get();
+    return data != nullptr;
+}
+
+bool Scene::WaitUntilLoaded()
+{
+    Prefetch();
+    if (pending.valid()) data = pending.get();
+    return data != nullptr;
+}
+
 void Scene::LoadScene()
 {
     renderer.camera.pos = data->cameraStartPosition;
     renderer.camera.rotation = data->cameraStartRotation;
     renderer.setShader(data->fragmentShader);
     renderer.setTextureFilter(data->textureFilter);
+    renderer.SetLights(data->lights);
     renderer.ClearRenderables();
     for (const auto& renderable : data->renderables)
     {
         renderer.AddRenderable(renderable.get());
     }
+    for (const auto& batch : data->instancedRenderables)
+    {
+        renderer.AddInstances(batch.get());
+    }
+    for (const auto& mesh : data->streamingMeshes)
+    {
+        renderer.AddStreamingMesh(mesh.get());
+    }
+}
+
+void Scene::QuantizeMeshes()
+{
+    for (auto& renderable : data->renderables)
+    {
+        auto quantized = std::make_unique<Renderable>(
+            std::make_shared<const Mesh>(renderable->mesh->Quantized()),
+            renderable->position,
+            renderable->eulerAngles,
+            renderable->scale,
+            renderable->col);
+        quantized->ignoreLighting = renderable->ignoreLighting;
+        renderable = std::move(quantized);
+    }
+    for (auto& batch : data->instancedRenderables)
+    {
+        // The transforms and bounds carry over: the quantized mesh keeps the same bounding sphere
+        auto quantized = std::make_unique<InstancedRenderable>(
+            std::make_shared<const Mesh>(batch->mesh->Quantized()), batch->col);
+        quantized->ignoreLighting = batch->ignoreLighting;
+        quantized->instances = batch->instances;
+        batch = std::move(quantized);
+    }
 }
 }
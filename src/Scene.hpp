@@ -4,10 +4,14 @@
 
 #pragma once
 
+#include <atomic>
+#include <future>
+#include <string>
 #include <utility>
 #include <vector>
 #include <memory>
 
+#include "AssetRegistry.hpp"
 #include "Mesh.hpp"
 #include "Renderable.hpp"
 #include "Renderer.hpp"
@@ -15,15 +19,58 @@
 
 namespace soft3d
 {
+// Builds a scene's data, loading its assets through the registry. Runs on a background thread; 'progress' goes
+// from 0 to 1. nullptr (and 'error') if an asset cannot be loaded.
+using SceneLoader =
+    std::unique_ptr<SceneData> (*)(AssetRegistry& assets, std::atomic<float>& progress, std::string& error);
+
+/*
+ * A scene is registered with its loader and only loads its assets when first requested (Prefetch). Loading runs
+ * on a background thread, so the current scene can keep rendering until IsLoaded returns true.
+ */
 class Scene
 {
     Renderer& renderer;
+    AssetRegistry& assets;
+    SceneLoader loader;
     std::unique_ptr<SceneData> data;
+    std::atomic<float> progress = 0;
+    std::string error; // Written by the loader thread, read once 'pending' is ready
+    std::future<std::unique_ptr<SceneData>> pending; // Declared last: its destructor waits for the loader thread
 public:
+    // Starts loading in the background, unless the scene is already loaded or loading. Retries a failed load.
+    void Prefetch();
+    // True once the data is ready. Never blocks.
+    [[nodiscard]] bool IsLoaded();
+    [[nodiscard]] bool IsLoading() const
+    {
+        return pending.valid();
+    }
+    // Whether the last load failed (as of the last IsLoaded or WaitUntilLoaded), and why.
+    [[nodiscard]] bool Failed() const
+    {
+        return !data && !pending.valid() && !error.empty();
+    }
+    [[nodiscard]] const std::string& Error() const
+    {
+        return error;
+    }
+    // False if the load failed.
+    bool WaitUntilLoaded();
+    [[nodiscard]] float Progress() const
+    {
+        return progress.load(std::memory_order_relaxed);
+    }
+    // Hands the scene to the renderer. The scene must be loaded.
     void LoadScene();
-    explicit Scene(Renderer& _renderer, std::unique_ptr<SceneData> _data)
-    : renderer(_renderer), data(std::move(_data))
+    // Replaces every mesh with its quantized version (Mesh::Quantized). Call LoadScene again afterwards.
+    void QuantizeMeshes();
+    [[nodiscard]] const SceneData& Data() const
+    {
+        return *data;
+    }
+    Scene(Renderer& _renderer, AssetRegistry& _assets, SceneLoader _loader)
+    : renderer(_renderer), assets(_assets), loader(_loader)
     {};
 };
 }
-
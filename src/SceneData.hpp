@@ -3,7 +3,10 @@
 //
 
 #include <vector>
+#include "Light.hpp"
+#include "Rasterizer.hpp"
 #include "Renderable.hpp"
+#include "StreamingMesh.hpp"
 
 #pragma once
 
@@ -16,6 +19,9 @@ struct SceneData
     slib::vec3 cameraStartPosition{};
     slib::vec3 cameraStartRotation{};
     std::vector<std::unique_ptr<Renderable>> renderables;
+    std::vector<std::unique_ptr<InstancedRenderable>> instancedRenderables;
+    std::vector<std::unique_ptr<StreamingMesh>> streamingMeshes;
+    std::vector<Light> lights; // Empty: the default directional light
 };
 }
 
@@ -3,16 +3,16 @@
 //
 
 #include "SceneFactory.hpp"
-
-#include "ObjParser.hpp"
+#include <string>
 
 namespace soft3d
 {
-    std::unique_ptr<soft3d::Scene> spyroSceneInit(soft3d::Renderer& renderer)
+    std::unique_ptr<soft3d::SceneData> spyroSceneInit(
+        soft3d::AssetRegistry& assets, std::atomic<float>& progress, std::string& error)
     {
-        soft3d::Mesh mesh = ObjParser::ParseObj("resources/spyrolevel.obj");
-        mesh.atlas = true;
-        mesh.atlasTileSize = 32;
+        auto mesh =
+            assets.LoadMesh("resources/spyrolevel.obj", {.atlasTileSize = 32, .progress = &progress}, error);
+        if (!mesh) return nullptr;
         auto renderable = std::make_unique<soft3d::Renderable>(
             soft3d::Renderable(mesh, {0, 0, -25}, {0, 250, 0}, {.05, .05, .05}, {200, 100, 200}));
         auto sceneData = std::make_unique<soft3d::SceneData>();
@@ -21,14 +21,39 @@ namespace soft3d
         sceneData->cameraStartRotation = {0, 0, 0};
         sceneData->fragmentShader = soft3d::GOURAUD;
         sceneData->textureFilter = soft3d::BILINEAR;
-        return std::make_unique<soft3d::Scene>(renderer, std::move(sceneData));
+        return sceneData;
     }
 
-    std::unique_ptr<soft3d::Scene> isometricGameLevel(soft3d::Renderer& renderer)
+    // The spyro level streamed in chunks, with a budget that only holds the part around the camera.
+    std::unique_ptr<soft3d::SceneData> streamedLevelInit(
+        soft3d::AssetRegistry& assets, std::atomic<float>& progress, std::string& error)
     {
-        soft3d::Mesh mesh = ObjParser::ParseObj("resources/Isometric_Game_Level_Low_Poly.obj");
-        mesh.atlas = true;
-        mesh.atlasTileSize = 32;
+        auto level = soft3d::StreamingMesh::Open(
+            "resources/spyrolevel.obj",
+            {.atlasTileSize = 32, .assets = &assets},
+            {0, 0, -25},
+            {0, 250, 0},
+            {.05, .05, .05},
+            {200, 100, 200},
+            error);
+        if (!level) return nullptr;
+        level->SetBudget(256 << 10);
+        progress = 1;
+        auto sceneData = std::make_unique<soft3d::SceneData>();
+        sceneData->streamingMeshes.push_back(std::move(level));
+        sceneData->cameraStartPosition = {50, 20, 150};
+        sceneData->cameraStartRotation = {0, 0, 0};
+        sceneData->fragmentShader = soft3d::GOURAUD;
+        sceneData->textureFilter = soft3d::BILINEAR;
+        return sceneData;
+    }
+
+    std::unique_ptr<soft3d::SceneData> isometricGameLevel(
+        soft3d::AssetRegistry& assets, std::atomic<float>& progress, std::string& error)
+    {
+        auto mesh = assets.LoadMesh(
+            "resources/Isometric_Game_Level_Low_Poly.obj", {.atlasTileSize = 32, .progress = &progress}, error);
+        if (!mesh) return nullptr;
         auto renderable = std::make_unique<soft3d::Renderable>(
             soft3d::Renderable(mesh, {0, 0, -25}, {0, 250, 0}, {5, 5, 5}, {200, 100, 200}));
         auto sceneData = std::make_unique<soft3d::SceneData>();
@@ -37,12 +62,17 @@ namespace soft3d
         sceneData->cameraStartRotation = {-28, 32, 0};
         sceneData->fragmentShader = soft3d::GOURAUD;
         sceneData->textureFilter = soft3d::NEIGHBOUR;
-        return std::make_unique<soft3d::Scene>(renderer, std::move(sceneData));
+        return sceneData;
     }
 
-    std::unique_ptr<soft3d::Scene> concreteCatInit(soft3d::Renderer& renderer)
+    std::unique_ptr<soft3d::SceneData> concreteCatInit(
+        soft3d::AssetRegistry& assets, std::atomic<float>& progress, std::string& error)
     {
-        soft3d::Mesh mesh = ObjParser::ParseObj("resources/concrete_cat_statue.obj");
+        auto mesh = assets.LoadMesh(
+            "resources/concrete_cat_statue.obj",
+            {.compressTextures = true, .lodLevels = 6, .progress = &progress},
+            error);
+        if (!mesh) return nullptr;
         auto renderable = std::make_unique<soft3d::Renderable>(
             soft3d::Renderable(mesh, {0, -2, -1}, {0, 0, 0}, {10, 10, 10}, {200, 100, 200}));
         auto sceneData = std::make_unique<soft3d::SceneData>();
@@ -51,21 +81,59 @@ namespace soft3d
         sceneData->cameraStartRotation = {0, 0, 0};
         sceneData->fragmentShader = soft3d::FLAT;
         sceneData->textureFilter = soft3d::NEIGHBOUR;
-        return std::make_unique<soft3d::Scene>(renderer, std::move(sceneData));
+        return sceneData;
     }
 
-    std::unique_ptr<soft3d::Scene> vikingRoomSceneInit(soft3d::Renderer& renderer)
+    std::unique_ptr<soft3d::SceneData> vikingRoomSceneInit(
+        soft3d::AssetRegistry& assets, std::atomic<float>& progress, std::string& error)
     {
-        soft3d::Mesh mesh = ObjParser::ParseObj("resources/viking_room.obj");
+        auto mesh = assets.LoadMesh(
+            "resources/viking_room.obj", {.compressTextures = true, .progress = &progress}, error);
+        if (!mesh) return nullptr;
         auto renderable = std::make_unique<soft3d::Renderable>(
             soft3d::Renderable(mesh, {0, -5, -1}, {0, -135, 0}, {10, 10, 10}, {200, 100, 200}));
         auto sceneData = std::make_unique<soft3d::SceneData>();
 
         sceneData->renderables.push_back(std::move(renderable));
+        // Dim key light plus two lamps inside the room
+        sceneData->lights = {
+            soft3d::Light::Directional({1, 1, 1.5}, 0.8f),
+            soft3d::Light::Point({-3, 0, 2}, 12, 2),
+            soft3d::Light::Point({4, -2, -4}, 10, 1.5f)};
         sceneData->cameraStartPosition = {0, 0, 30};
         sceneData->cameraStartRotation = {0, 0, 0};
         sceneData->fragmentShader = soft3d::GOURAUD;
         sceneData->textureFilter = soft3d::NEIGHBOUR;
-        return std::make_unique<soft3d::Scene>(renderer, std::move(sceneData));
+        return sceneData;
+    }
+
+    // A village of viking rooms: one mesh, drawn as instances. Its texture is streamed, so distant rooms only
+    // keep the coarse pages resident, and distant rooms draw simplified versions of the mesh.
+    std::unique_ptr<soft3d::SceneData> vikingVillageInit(
+        soft3d::AssetRegistry& assets, std::atomic<float>& progress, std::string& error)
+    {
+        auto mesh = assets.LoadMesh(
+            "resources/viking_room.obj", {.lodLevels = 4, .progress = &progress, .virtualTextures = true}, error);
+        if (!mesh) return nullptr;
+        auto rooms = std::make_unique<soft3d::InstancedRenderable>(mesh, slib::Color{200, 100, 200});
+        constexpr int rows = 16;
+        constexpr int columns = 16;
+        for (int row = 0; row < rows; ++row)
+        {
+            for (int column = 0; column < columns; ++column)
+            {
+                const float x = (static_cast<float>(column) - (columns - 1) / 2.0f) * 8;
+                const float z = -static_cast<float>(row) * 8;
+                const float yaw = static_cast<float>((row * columns + column) * 37 % 360);
+                rooms->Add({x, -5, z}, {0, yaw, 0}, {3, 3, 3});
+            }
+        }
+        auto sceneData = std::make_unique<soft3d::SceneData>();
+        sceneData->instancedRenderables.push_back(std::move(rooms));
+        sceneData->cameraStartPosition = {0, 8, 20};
+        sceneData->cameraStartRotation = {-20, 0, 0};
+        sceneData->fragmentShader = soft3d::GOURAUD;
+        sceneData->textureFilter = soft3d::NEIGHBOUR;
+        return sceneData;
     }
 } // namespace soft3d
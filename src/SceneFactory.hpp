@@ -4,14 +4,24 @@
 
 #pragma once
 
-#include "Renderer.hpp"
-#include "Scene.hpp"
+#include "AssetRegistry.hpp"
+#include "SceneData.hpp"
+#include <atomic>
 #include <memory>
+#include <string>
 
 namespace soft3d
 {
-    std::unique_ptr<Scene> spyroSceneInit(Renderer& renderer);
-    std::unique_ptr<Scene> isometricGameLevel(Renderer& renderer);
-    std::unique_ptr<Scene> concreteCatInit(Renderer& renderer);
-    std::unique_ptr<Scene> vikingRoomSceneInit(Renderer& renderer);
+    std::unique_ptr<SceneData> spyroSceneInit(
+        AssetRegistry& assets, std::atomic<float>& progress, std::string& error);
+    std::unique_ptr<SceneData> isometricGameLevel(
+        AssetRegistry& assets, std::atomic<float>& progress, std::string& error);
+    std::unique_ptr<SceneData> concreteCatInit(
+        AssetRegistry& assets, std::atomic<float>& progress, std::string& error);
+    std::unique_ptr<SceneData> vikingRoomSceneInit(
+        AssetRegistry& assets, std::atomic<float>& progress, std::string& error);
+    std::unique_ptr<SceneData> vikingVillageInit(
+        AssetRegistry& assets, std::atomic<float>& progress, std::string& error);
+    std::unique_ptr<SceneData> streamedLevelInit(
+        AssetRegistry& assets, std::atomic<float>& progress, std::string& error);
 } // namespace soft3d
\ No newline at end of file
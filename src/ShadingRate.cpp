@@ -0,0 +1,81 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "ShadingRate.hpp"
+#include "JobSystem.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+namespace soft3d
+{
+    namespace
+    {
+        // Luma (0-255) of a pixel as bufferPixels writes it
+        int luminance(uint32_t colour)
+        {
+            const uint32_t r = colour >> 16 & 0xFF, g = colour >> 8 & 0xFF, b = colour & 0xFF;
+            return static_cast<int>((r * 77 + g * 150 + b * 29) >> 8);
+        }
+    } // namespace
+
+    void ShadingRate::Resize(int _width, int _height)
+    {
+        if (_width == width && _height == height) return;
+        width = _width;
+        height = _height;
+        tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+        tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+        rates.assign(static_cast<size_t>(tilesX) * tilesY, 1);
+    }
+
+    void ShadingRate::Reset()
+    {
+        std::fill(rates.begin(), rates.end(), 1);
+    }
+
+    void ShadingRate::Update(const SDL_Surface* surface, const ZBuffer& zBuffer)
+    {
+        const auto* pixels = static_cast<const unsigned char*>(surface->pixels);
+        const int pitch = surface->pitch;
+        JobSystem::Get().ParallelForRange(0, tilesY, [&](int first, int last) {
+            for (int tileY = first; tileY < last; ++tileY)
+            {
+                for (int tileX = 0; tileX < tilesX; ++tileX)
+                {
+                    // Largest change between neighbouring pixels of the same surface (background is skipped, so
+                    // silhouettes do not count: coverage is per pixel at any rate)
+                    int step = 0;
+                    const int xEnd = std::min((tileX + 1) * TILE_SIZE, width);
+                    const int yEnd = std::min((tileY + 1) * TILE_SIZE, height);
+                    for (int y = tileY * TILE_SIZE; y < yEnd; ++y)
+                    {
+                        const auto* row = reinterpret_cast<const uint32_t*>(pixels + y * pitch);
+                        const auto* below = reinterpret_cast<const uint32_t*>(pixels + (y + 1) * pitch);
+                        const float* depths = zBuffer.buffer.data() + y * zBuffer.width;
+                        for (int x = tileX * TILE_SIZE; x < xEnd; ++x)
+                        {
+                            if (depths[x] == 0) continue;
+                            const int l = luminance(row[x]);
+                            if (x + 1 < width && depths[x + 1] != 0)
+                                step = std::max(step, std::abs(luminance(row[x + 1]) - l));
+                            if (y + 1 < height && depths[x + zBuffer.width] != 0)
+                                step = std::max(step, std::abs(luminance(below[x]) - l));
+                        }
+                    }
+                    // A coarse tile changes in steps 'rate' pixels apart, so its change per pixel is the step
+                    // divided by the rate it was drawn at. A block of n pixels is off by up to (n - 1) of those.
+                    uint8_t& rate = rates[tileY * tilesX + tileX];
+                    const float gradient = static_cast<float>(step) / rate;
+                    rate = gradient * (MAX_RATE - 1) <= MAX_ERROR ? MAX_RATE : gradient <= MAX_ERROR ? 2 : 1;
+                }
+            }
+        });
+    }
+
+    int ShadingRate::MaterialRate(bool textured, bool specular, float texelDensity)
+    {
+        if (!textured) return specular ? 2 : MAX_RATE;
+        return texelDensity >= MINIFIED_DENSITY ? 2 : 1;
+    }
+} // namespace soft3d
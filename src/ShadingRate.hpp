@@ -0,0 +1,62 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include "ZBuffer.hpp"
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <vector>
+
+namespace soft3d
+{
+    /*
+     * Variable-rate shading. The screen is split into TILE_SIZE x TILE_SIZE tiles, each with a shading rate: the
+     * rasterizer shades one pixel of each triangle per rate x rate block and copies its colour to the rest of the
+     * block (coverage and depth stay per pixel). Each tile's rate comes from how fast luminance changed across it
+     * in the previous frame; the rasterizer can make a triangle coarser still from its material (see
+     * MaterialRate). Elsewhere only the lighting is shared, over LIGHTING_RATE blocks.
+     */
+    class ShadingRate
+    {
+      public:
+        static constexpr int TILE_SIZE = 16;
+        static constexpr int MAX_RATE = 4; // Blocks are aligned to multiples of this, which divides TILE_SIZE
+        // Largest luminance error (0-255) a coarse block is expected to make, from the change between pixels
+        static constexpr float MAX_ERROR = 8;
+        // Lighting alone is shared over blocks this size wherever it is per pixel: it changes slowly across a
+        // triangle, and the texture is still sampled at every pixel
+        static constexpr int LIGHTING_RATE = 2;
+        // Textures minified this much (texels per pixel) are shaded at rate 2
+        static constexpr float MINIFIED_DENSITY = 64;
+        // Triangles smaller than this (pixels) are always shaded per pixel
+        static constexpr float MIN_AREA = 16;
+
+        // Covers a width x height pixel frame. Resets every tile to full rate if the size changes.
+        void Resize(int width, int height);
+        // Every tile back to full rate, e.g. after frames drawn without the map.
+        void Reset();
+        // Chooses each tile's rate for the next frame from the frame just drawn (pixels as bufferPixels writes
+        // them, and its z-buffer).
+        void Update(const SDL_Surface* surface, const ZBuffer& zBuffer);
+
+        [[nodiscard]] int RateAt(int x, int y) const
+        {
+            return rates[(y / TILE_SIZE) * tilesX + x / TILE_SIZE];
+        }
+
+        /*
+         * Rate a triangle can be shaded at whatever the map says: untextured surfaces only vary with lighting
+         * (rate 2 with specular highlights, MAX_RATE without), and textures drawn at 'texelDensity' texels per
+         * pixel of at least MINIFIED_DENSITY lose little more detail at rate 2 than they already do to
+         * minification.
+         */
+        static int MaterialRate(bool textured, bool specular, float texelDensity);
+
+      private:
+        int width = 0, height = 0;
+        int tilesX = 0, tilesY = 0;
+        std::vector<uint8_t> rates;
+    };
+} // namespace soft3d
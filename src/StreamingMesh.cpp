@@ -0,0 +1,619 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "StreamingMesh.hpp"
+#include "MeshCache.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <unordered_map>
+
+namespace soft3d
+{
+    namespace
+    {
+        constexpr char chunkFileMagic[4] = {'S', '3', 'C', 'K'};
+        constexpr uint32_t chunkFileVersion = 1;
+
+        // Followed by the chunks' arrays. The tables (material library names, chunk records and material table)
+        // are at 'tableOffset', after the last chunk, so the file is written in one pass.
+        struct ChunkFileHeader
+        {
+            char magic[4];
+            uint32_t version;
+            uint64_t sourceSize;
+            int64_t sourceTime;
+            uint64_t tableOffset;
+            uint32_t chunkCount;
+            uint32_t materialLibCount;
+            uint32_t materialTableSize;
+            uint32_t maxChunkFaces;
+            uint32_t proxyGrid;
+            uint32_t reserved;
+        };
+
+        struct ChunkArrays
+        {
+            std::vector<slib::vec3> vertices;
+            std::vector<slib::tri> faces;
+            std::vector<slib::vec2> textureCoords;
+            std::vector<slib::vec3> normals;
+        };
+
+        bool sourceStamp(const std::string& path, uint64_t& size, int64_t& time)
+        {
+            std::error_code ec;
+            size = std::filesystem::file_size(path, ec);
+            if (ec) return false;
+            time = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+            return !ec;
+        }
+
+        template <typename T>
+        void writeArray(std::ostream& file, const std::vector<T>& values)
+        {
+            const auto bytes = static_cast<std::streamsize>(values.size() * sizeof(T));
+            file.write(reinterpret_cast<const char*>(values.data()), bytes);
+        }
+
+        template <typename T>
+        bool readArray(std::istream& file, std::vector<T>& values, size_t count)
+        {
+            values.resize(count);
+            const auto bytes = static_cast<std::streamsize>(count * sizeof(T));
+            return static_cast<bool>(file.read(reinterpret_cast<char*>(values.data()), bytes));
+        }
+
+        // Renumbers 'index' in order of first use, copying the value it refers to. -1 (unused) stays -1.
+        template <typename T>
+        int remap(std::unordered_map<int, int>& map, int index, std::span<const T> source, std::vector<T>& out)
+        {
+            if (index < 0) return -1;
+            auto [it, inserted] = map.emplace(index, static_cast<int>(out.size()));
+            if (inserted) out.push_back(source[index]);
+            return it->second;
+        }
+
+        /*
+         * Copies the faces into a self-contained chunk. Vertex and texture indices are renumbered; materials are
+         * numbered by their position in 'materialIds', which receives the mesh-wide ids the chunk uses.
+         */
+        ChunkArrays extractChunk(
+            const MeshCache& source, std::span<const uint32_t> faceIds, std::vector<uint32_t>& materialIds)
+        {
+            ChunkArrays chunk;
+            std::unordered_map<int, int> vertexMap, textureCoordMap, materialMap;
+            for (const uint32_t id : faceIds)
+            {
+                slib::tri t = source.faces[id];
+                for (int* v : {&t.v1, &t.v2, &t.v3})
+                    *v = remap(vertexMap, *v, source.vertices, chunk.vertices);
+                for (int* vt : {&t.vt1, &t.vt2, &t.vt3})
+                    *vt = remap(textureCoordMap, *vt, source.textureCoords, chunk.textureCoords);
+                auto [it, inserted] = materialMap.emplace(t.material, static_cast<int>(materialIds.size()));
+                if (inserted) materialIds.push_back(t.material);
+                t.material = it->second;
+                chunk.faces.push_back(t);
+            }
+            if (!source.normals.empty())
+            {
+                chunk.normals.resize(chunk.vertices.size());
+                for (const auto& [original, local] : vertexMap)
+                    chunk.normals[local] = source.normals[original];
+            }
+            return chunk;
+        }
+
+        // Bounding box centre and the distance to the farthest vertex from it (as Mesh computes its bounds).
+        void bounds(const std::vector<slib::vec3>& vertices, slib::vec3& center, float& radius)
+        {
+            slib::vec3 lo = vertices[0], hi = vertices[0];
+            for (const auto& v : vertices)
+            {
+                lo = {std::min(lo.x, v.x), std::min(lo.y, v.y), std::min(lo.z, v.z)};
+                hi = {std::max(hi.x, v.x), std::max(hi.y, v.y), std::max(hi.z, v.z)};
+            }
+            center = (lo + hi) * 0.5f;
+            float radiusSquared = 0;
+            for (const auto& v : vertices)
+            {
+                const slib::vec3 d = v - center;
+                radiusSquared = std::max(radiusSquared, d.x * d.x + d.y * d.y + d.z * d.z);
+            }
+            radius = std::sqrt(radiusSquared);
+        }
+
+        /*
+         * Vertex clustering: vertices in the same cell of a grid x grid x grid lattice over the chunk merge into
+         * their average, and the faces that collapse are dropped. Texture coordinates and materials are kept per
+         * face corner.
+         */
+        ChunkArrays buildProxy(const ChunkArrays& chunk, uint32_t grid)
+        {
+            slib::vec3 lo = chunk.vertices[0], hi = chunk.vertices[0];
+            for (const auto& v : chunk.vertices)
+            {
+                lo = {std::min(lo.x, v.x), std::min(lo.y, v.y), std::min(lo.z, v.z)};
+                hi = {std::max(hi.x, v.x), std::max(hi.y, v.y), std::max(hi.z, v.z)};
+            }
+            const float extent = std::max({hi.x - lo.x, hi.y - lo.y, hi.z - lo.z});
+            const float cellsPerUnit = extent > 0 ? static_cast<float>(grid) / extent : 0;
+            const auto cell = [&](float value, float origin) {
+                return std::min(static_cast<uint32_t>((value - origin) * cellsPerUnit), grid - 1);
+            };
+
+            ChunkArrays proxy;
+            std::unordered_map<uint32_t, int> clusters;
+            std::vector<int> clusterOf(chunk.vertices.size());
+            std::vector<int> counts;
+            for (size_t i = 0; i < chunk.vertices.size(); ++i)
+            {
+                const auto& v = chunk.vertices[i];
+                const uint32_t key = (cell(v.z, lo.z) * grid + cell(v.y, lo.y)) * grid + cell(v.x, lo.x);
+                auto [it, inserted] = clusters.emplace(key, static_cast<int>(proxy.vertices.size()));
+                if (inserted)
+                {
+                    proxy.vertices.push_back({0, 0, 0});
+                    if (!chunk.normals.empty()) proxy.normals.push_back({0, 0, 0});
+                    counts.push_back(0);
+                }
+                const int c = it->second;
+                clusterOf[i] = c;
+                proxy.vertices[c] += v;
+                if (!chunk.normals.empty()) proxy.normals[c] += chunk.normals[i];
+                ++counts[c];
+            }
+            for (size_t c = 0; c < proxy.vertices.size(); ++c)
+            {
+                proxy.vertices[c] /= static_cast<float>(counts[c]);
+                if (!proxy.normals.empty())
+                {
+                    const slib::vec3& n = proxy.normals[c];
+                    const float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+                    proxy.normals[c] = length > 0 ? n / length : slib::vec3{0, 1, 0};
+                }
+            }
+
+            std::unordered_map<int, int> textureCoordMap;
+            const std::span<const slib::vec2> textureCoords(chunk.textureCoords);
+            for (const auto& t : chunk.faces)
+            {
+                const int a = clusterOf[t.v1], b = clusterOf[t.v2], c = clusterOf[t.v3];
+                if (a == b || b == c || a == c) continue;
+                proxy.faces.push_back(
+                    {a,
+                     b,
+                     c,
+                     remap(textureCoordMap, t.vt1, textureCoords, proxy.textureCoords),
+                     remap(textureCoordMap, t.vt2, textureCoords, proxy.textureCoords),
+                     remap(textureCoordMap, t.vt3, textureCoords, proxy.textureCoords),
+                     t.material});
+            }
+            return proxy;
+        }
+
+        // Splits the faces at the median of their centroids along the longest axis until no part has more than
+        // 'maxFaces'.
+        void partition(
+            std::span<uint32_t> faceIds,
+            const std::vector<slib::vec3>& centroids,
+            uint32_t maxFaces,
+            std::vector<std::span<uint32_t>>& parts)
+        {
+            if (faceIds.size() <= maxFaces)
+            {
+                parts.push_back(faceIds);
+                return;
+            }
+            slib::vec3 lo = centroids[faceIds[0]], hi = lo;
+            for (const uint32_t id : faceIds)
+            {
+                const auto& p = centroids[id];
+                lo = {std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z)};
+                hi = {std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z)};
+            }
+            const slib::vec3 extent = hi - lo;
+            const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+            const auto middle = faceIds.begin() + static_cast<std::ptrdiff_t>(faceIds.size() / 2);
+            std::nth_element(faceIds.begin(), middle, faceIds.end(), [&](uint32_t a, uint32_t b) {
+                return (&centroids[a].x)[axis] < (&centroids[b].x)[axis];
+            });
+            const size_t half = faceIds.size() / 2;
+            partition(faceIds.first(half), centroids, maxFaces, parts);
+            partition(faceIds.subspan(half), centroids, maxFaces, parts);
+        }
+
+        size_t arrayBytes(const ChunkArrays& arrays)
+        {
+            return arrays.vertices.size() * sizeof(slib::vec3) + arrays.faces.size() * sizeof(slib::tri) +
+                   arrays.textureCoords.size() * sizeof(slib::vec2) + arrays.normals.size() * sizeof(slib::vec3);
+        }
+    } // namespace
+
+    bool StreamingMesh::BuildChunkFile(const std::string& objPath, std::string& error)
+    {
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        if (!sourceStamp(objPath, sourceSize, sourceTime))
+        {
+            error = "file not found";
+            return false;
+        }
+
+        // The mesh cache has the geometry in the form the chunks store it, plus the material libraries
+        if (!ObjParser::ParseObj(objPath.c_str(), {.loadTextures = false, .useMeshCache = true}, error))
+            return false;
+        const auto source = OpenMeshCache((objPath + ".mesh").c_str());
+        if (!source || source->vertices.empty())
+        {
+            error = "could not read the mesh cache of " + objPath;
+            return false;
+        }
+
+        std::vector<slib::vec3> centroids(source->faces.size());
+        std::vector<uint32_t> faceIds(source->faces.size());
+        for (size_t i = 0; i < source->faces.size(); ++i)
+        {
+            const auto& t = source->faces[i];
+            centroids[i] = (source->vertices[t.v1] + source->vertices[t.v2] + source->vertices[t.v3]) / 3;
+            faceIds[i] = static_cast<uint32_t>(i);
+        }
+        std::vector<std::span<uint32_t>> parts;
+        if (!faceIds.empty()) partition(faceIds, centroids, MAX_CHUNK_FACES, parts);
+
+        const std::string path = objPath + ".chunks";
+        const std::string tmpPath = path + ".tmp";
+        ChunkFileHeader header{};
+        std::memcpy(header.magic, chunkFileMagic, 4);
+        header.version = chunkFileVersion;
+        header.sourceSize = sourceSize;
+        header.sourceTime = sourceTime;
+        header.chunkCount = static_cast<uint32_t>(parts.size());
+        header.materialLibCount = static_cast<uint32_t>(source->materialLibs.size());
+        header.maxChunkFaces = MAX_CHUNK_FACES;
+        header.proxyGrid = PROXY_GRID;
+        {
+            std::ofstream file(tmpPath, std::ios::binary);
+            if (!file.is_open())
+            {
+                error = "could not write " + path;
+                return false;
+            }
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+            // One chunk in memory at a time
+            std::vector<ChunkRecord> records;
+            std::vector<uint32_t> materialTable;
+            uint64_t offset = sizeof(header);
+            for (const auto& part : parts)
+            {
+                ChunkRecord record{};
+                record.firstMaterial = static_cast<uint32_t>(materialTable.size());
+                std::vector<uint32_t> materialIds;
+                const ChunkArrays chunk = extractChunk(*source, part, materialIds);
+                const ChunkArrays proxy = buildProxy(chunk, PROXY_GRID);
+                materialTable.insert(materialTable.end(), materialIds.begin(), materialIds.end());
+                record.materialCount = static_cast<uint32_t>(materialIds.size());
+                slib::vec3 center{};
+                bounds(chunk.vertices, center, record.radius);
+                record.center[0] = center.x;
+                record.center[1] = center.y;
+                record.center[2] = center.z;
+
+                const std::pair<const ChunkArrays*, MeshRecord*> meshes[] = {
+                    {&chunk, &record.full}, {&proxy, &record.proxy}};
+                for (const auto& [arrays, meshRecord] : meshes)
+                {
+                    *meshRecord = {
+                        offset,
+                        static_cast<uint32_t>(arrays->vertices.size()),
+                        static_cast<uint32_t>(arrays->faces.size()),
+                        static_cast<uint32_t>(arrays->textureCoords.size()),
+                        static_cast<uint32_t>(arrays->normals.size())};
+                    writeArray(file, arrays->vertices);
+                    writeArray(file, arrays->faces);
+                    writeArray(file, arrays->textureCoords);
+                    writeArray(file, arrays->normals);
+                    offset += arrayBytes(*arrays);
+                }
+                records.push_back(record);
+            }
+
+            header.tableOffset = offset;
+            header.materialTableSize = static_cast<uint32_t>(materialTable.size());
+            for (const auto& lib : source->materialLibs)
+            {
+                const auto length = static_cast<uint32_t>(lib.size());
+                file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+                file.write(lib.data(), length);
+            }
+            writeArray(file, records);
+            writeArray(file, materialTable);
+            file.seekp(0);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            if (!file.good())
+            {
+                error = "could not write " + path;
+                return false;
+            }
+        }
+        std::error_code renameError;
+        std::filesystem::rename(tmpPath, path, renameError);
+        if (renameError) error = "could not write " + path;
+        return !renameError;
+    }
+
+    std::unique_ptr<StreamingMesh> StreamingMesh::Open(
+        const std::string& objPath,
+        const ObjParser::Options& options,
+        const slib::vec3& position,
+        const slib::vec3& eulerAngles,
+        const slib::vec3& scale,
+        slib::Color col,
+        std::string& error)
+    {
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        if (!sourceStamp(objPath, sourceSize, sourceTime))
+        {
+            error = "file not found";
+            return nullptr;
+        }
+
+        // Reads the tables if the chunk file was built from this version of the obj, with the current settings
+        std::unique_ptr<StreamingMesh> mesh(new StreamingMesh());
+        mesh->path = objPath + ".chunks";
+        std::vector<std::string> materialLibs;
+        std::vector<ChunkRecord> records;
+        auto readTables = [&](std::ifstream& file) {
+            ChunkFileHeader header{};
+            if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+            if (std::memcmp(header.magic, chunkFileMagic, 4) != 0 || header.version != chunkFileVersion ||
+                header.sourceSize != sourceSize || header.sourceTime != sourceTime ||
+                header.maxChunkFaces != MAX_CHUNK_FACES || header.proxyGrid != PROXY_GRID)
+                return false;
+            file.seekg(static_cast<std::streamoff>(header.tableOffset));
+            materialLibs.clear();
+            for (uint32_t i = 0; i < header.materialLibCount; ++i)
+            {
+                uint32_t length = 0;
+                if (!file.read(reinterpret_cast<char*>(&length), sizeof(length))) return false;
+                std::string lib(length, '\0');
+                if (!file.read(lib.data(), length)) return false;
+                materialLibs.push_back(std::move(lib));
+            }
+            if (!readArray(file, records, header.chunkCount)) return false;
+            if (!readArray(file, mesh->materialTable, header.materialTableSize)) return false;
+            for (const auto& record : records)
+            {
+                if (record.firstMaterial + record.materialCount > mesh->materialTable.size()) return false;
+            }
+            return true;
+        };
+        bool valid;
+        {
+            std::ifstream file(mesh->path, std::ios::binary);
+            valid = file.is_open() && readTables(file);
+        }
+        if (!valid)
+        {
+            if (!BuildChunkFile(objPath, error)) return nullptr;
+            std::ifstream file(mesh->path, std::ios::binary);
+            if (!file.is_open() || !readTables(file))
+            {
+                error = "could not read " + mesh->path;
+                return nullptr;
+            }
+        }
+
+        mesh->materials = ObjParser::LoadMaterials(materialLibs, options, error);
+        if (!error.empty()) return nullptr;
+        for (const uint32_t id : mesh->materialTable)
+        {
+            if (id >= mesh->materials.size())
+            {
+                error = "material out of range in " + mesh->path + " (rebuild it)";
+                return nullptr;
+            }
+        }
+        mesh->atlasTileSize = options.atlasTileSize;
+
+        std::ifstream file(mesh->path, std::ios::binary);
+        mesh->chunks.reserve(records.size());
+        mesh->batches.reserve(records.size());
+        for (const auto& record : records)
+        {
+            auto proxy = mesh->readMesh(file, record, true);
+            if (!proxy)
+            {
+                error = "could not read " + mesh->path;
+                return nullptr;
+            }
+            mesh->hasNormals = proxy->HasNormals();
+            mesh->proxyBytes += proxy->AttributeBytes() + proxy->faces.size_bytes();
+            const size_t bytes = record.full.vertexCount * sizeof(slib::vec3) +
+                                 record.full.faceCount * sizeof(slib::tri) +
+                                 record.full.textureCoordCount * sizeof(slib::vec2) +
+                                 record.full.normalCount * sizeof(slib::vec3) +
+                                 record.materialCount * sizeof(MaterialConstants);
+            mesh->batches.emplace_back(proxy, col);
+            mesh->batches.back().Add(position, eulerAngles, scale);
+            mesh->chunks.push_back({record, bytes, std::move(proxy), nullptr, 0, false, false});
+        }
+        mesh->order.resize(mesh->chunks.size());
+        mesh->loader = std::thread(&StreamingMesh::loadChunks, mesh.get());
+        return mesh;
+    }
+
+    // Reads the chunk (or its proxy) with its subset of the materials. nullptr if the file is short.
+    std::shared_ptr<const Mesh> StreamingMesh::readMesh(std::istream& file, const ChunkRecord& record, bool proxy)
+        const
+    {
+        const MeshRecord& counts = proxy ? record.proxy : record.full;
+        ChunkArrays arrays;
+        file.seekg(static_cast<std::streamoff>(counts.offset));
+        if (!readArray(file, arrays.vertices, counts.vertexCount) ||
+            !readArray(file, arrays.faces, counts.faceCount) ||
+            !readArray(file, arrays.textureCoords, counts.textureCoordCount) ||
+            !readArray(file, arrays.normals, counts.normalCount))
+        {
+            file.clear();
+            return nullptr;
+        }
+
+        std::vector<slib::material> chunkMaterials;
+        chunkMaterials.reserve(record.materialCount);
+        for (uint32_t i = 0; i < record.materialCount; ++i)
+            chunkMaterials.push_back(materials[materialTable[record.firstMaterial + i]]);
+        Mesh mesh(
+            std::move(arrays.vertices),
+            std::move(arrays.faces),
+            std::move(arrays.textureCoords),
+            std::move(arrays.normals),
+            std::move(chunkMaterials));
+        if (atlasTileSize > 0) mesh.SetAtlas(atlasTileSize);
+        // A proxy is culled by the sphere of the chunk it stands in for
+        mesh.boundsCenter = {record.center[0], record.center[1], record.center[2]};
+        mesh.boundsRadius = record.radius;
+        return std::make_shared<const Mesh>(std::move(mesh));
+    }
+
+    void StreamingMesh::Update(const slib::vec3& cameraPosition)
+    {
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            const auto& instance = batches[i].instances[0];
+            const slib::vec3 d = instance.center - cameraPosition;
+            chunks[i].distance = std::max(std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z) - instance.radius, 0.0f);
+            order[i] = static_cast<uint32_t>(i);
+        }
+        std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            return chunks[a].distance < chunks[b].distance;
+        });
+
+        // The nearest chunks that fit in the budget together are wanted
+        const size_t capacity = budget;
+        size_t wantedBytes = 0, missingBytes = 0;
+        bool full = false;
+        for (const uint32_t i : order)
+        {
+            Chunk& chunk = chunks[i];
+            if (chunk.unreadable)
+            {
+                chunk.wanted = false;
+                continue;
+            }
+            full = full || wantedBytes + chunk.bytes > capacity;
+            chunk.wanted = !full;
+            if (!chunk.wanted) continue;
+            wantedBytes += chunk.bytes;
+            if (!chunk.full) missingBytes += chunk.bytes;
+        }
+
+        // Unwanted chunks stay cached until the wanted ones need their room; the farthest go first
+        for (auto it = order.rbegin(); it != order.rend() && residentBytes + missingBytes > capacity; ++it)
+        {
+            Chunk& chunk = chunks[*it];
+            if (!chunk.full || chunk.wanted) continue;
+            chunk.full.reset();
+            batches[*it].mesh = chunk.proxy;
+            residentBytes -= chunk.bytes;
+            --residentChunks;
+        }
+
+        std::lock_guard lock(mutex);
+        for (auto& entry : loaded)
+        {
+            Chunk& chunk = chunks[entry.chunk];
+            if (!entry.mesh)
+            {
+                // Not asked for again, so that streaming can settle
+                chunk.unreadable = true;
+                if (!reportedUnreadable)
+                    std::cout << "Warning: could not read a chunk of " << path << ", drawing its proxy instead"
+                              << " (rebuild the file)" << std::endl;
+                reportedUnreadable = true;
+                continue;
+            }
+            if (!chunk.wanted || chunk.full) continue; // The camera moved on while it was loading
+            chunk.full = std::move(entry.mesh);
+            batches[entry.chunk].mesh = chunk.full;
+            residentBytes += chunk.bytes;
+            ++residentChunks;
+        }
+        loaded.clear();
+
+        requests.clear();
+        for (const uint32_t i : order)
+        {
+            if (chunks[i].wanted && !chunks[i].full && i != loading) requests.push_back(i);
+        }
+        if (!requests.empty()) wake.notify_one();
+    }
+
+    // Background thread: reads the requested chunks, nearest first.
+    void StreamingMesh::loadChunks()
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::unique_lock lock(mutex);
+        while (true)
+        {
+            wake.wait(lock, [this] { return stopping || !requests.empty(); });
+            if (stopping) return;
+            loading = requests.front();
+            requests.pop_front();
+            const ChunkRecord& record = chunks[loading].record;
+            lock.unlock();
+            auto mesh = readMesh(file, record, false);
+            lock.lock();
+            loaded.push_back({loading, std::move(mesh)}); // Also when it failed, for Update to mark the chunk
+            loading = NO_CHUNK;
+        }
+    }
+
+    void StreamingMesh::SetBudget(size_t bytes)
+    {
+        budget = bytes;
+    }
+
+    size_t StreamingMesh::Budget() const
+    {
+        return budget;
+    }
+
+    size_t StreamingMesh::ResidentBytes() const
+    {
+        return residentBytes;
+    }
+
+    size_t StreamingMesh::ProxyBytes() const
+    {
+        return proxyBytes;
+    }
+
+    size_t StreamingMesh::ResidentChunks() const
+    {
+        return residentChunks;
+    }
+
+    size_t StreamingMesh::PendingChunks()
+    {
+        std::lock_guard lock(mutex);
+        return requests.size() + (loading != NO_CHUNK) + loaded.size();
+    }
+
+    StreamingMesh::~StreamingMesh()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (loader.joinable()) loader.join();
+    }
+} // namespace soft3d
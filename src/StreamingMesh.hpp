@@ -0,0 +1,139 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include "Mesh.hpp"
+#include "ObjParser.hpp"
+#include "Renderable.hpp"
+#include "slib.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace soft3d
+{
+    /*
+     * A mesh that is too large to keep in memory. Its chunk file ("<obj>.chunks") splits the faces into spatial
+     * chunks of at most MAX_CHUNK_FACES, each with a coarse proxy (vertex clustering on a PROXY_GRID^3 grid).
+     * The proxies are always resident; the full chunks nearest the camera are read by a background thread and
+     * replace their proxies while they fit within Budget(), and the farthest are dropped again to make room.
+     * Each chunk is drawn as a single instance, so the renderer culls and sorts chunks like other instances.
+     */
+    class StreamingMesh
+    {
+      public:
+        static constexpr size_t DEFAULT_BUDGET = 16 << 20;
+        static constexpr uint32_t MAX_CHUNK_FACES = 1024;
+        static constexpr uint32_t PROXY_GRID = 16;
+
+        // Opens the obj's chunk file, building it first if it is missing or older than the obj. Materials (and
+        // atlasTileSize) come from 'options' as with ParseObj. Placed like a Renderable. nullptr (and 'error') on
+        // failure.
+        static std::unique_ptr<StreamingMesh> Open(
+            const std::string& objPath,
+            const ObjParser::Options& options,
+            const slib::vec3& position,
+            const slib::vec3& eulerAngles,
+            const slib::vec3& scale,
+            slib::Color col,
+            std::string& error);
+        // Writes "<obj>.chunks" from the obj (through its mesh cache). The whole model is loaded while building;
+        // use bake_assets to build it ahead of time.
+        static bool BuildChunkFile(const std::string& objPath, std::string& error);
+
+        /*
+         * Called by the renderer before culling each frame: installs the chunks loaded since the last call, drops
+         * the ones that no longer fit and queues the nearest missing ones. A frame still being drawn keeps its
+         * own references to the meshes it draws.
+         */
+        void Update(const slib::vec3& cameraPosition);
+
+        // One batch per chunk, holding a single instance. Its mesh is the full chunk if resident, else the proxy.
+        [[nodiscard]] const std::vector<InstancedRenderable>& Chunks() const
+        {
+            return batches;
+        }
+        [[nodiscard]] bool HasNormals() const
+        {
+            return hasNormals;
+        }
+
+        // Takes effect at the next Update.
+        void SetBudget(size_t bytes);
+        [[nodiscard]] size_t Budget() const;
+        [[nodiscard]] size_t ResidentBytes() const; // Full chunks only
+        [[nodiscard]] size_t ProxyBytes() const;
+        [[nodiscard]] size_t ResidentChunks() const;
+        [[nodiscard]] size_t PendingChunks();
+
+        StreamingMesh(const StreamingMesh&) = delete;
+        StreamingMesh& operator=(const StreamingMesh&) = delete;
+        ~StreamingMesh();
+
+      private:
+        static constexpr uint32_t NO_CHUNK = UINT32_MAX;
+
+        // Where a chunk's arrays are in the file, one after the other: vertices, faces, textureCoords, normals.
+        struct MeshRecord
+        {
+            uint64_t offset;
+            uint32_t vertexCount, faceCount, textureCoordCount, normalCount;
+        };
+        struct ChunkRecord
+        {
+            float center[3]; // Model space bounding sphere (of the full chunk; the proxy uses it too)
+            float radius;
+            uint32_t firstMaterial, materialCount; // Range of the material table that the faces index
+            MeshRecord full, proxy;
+        };
+        struct Chunk
+        {
+            ChunkRecord record;
+            size_t bytes; // Resident size of the full chunk
+            std::shared_ptr<const Mesh> proxy;
+            std::shared_ptr<const Mesh> full; // nullptr while not resident
+            float distance;
+            bool wanted;
+            bool unreadable; // The full chunk could not be read (short or corrupt file): only the proxy is drawn
+        };
+        struct Loaded
+        {
+            uint32_t chunk;
+            std::shared_ptr<const Mesh> mesh; // nullptr if it could not be read
+        };
+
+        std::string path;
+        std::vector<slib::material> materials;
+        std::vector<uint32_t> materialTable;
+        int atlasTileSize = 0;
+        bool hasNormals = false;
+        std::vector<Chunk> chunks;
+        std::vector<InstancedRenderable> batches; // Same indices as 'chunks'
+        std::vector<uint32_t> order;              // Chunks by distance from the camera, nearest first
+        std::atomic<size_t> budget = DEFAULT_BUDGET;
+        size_t residentBytes = 0;
+        size_t residentChunks = 0;
+        size_t proxyBytes = 0;
+        bool reportedUnreadable = false;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::thread loader;
+        bool stopping = false;
+        std::deque<uint32_t> requests; // Nearest first
+        uint32_t loading = NO_CHUNK;   // The chunk being read by the loader
+        std::vector<Loaded> loaded;
+
+        StreamingMesh() = default;
+        std::shared_ptr<const Mesh> readMesh(std::istream& file, const ChunkRecord& record, bool proxy) const;
+        void loadChunks();
+    };
+} // namespace soft3d
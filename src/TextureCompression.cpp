@@ -0,0 +1,136 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "TextureCompression.hpp"
+#include "JobSystem.hpp"
+#include <climits>
+
+namespace soft3d
+{
+    namespace
+    {
+        uint16_t pack565(const float* rgb)
+        {
+            const auto r = static_cast<uint16_t>(std::clamp(rgb[0], 0.0f, 255.0f) * 31 / 255 + 0.5f);
+            const auto g = static_cast<uint16_t>(std::clamp(rgb[1], 0.0f, 255.0f) * 63 / 255 + 0.5f);
+            const auto b = static_cast<uint16_t>(std::clamp(rgb[2], 0.0f, 255.0f) * 31 / 255 + 0.5f);
+            return r << 11 | g << 5 | b;
+        }
+
+        void encodeBlock(const unsigned char texels[16][3], unsigned char* block)
+        {
+            // Endpoints are the texels furthest apart along the diagonal of the block's colour bounding box,
+            // inset slightly to reduce the error of the interpolated colours.
+            float lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+            for (int i = 0; i < 16; ++i)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    lo[c] = std::min(lo[c], static_cast<float>(texels[i][c]));
+                    hi[c] = std::max(hi[c], static_cast<float>(texels[i][c]));
+                }
+            }
+            const float axis[3] = {hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]};
+            int minIdx = 0, maxIdx = 0;
+            float minProj = 1e9f, maxProj = -1e9f;
+            for (int i = 0; i < 16; ++i)
+            {
+                const float proj = texels[i][0] * axis[0] + texels[i][1] * axis[1] + texels[i][2] * axis[2];
+                if (proj < minProj)
+                {
+                    minProj = proj;
+                    minIdx = i;
+                }
+                if (proj > maxProj)
+                {
+                    maxProj = proj;
+                    maxIdx = i;
+                }
+            }
+
+            float e0[3], e1[3];
+            for (int c = 0; c < 3; ++c)
+            {
+                const float inset = (texels[maxIdx][c] - texels[minIdx][c]) / 16.0f;
+                e0[c] = texels[maxIdx][c] - inset;
+                e1[c] = texels[minIdx][c] + inset;
+            }
+            uint16_t c0 = pack565(e0);
+            uint16_t c1 = pack565(e1);
+            if (c0 < c1) std::swap(c0, c1); // c0 > c1 selects the four colour mode
+
+            block[0] = c0 & 0xFF;
+            block[1] = c0 >> 8;
+            block[2] = c1 & 0xFF;
+            block[3] = c1 >> 8;
+            std::fill_n(block + 4, 4, 0);
+            if (c0 == c1) return;
+
+            // Build the palette the same way the decoder does and pick the closest entry for each texel.
+            // (The first row temporarily indexes entries 0-3 in order.)
+            unsigned char palette[4][3];
+            block[4] = 0b11'10'01'00;
+            for (int i = 0; i < 4; ++i)
+                DecodeBC1Texel(block, i, 0, palette[i]);
+            block[4] = 0;
+
+            for (int i = 0; i < 16; ++i)
+            {
+                int best = 0;
+                int bestDist = INT_MAX;
+                for (int p = 0; p < 4; ++p)
+                {
+                    const int dr = texels[i][0] - palette[p][0];
+                    const int dg = texels[i][1] - palette[p][1];
+                    const int db = texels[i][2] - palette[p][2];
+                    const int dist = dr * dr + dg * dg + db * db;
+                    if (dist < bestDist)
+                    {
+                        bestDist = dist;
+                        best = p;
+                    }
+                }
+                block[4 + i / 4] |= best << ((i % 4) * 2);
+            }
+        }
+    } // namespace
+
+    void DecodeBC1Block(const unsigned char* block, unsigned char* rgba)
+    {
+        for (int y = 0; y < 4; ++y)
+        {
+            for (int x = 0; x < 4; ++x)
+            {
+                unsigned char* texel = rgba + (y * 4 + x) * 4;
+                DecodeBC1Texel(block, x, y, texel);
+                texel[3] = 255;
+            }
+        }
+    }
+
+    slib::texture CompressBC1(const slib::texture& texture)
+    {
+        const int blocksWide = (texture.w + 3) / 4;
+        const int blocksHigh = (texture.h + 3) / 4;
+        slib::texture compressed{texture.w, texture.h, {}, texture.bpp, slib::BC1};
+        compressed.data.resize(static_cast<size_t>(blocksWide) * blocksHigh * BC1_BLOCK_SIZE);
+
+        JobSystem::Get().ParallelFor(0, blocksHigh, [&](int by) {
+            for (int bx = 0; bx < blocksWide; ++bx)
+            {
+                unsigned char texels[16][3];
+                for (int i = 0; i < 16; ++i)
+                {
+                    // Repeat the edge texels to pad blocks that overhang the texture
+                    const int x = std::min(bx * 4 + i % 4, texture.w - 1);
+                    const int y = std::min(by * 4 + i / 4, texture.h - 1);
+                    const unsigned char* src = texture.data.data() + (y * texture.w + x) * texture.bpp;
+                    std::memcpy(texels[i], src, 3);
+                }
+                encodeBlock(texels, compressed.data.data() + (by * blocksWide + bx) * BC1_BLOCK_SIZE);
+            }
+        });
+        return compressed;
+    }
+} // namespace soft3d
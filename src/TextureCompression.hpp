@@ -0,0 +1,95 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include "slib.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace soft3d
+{
+    constexpr int BC1_BLOCK_SIZE = 8; // Bytes per 4x4 block
+
+    inline void unpack565(uint16_t c, unsigned char* rgb)
+    {
+        rgb[0] = static_cast<unsigned char>((c >> 11 & 0x1F) * 255 / 31);
+        rgb[1] = static_cast<unsigned char>((c >> 5 & 0x3F) * 255 / 63);
+        rgb[2] = static_cast<unsigned char>((c & 0x1F) * 255 / 31);
+    }
+
+    inline const unsigned char* bc1Block(const slib::texture& texture, int x, int y)
+    {
+        const int blocksWide = (texture.w + 3) >> 2;
+        return texture.data.data() + ((y >> 2) * blocksWide + (x >> 2)) * BC1_BLOCK_SIZE;
+    }
+
+    // Decodes a single texel of a BC1 block. 'x' and 'y' are the texel's position inside the block (0-3).
+    inline void DecodeBC1Texel(const unsigned char* block, int x, int y, unsigned char* rgb)
+    {
+        const uint16_t c0 = block[0] | block[1] << 8;
+        const uint16_t c1 = block[2] | block[3] << 8;
+        const int index = block[4 + y] >> (x * 2) & 0x3;
+
+        unsigned char e0[3], e1[3];
+        unpack565(c0, e0);
+        unpack565(c1, e1);
+        switch (index)
+        {
+        case 0:
+            std::memcpy(rgb, e0, 3);
+            return;
+        case 1:
+            std::memcpy(rgb, e1, 3);
+            return;
+        case 2:
+            for (int i = 0; i < 3; ++i)
+                rgb[i] = static_cast<unsigned char>((2 * e0[i] + e1[i]) / 3);
+            return;
+        default:
+            for (int i = 0; i < 3; ++i)
+                rgb[i] = static_cast<unsigned char>((e0[i] + 2 * e1[i]) / 3);
+        }
+    }
+
+    // Decodes a whole BC1 block into 16 RGBA texels (row-major).
+    void DecodeBC1Block(const unsigned char* block, unsigned char* rgba);
+
+    /*
+     * Small direct-mapped cache of decoded blocks, one per thread. The bilinear sampler's four taps usually land
+     * in the same block, so this saves decoding it up to four times.
+     * Keyed by the texture's id and the block's index, never by address: the workers outlive scenes, and a
+     * texture allocated where a freed one was must not hit the freed one's blocks.
+     */
+    struct BC1BlockCache
+    {
+        static constexpr int entries = 32;
+        struct Key
+        {
+            uint64_t texture = 0; // Ids start at 1
+            size_t block = 0;
+        };
+        Key keys[entries]{};
+        unsigned char texels[entries][16 * 4]{};
+
+        const unsigned char* Texel(const slib::texture& texture, int x, int y)
+        {
+            const size_t block = static_cast<size_t>(y >> 2) * ((texture.w + 3) >> 2) + (x >> 2);
+            const auto slot = (block ^ texture.id * 7) & (entries - 1);
+            Key& key = keys[slot];
+            if (key.texture != texture.id || key.block != block)
+            {
+                DecodeBC1Block(texture.data.data() + block * BC1_BLOCK_SIZE, texels[slot]);
+                key = {texture.id, block};
+            }
+            return texels[slot] + ((y & 3) * 4 + (x & 3)) * 4;
+        }
+    };
+
+    inline thread_local BC1BlockCache bc1BlockCache;
+
+    // Encodes an RGBA8 texture to BC1. Alpha is dropped.
+    slib::texture CompressBC1(const slib::texture& texture);
+} // namespace soft3d
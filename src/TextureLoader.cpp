@@ -0,0 +1,274 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "TextureLoader.hpp"
+#include "JobSystem.hpp"
+#include "lodepng.h"
+#include "MappedFile.hpp"
+#include "MeshCache.hpp"
+#include "TextureCompression.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <utility>
+
+namespace soft3d
+{
+    namespace
+    {
+        constexpr char cacheMagic[4] = {'S', '3', 'T', 'X'};
+        constexpr uint32_t cacheVersion = 1;
+
+        struct CacheHeader
+        {
+            char magic[4];
+            uint32_t version;
+            int32_t w, h;
+            uint32_t bpp;
+            int32_t format;
+            uint64_t sourceSize;
+            int64_t sourceTime;
+            uint64_t sourceHash;
+            uint64_t dataSize;
+        };
+
+        // One per distinct (path, format) in a batch.
+        struct Job
+        {
+            TextureRequest request;
+            std::string cachePath;
+            uint64_t sourceSize = 0;
+            int64_t sourceTime = 0;
+            uint64_t hash = 0; // Of the png's bytes
+            size_t owner = 0;  // The job that loads this content (itself, unless another file has the same bytes)
+            std::shared_ptr<const slib::texture> texture;
+            std::string error;
+            std::string warning;
+        };
+
+        // Bytes of texel data the header's size and format call for, 0 if they make no sense.
+        uint64_t expectedDataSize(const CacheHeader& header)
+        {
+            if (header.w <= 0 || header.h <= 0 || header.bpp == 0 || header.bpp > 4) return 0;
+            const auto w = static_cast<uint64_t>(header.w), h = static_cast<uint64_t>(header.h);
+            if (header.format == slib::BC1) return ((w + 3) / 4) * ((h + 3) / 4) * BC1_BLOCK_SIZE;
+            return header.format == slib::RGBA8 ? w * h * header.bpp : 0;
+        }
+
+        bool sourceStamp(Job& job)
+        {
+            std::error_code ec;
+            job.sourceSize = std::filesystem::file_size(job.request.path, ec);
+            if (ec) return false;
+            job.sourceTime = std::filesystem::last_write_time(job.request.path, ec).time_since_epoch().count();
+            return !ec;
+        }
+
+        /*
+         * Reads the job's cache file if it was written from the same png: same size and modification time, or
+         * (when 'hash' is given) the same contents. A hit by contents refreshes the stamp (if 'write') so the
+         * next load can skip hashing.
+         */
+        std::shared_ptr<const slib::texture> loadCache(
+            const Job& job, const uint64_t* hash, bool write, uint64_t& sourceHash)
+        {
+            std::ifstream file(job.cachePath, std::ios::binary);
+            if (!file.is_open()) return nullptr;
+
+            CacheHeader header{};
+            if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return nullptr;
+            if (std::memcmp(header.magic, cacheMagic, 4) != 0 || header.version != cacheVersion ||
+                header.format != job.request.format)
+                return nullptr;
+            const bool sameFile = header.sourceSize == job.sourceSize && header.sourceTime == job.sourceTime;
+            if (!sameFile && !(hash && header.sourceHash == *hash)) return nullptr;
+            // A corrupt or truncated cache is decoded again rather than trusted: the samplers index the data by
+            // the texture's size
+            std::error_code ec;
+            const uint64_t fileSize = std::filesystem::file_size(job.cachePath, ec);
+            if (ec || header.dataSize != expectedDataSize(header) || header.dataSize > fileSize - sizeof(header))
+                return nullptr;
+
+            auto texture = std::make_shared<slib::texture>(slib::texture{
+                header.w,
+                header.h,
+                std::vector<unsigned char>(header.dataSize),
+                header.bpp,
+                static_cast<slib::TextureFormat>(header.format)});
+            const auto dataSize = static_cast<std::streamsize>(header.dataSize);
+            if (!file.read(reinterpret_cast<char*>(texture->data.data()), dataSize)) return nullptr;
+            file.close();
+
+            if (!sameFile && write)
+            {
+                header.sourceSize = job.sourceSize;
+                header.sourceTime = job.sourceTime;
+                std::fstream out(job.cachePath, std::ios::binary | std::ios::in | std::ios::out);
+                out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            }
+            sourceHash = header.sourceHash;
+            return texture;
+        }
+
+        bool saveCache(const Job& job, const slib::texture& texture)
+        {
+            CacheHeader header{};
+            std::memcpy(header.magic, cacheMagic, 4);
+            header.version = cacheVersion;
+            header.w = texture.w;
+            header.h = texture.h;
+            header.bpp = texture.bpp;
+            header.format = texture.format;
+            header.sourceSize = job.sourceSize;
+            header.sourceTime = job.sourceTime;
+            header.sourceHash = job.hash;
+            header.dataSize = texture.data.size();
+
+            // Written to a temporary file first so a reader never sees a half-written cache
+            const std::string tmpPath = job.cachePath + ".tmp";
+            {
+                std::ofstream file(tmpPath, std::ios::binary);
+                if (!file.is_open()) return false;
+                file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                file.write(
+                    reinterpret_cast<const char*>(texture.data.data()),
+                    static_cast<std::streamsize>(texture.data.size()));
+                if (!file.good()) return false;
+            }
+            std::error_code error;
+            std::filesystem::rename(tmpPath, job.cachePath, error);
+            return !error;
+        }
+
+        bool decodePng(const MappedFile& png, slib::texture& texture, std::string& error)
+        {
+            std::vector<unsigned char> image; // RGBA8
+            unsigned width, height;
+            lodepng::State state;
+            const unsigned code = lodepng::decode(
+                image, width, height, state, reinterpret_cast<const unsigned char*>(png.Data()), png.Size());
+            if (code)
+            {
+                error = "decoder error " + std::to_string(code) + ": " + lodepng_error_text(code);
+                return false;
+            }
+
+            // Flip the rows so that v = 0 is the first row. (Textures start from the bottom left corner, our
+            // images are stored from the top left.) This saves the sampler from flipping every fragment.
+            const size_t stride = static_cast<size_t>(width) * 4;
+            for (unsigned row = 0; row < height / 2; ++row)
+            {
+                std::swap_ranges(
+                    image.begin() + row * stride,
+                    image.begin() + (row + 1) * stride,
+                    image.begin() + (height - 1 - row) * stride);
+            }
+
+            texture = {static_cast<int>(width), static_cast<int>(height), std::move(image), 4};
+            return true;
+        }
+    } // namespace
+
+    std::vector<LoadedTexture> LoadTextures(const std::vector<TextureRequest>& requests, bool writeCache)
+    {
+        std::vector<Job> jobs;
+        std::vector<size_t> requestJobs(requests.size());
+        std::map<std::pair<std::string, int>, size_t> jobIds;
+        for (size_t i = 0; i < requests.size(); ++i)
+        {
+            const auto& request = requests[i];
+            auto [it, inserted] = jobIds.emplace(std::make_pair(request.path, request.format), jobs.size());
+            if (inserted)
+            {
+                Job job;
+                job.request = request;
+                job.cachePath = request.path + (request.format == slib::BC1 ? ".bc1" : ".rgba");
+                job.owner = jobs.size();
+                jobs.push_back(std::move(job));
+            }
+            requestJobs[i] = it->second;
+        }
+
+        // Up to date caches are read straight away; every other png is mapped and hashed.
+        std::vector<std::optional<MappedFile>> sources(jobs.size());
+        auto& scheduler = JobSystem::Get();
+        scheduler.ParallelFor(
+            0,
+            static_cast<int>(jobs.size()),
+            [&](int i) {
+                Job& job = jobs[i];
+                if (!sourceStamp(job))
+                {
+                    job.error = "file not found";
+                    return;
+                }
+                job.texture = loadCache(job, nullptr, writeCache, job.hash);
+                if (job.texture) return;
+
+                sources[i].emplace(job.request.path.c_str());
+                if (!sources[i]->IsOpen())
+                {
+                    job.error = "could not open file";
+                    return;
+                }
+                job.hash = HashBytes(sources[i]->Data(), sources[i]->Size());
+            },
+            1);
+
+        // Files with identical contents (and format) are only decoded once
+        std::map<std::pair<uint64_t, int>, size_t> contentOwners;
+        for (size_t i = 0; i < jobs.size(); ++i)
+        {
+            if (jobs[i].texture) contentOwners.emplace(std::make_pair(jobs[i].hash, jobs[i].request.format), i);
+        }
+        std::vector<size_t> decodeJobs;
+        for (size_t i = 0; i < jobs.size(); ++i)
+        {
+            Job& job = jobs[i];
+            if (job.texture || !job.error.empty()) continue;
+            auto [it, inserted] = contentOwners.emplace(std::make_pair(job.hash, job.request.format), i);
+            job.owner = it->second;
+            if (inserted) decodeJobs.push_back(i);
+        }
+
+        // One job per png; BC1 compression splits further, so a lone large texture still uses every thread
+        scheduler.ParallelFor(
+            0,
+            static_cast<int>(decodeJobs.size()),
+            [&](int n) {
+                const size_t i = decodeJobs[n];
+                Job& job = jobs[i];
+                uint64_t sourceHash;
+                job.texture = loadCache(job, &job.hash, writeCache, sourceHash);
+                if (job.texture) return;
+
+                slib::texture texture;
+                if (!decodePng(*sources[i], texture, job.error)) return;
+                sources[i].reset();
+                if (job.request.format == slib::BC1) texture = CompressBC1(texture);
+                if (writeCache && !saveCache(job, texture))
+                    job.warning = "could not write texture cache " + job.cachePath;
+                job.texture = std::make_shared<const slib::texture>(std::move(texture));
+            },
+            1);
+
+        std::vector<LoadedTexture> loaded(requests.size());
+        for (size_t i = 0; i < requests.size(); ++i)
+        {
+            const Job& job = jobs[requestJobs[i]];
+            const Job& owner = jobs[job.owner];
+            loaded[i].texture = owner.texture;
+            loaded[i].hash = owner.hash;
+            loaded[i].error = job.error.empty() ? owner.error : job.error;
+        }
+        for (const auto& job : jobs)
+        {
+            if (!job.warning.empty()) std::cout << "Warning: " << job.warning << std::endl;
+        }
+        return loaded;
+    }
+} // namespace soft3d
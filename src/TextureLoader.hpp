@@ -0,0 +1,37 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include "slib.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace soft3d
+{
+    struct TextureRequest
+    {
+        std::string path;
+        slib::TextureFormat format = slib::RGBA8; // BC1: compress after decoding
+    };
+
+    struct LoadedTexture
+    {
+        std::shared_ptr<const slib::texture> texture; // nullptr if the texture could not be loaded
+        uint64_t hash = 0;                            // Of the png's contents
+        std::string error;
+    };
+
+    /*
+     * Loads a batch of textures. Requests for the same path (or for different files with the same contents) share
+     * one decode; the remaining pngs are decoded concurrently.
+     * With 'writeCache' the decoded (or compressed) pixels are kept next to the png ("<png>.rgba" / "<png>.bc1"),
+     * stamped with the png's size, modification time and content hash. Any load reads such a file instead of
+     * decoding if it is up to date; a touched but unchanged png still hits the cache through its hash.
+     * Never exits: failures are returned in the matching LoadedTexture, one result per request, in order.
+     */
+    std::vector<LoadedTexture> LoadTextures(const std::vector<TextureRequest>& requests, bool writeCache);
+} // namespace soft3d
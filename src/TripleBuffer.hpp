@@ -0,0 +1,49 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace soft3d
+{
+    /*
+     * Hands the latest value from one thread to another without locks. There are three copies: the writer's,
+     * the reader's and the latest complete one, and each side swaps its copy with the latest in one atomic
+     * exchange. Neither side ever waits; the reader gets the newest value written and values written in between
+     * are skipped. One writer thread and one reader thread only.
+     */
+    template <typename T>
+    class TripleBuffer
+    {
+      public:
+        void Write(const T& value)
+        {
+            slots[back] = value;
+            back = latest.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+        }
+
+        // The latest value written, if the reader has not had it yet.
+        bool Read(T& value)
+        {
+            if (!Fresh()) return false;
+            front = latest.exchange(front, std::memory_order_acq_rel) & INDEX;
+            value = slots[front];
+            return true;
+        }
+
+        [[nodiscard]] bool Fresh() const
+        {
+            return latest.load(std::memory_order_acquire) & FRESH;
+        }
+
+      private:
+        static constexpr uint8_t INDEX = 3, FRESH = 4; // Slot index and 'not read yet' bit of 'latest'
+        T slots[3]{};
+        uint8_t back = 0;  // Only used by the writer
+        uint8_t front = 1; // Only used by the reader
+        std::atomic<uint8_t> latest = 2;
+    };
+} // namespace soft3d
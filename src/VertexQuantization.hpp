@@ -0,0 +1,90 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include "slib.hpp"
+#include "smath.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace soft3d
+{
+    /*
+     * Compressed vertex (10 bytes instead of 24): position quantized to 16 bits per axis within the mesh's
+     * bounding box, and the normal octahedral-encoded as two signed 16-bit values.
+     */
+    struct QuantizedVertex
+    {
+        uint16_t position[3];
+        int16_t normal[2];
+    };
+
+    // Maps 0-65535 back to [offset, offset + 65535 * scale] per component.
+    struct QuantizationRange
+    {
+        slib::vec3 offset{};
+        slib::vec3 scale{};
+    };
+
+    inline uint16_t quantizeUnorm16(float value, float offset, float scale)
+    {
+        if (scale == 0) return 0;
+        return static_cast<uint16_t>(std::clamp(std::lround((value - offset) / scale), 0L, 65535L));
+    }
+
+    inline int16_t quantizeSnorm16(float value)
+    {
+        return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767));
+    }
+
+    // Octahedral normal encoding: project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over.
+    inline void octEncode(const slib::vec3& n, int16_t* out)
+    {
+        const float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        if (length == 0)
+        {
+            out[0] = out[1] = 0;
+            return;
+        }
+        float x = n.x / length;
+        float y = n.y / length;
+        if (n.z < 0)
+        {
+            const float fx = (1 - std::abs(y)) * (x >= 0 ? 1.0f : -1.0f);
+            const float fy = (1 - std::abs(x)) * (y >= 0 ? 1.0f : -1.0f);
+            x = fx;
+            y = fy;
+        }
+        out[0] = quantizeSnorm16(x);
+        out[1] = quantizeSnorm16(y);
+    }
+
+    inline slib::vec3 octDecode(const int16_t* in)
+    {
+        float x = static_cast<float>(in[0]) * (1.0f / 32767);
+        float y = static_cast<float>(in[1]) * (1.0f / 32767);
+        const float z = 1 - std::abs(x) - std::abs(y);
+        const float t = std::max(-z, 0.0f);
+        x += x >= 0 ? -t : t;
+        y += y >= 0 ? -t : t;
+        return smath::fastNormalize({x, y, z});
+    }
+
+    inline slib::vec3 dequantizePosition(const QuantizedVertex& v, const QuantizationRange& range)
+    {
+        return {
+            range.offset.x + static_cast<float>(v.position[0]) * range.scale.x,
+            range.offset.y + static_cast<float>(v.position[1]) * range.scale.y,
+            range.offset.z + static_cast<float>(v.position[2]) * range.scale.z};
+    }
+
+    inline slib::vec2 dequantizeTextureCoord(const uint16_t* uv, const QuantizationRange& range)
+    {
+        return {
+            range.offset.x + static_cast<float>(uv[0]) * range.scale.x,
+            range.offset.y + static_cast<float>(uv[1]) * range.scale.y};
+    }
+} // namespace soft3d
@@ -0,0 +1,568 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#include "VirtualTexture.hpp"
+#include "Sampler.hpp"
+#include "TextureLoader.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace soft3d
+{
+    namespace
+    {
+        constexpr char pageFileMagic[4] = {'S', '3', 'V', 'T'};
+        constexpr uint32_t pageFileVersion = 1;
+        constexpr uint32_t noPage = UINT32_MAX;
+
+        // Followed by the level table, the pages of the streamed levels, then the tail levels (RGBA8, unpadded).
+        struct PageFileHeader
+        {
+            char magic[4];
+            uint32_t version;
+            uint64_t sourceSize;
+            int64_t sourceTime;
+            int32_t levelCount;
+            int32_t firstTailLevel;
+            uint32_t pageCount;
+            uint32_t pageSize;
+        };
+
+        int wrap(int i, int size, slib::AddressMode mode)
+        {
+            switch (mode)
+            {
+            case slib::CLAMP:
+                return wrapTexel<slib::CLAMP, false>(i, size);
+            case slib::MIRROR:
+                return wrapTexel<slib::MIRROR, false>(i, size);
+            case slib::REPEAT:
+            default:
+                return wrapTexel<slib::REPEAT, false>(i, size);
+            }
+        }
+
+        // Same lighting rules as sampleNearest/sampleBilinear
+        inline void shadeTexel(const unsigned char* texel, float lum, int& r, int& g, int& b)
+        {
+            if (lum > 1)
+            {
+                r = std::max(0, std::min(static_cast<int>(texel[0] * lum), 255));
+                g = std::max(0, std::min(static_cast<int>(texel[1] * lum), 255));
+                b = std::max(0, std::min(static_cast<int>(texel[2] * lum), 255));
+                return;
+            }
+            r = texel[0];
+            g = texel[1];
+            b = texel[2];
+        }
+
+        inline void shadeTexels(
+            const unsigned char* tl,
+            const unsigned char* tr,
+            const unsigned char* bl,
+            const unsigned char* br,
+            float fracU,
+            float fracV,
+            float lum,
+            int& r,
+            int& g,
+            int& b)
+        {
+            const float ul = (1.0f - fracU) * (1.0f - fracV);
+            const float ll = (1.0f - fracU) * fracV;
+            const float ur = fracU * (1.0f - fracV);
+            const float lr = fracU * fracV;
+            const float red = ul * tl[0] + ll * bl[0] + ur * tr[0] + lr * br[0];
+            const float green = ul * tl[1] + ll * bl[1] + ur * tr[1] + lr * br[1];
+            const float blue = ul * tl[2] + ll * bl[2] + ur * tr[2] + lr * br[2];
+            r = std::max(0, std::min(static_cast<int>(red * lum), 255));
+            g = std::max(0, std::min(static_cast<int>(green * lum), 255));
+            b = std::max(0, std::min(static_cast<int>(blue * lum), 255));
+        }
+
+        // 2x2 box filter (the last row/column of odd sizes is repeated).
+        slib::texture downsample(const slib::texture& source)
+        {
+            slib::texture level{std::max(source.w / 2, 1), std::max(source.h / 2, 1), {}, 4};
+            level.data.resize(static_cast<size_t>(level.w) * level.h * 4);
+            for (int y = 0; y < level.h; ++y)
+            {
+                const int y0 = std::min(y * 2, source.h - 1), y1 = std::min(y * 2 + 1, source.h - 1);
+                for (int x = 0; x < level.w; ++x)
+                {
+                    const int x0 = std::min(x * 2, source.w - 1), x1 = std::min(x * 2 + 1, source.w - 1);
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        const int sum = source.data[(y0 * source.w + x0) * 4 + c] +
+                                        source.data[(y0 * source.w + x1) * 4 + c] +
+                                        source.data[(y1 * source.w + x0) * 4 + c] +
+                                        source.data[(y1 * source.w + x1) * 4 + c];
+                        level.data[(y * level.w + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                    }
+                }
+            }
+            return level;
+        }
+
+        // Decodes the png and writes its mip levels as pages. Written to a temporary file first, then renamed.
+        bool buildPageFile(
+            const std::string& pngPath,
+            const std::string& path,
+            uint64_t sourceSize,
+            int64_t sourceTime,
+            std::string& error)
+        {
+            auto decoded = LoadTextures({{pngPath, slib::RGBA8}}, false);
+            if (!decoded[0].texture)
+            {
+                error = decoded[0].error;
+                return false;
+            }
+            std::vector<slib::texture> mips{*decoded[0].texture};
+            decoded.clear();
+            while (mips.back().w > 1 || mips.back().h > 1)
+                mips.push_back(downsample(mips.back()));
+
+            constexpr int PAGE_SIZE = VirtualTexture::PAGE_SIZE;
+            constexpr int PAGE_BORDER = VirtualTexture::PAGE_BORDER;
+            constexpr int PAGE_STRIDE = VirtualTexture::PAGE_STRIDE;
+            std::vector<VirtualTexture::Level> levels;
+            int firstTailLevel = -1;
+            uint32_t pageCount = 0;
+            for (int i = 0; i < static_cast<int>(mips.size()); ++i)
+            {
+                const auto& mip = mips[i];
+                VirtualTexture::Level level{
+                    mip.w, mip.h, (mip.w + PAGE_SIZE - 1) / PAGE_SIZE, (mip.h + PAGE_SIZE - 1) / PAGE_SIZE, 0};
+                if (firstTailLevel < 0 && mip.w <= PAGE_SIZE && mip.h <= PAGE_SIZE) firstTailLevel = i;
+                if (firstTailLevel < 0)
+                {
+                    level.firstPage = pageCount;
+                    pageCount += level.pagesX * level.pagesY;
+                }
+                levels.push_back(level);
+            }
+
+            PageFileHeader header{};
+            std::memcpy(header.magic, pageFileMagic, 4);
+            header.version = pageFileVersion;
+            header.sourceSize = sourceSize;
+            header.sourceTime = sourceTime;
+            header.levelCount = static_cast<int32_t>(levels.size());
+            header.firstTailLevel = firstTailLevel;
+            header.pageCount = pageCount;
+            header.pageSize = PAGE_SIZE;
+
+            const std::string tmpPath = path + ".tmp";
+            {
+                std::ofstream file(tmpPath, std::ios::binary);
+                if (!file.is_open())
+                {
+                    error = "could not write " + path;
+                    return false;
+                }
+                file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                file.write(
+                    reinterpret_cast<const char*>(levels.data()),
+                    static_cast<std::streamsize>(levels.size() * sizeof(levels[0])));
+
+                // Each page carries a border of its neighbours' texels (wrapping at the edges of the level)
+                std::vector<unsigned char> page(VirtualTexture::PAGE_BYTES);
+                for (int i = 0; i < firstTailLevel; ++i)
+                {
+                    const auto& mip = mips[i];
+                    for (int py = 0; py < levels[i].pagesY; ++py)
+                    {
+                        for (int px = 0; px < levels[i].pagesX; ++px)
+                        {
+                            for (int y = 0; y < PAGE_STRIDE; ++y)
+                            {
+                                const int sy = wrap(py * PAGE_SIZE + y - PAGE_BORDER, mip.h, slib::REPEAT);
+                                for (int x = 0; x < PAGE_STRIDE; ++x)
+                                {
+                                    const int sx = wrap(px * PAGE_SIZE + x - PAGE_BORDER, mip.w, slib::REPEAT);
+                                    std::memcpy(
+                                        &page[(y * PAGE_STRIDE + x) * 4],
+                                        &mip.data[(sy * mip.w + sx) * 4],
+                                        4);
+                                }
+                            }
+                            file.write(
+                                reinterpret_cast<const char*>(page.data()),
+                                static_cast<std::streamsize>(page.size()));
+                        }
+                    }
+                }
+                for (int i = firstTailLevel; i < static_cast<int>(mips.size()); ++i)
+                {
+                    file.write(
+                        reinterpret_cast<const char*>(mips[i].data.data()),
+                        static_cast<std::streamsize>(mips[i].data.size()));
+                }
+                if (!file.good())
+                {
+                    error = "could not write " + path;
+                    return false;
+                }
+            }
+            std::error_code renameError;
+            std::filesystem::rename(tmpPath, path, renameError);
+            if (renameError) error = "could not write " + path;
+            return !renameError;
+        }
+    } // namespace
+
+    void FeedbackBuffer::Resize(int frameWidth, int frameHeight)
+    {
+        width = (frameWidth + FEEDBACK_SCALE - 1) / FEEDBACK_SCALE;
+        height = (frameHeight + FEEDBACK_SCALE - 1) / FEEDBACK_SCALE;
+        entries = std::make_unique<std::atomic<uint64_t>[]>(width * height);
+    }
+
+    void FeedbackBuffer::Reset(uint64_t frame)
+    {
+        for (int i = 0; i < width * height; ++i)
+            entries[i].store(0, std::memory_order_relaxed);
+        // Visit the pixels of a block in a scattered order (5 is coprime with 64), so a slow camera move still
+        // sees the whole block quickly
+        const int pixel = static_cast<int>(frame * 5 % (FEEDBACK_SCALE * FEEDBACK_SCALE));
+        offsetX = pixel % FEEDBACK_SCALE;
+        offsetY = pixel / FEEDBACK_SCALE;
+    }
+
+    int VirtualTexture::levelFor(float lod) const
+    {
+        if (!(lod > 0)) return 0;
+        return std::min(static_cast<int>(lod), static_cast<int>(levels.size()) - 1);
+    }
+
+    uint32_t VirtualTexture::pageAt(int level, float u, float v, slib::AddressMode mode) const
+    {
+        const Level& l = levels[level];
+        const int x = wrap(floorToInt(u * static_cast<float>(l.w)), l.w, mode);
+        const int y = wrap(floorToInt(v * static_cast<float>(l.h)), l.h, mode);
+        return l.firstPage + (y / PAGE_SIZE) * l.pagesX + x / PAGE_SIZE;
+    }
+
+    void VirtualTexture::Sample(
+        float u,
+        float v,
+        float lod,
+        slib::AddressMode mode,
+        bool bilinear,
+        float lum,
+        int& r,
+        int& g,
+        int& b) const
+    {
+        const int finest = levelFor(lod);
+        for (int level = finest; level < firstTailLevel; ++level)
+        {
+            const Level& l = levels[level];
+            const float tx = u * static_cast<float>(l.w);
+            const float ty = v * static_cast<float>(l.h);
+            const int x = wrap(floorToInt(tx), l.w, mode);
+            const int y = wrap(floorToInt(ty), l.h, mode);
+            const unsigned char* page = pageTable[l.firstPage + (y / PAGE_SIZE) * l.pagesX + x / PAGE_SIZE];
+            if (!page) continue; // Not streamed in yet: try the next coarser level
+
+            const unsigned char* texel =
+                page + ((y % PAGE_SIZE + PAGE_BORDER) * PAGE_STRIDE + x % PAGE_SIZE + PAGE_BORDER) * 4;
+            if (!bilinear)
+            {
+                shadeTexel(texel, lum, r, g, b);
+                return;
+            }
+            const float fracU = tx - std::floor(tx);
+            const float fracV = ty - std::floor(ty);
+            const unsigned char* below = texel + PAGE_STRIDE * 4;
+            shadeTexels(texel, texel + 4, below, below + 4, fracU, fracV, lum, r, g, b);
+            return;
+        }
+
+        // The tail is always resident
+        const int level = std::max(finest, firstTailLevel);
+        const Level& l = levels[level];
+        const unsigned char* texels = tail[level - firstTailLevel].data();
+        const float tx = u * static_cast<float>(l.w);
+        const float ty = v * static_cast<float>(l.h);
+        const int x = floorToInt(tx);
+        const int y = floorToInt(ty);
+        const int left = wrap(x, l.w, mode);
+        const int top = wrap(y, l.h, mode);
+        if (!bilinear)
+        {
+            shadeTexel(texels + (top * l.w + left) * 4, lum, r, g, b);
+            return;
+        }
+        const int right = wrap(x + 1, l.w, mode);
+        const int bottom = wrap(y + 1, l.h, mode);
+        shadeTexels(
+            texels + (top * l.w + left) * 4,
+            texels + (top * l.w + right) * 4,
+            texels + (bottom * l.w + left) * 4,
+            texels + (bottom * l.w + right) * 4,
+            tx - static_cast<float>(x),
+            ty - static_cast<float>(y),
+            lum,
+            r,
+            g,
+            b);
+    }
+
+    uint64_t VirtualTexture::FeedbackKey(float u, float v, float lod, slib::AddressMode mode) const
+    {
+        const int level = levelFor(lod);
+        if (level >= firstTailLevel) return 0;
+        return static_cast<uint64_t>(id) << 32 | pageAt(level, u, v, mode);
+    }
+
+    // The page covering the same area one level up, or noPage if that level is in the tail.
+    uint32_t VirtualTexture::parentPage(uint32_t page) const
+    {
+        int level = 0;
+        while (level + 1 < firstTailLevel && levels[level + 1].firstPage <= page)
+            ++level;
+        if (level + 1 >= firstTailLevel) return noPage;
+        const Level& l = levels[level];
+        const Level& parent = levels[level + 1];
+        const uint32_t local = page - l.firstPage;
+        const int px = std::min(static_cast<int>(local % l.pagesX) / 2, parent.pagesX - 1);
+        const int py = std::min(static_cast<int>(local / l.pagesX) / 2, parent.pagesY - 1);
+        return parent.firstPage + py * parent.pagesX + px;
+    }
+
+    VirtualTexture::~VirtualTexture()
+    {
+        if (pool) pool->release(*this);
+    }
+
+    std::shared_ptr<VirtualTexture> VirtualTexturePool::Open(const std::string& pngPath, std::string& error)
+    {
+        {
+            std::lock_guard lock(mutex);
+            if (auto texture = paths[pngPath].lock()) return texture;
+        }
+
+        std::error_code ec;
+        const uint64_t sourceSize = std::filesystem::file_size(pngPath, ec);
+        if (ec)
+        {
+            error = "file not found";
+            return nullptr;
+        }
+        const int64_t sourceTime = std::filesystem::last_write_time(pngPath, ec).time_since_epoch().count();
+
+        // Maps the page file if it was built from this version of the png and is complete
+        const std::string path = pngPath + ".vt";
+        auto openPageFile = [&]() -> std::shared_ptr<const MappedFile> {
+            auto file = std::make_shared<const MappedFile>(path.c_str());
+            if (!file->IsOpen() || file->Size() < sizeof(PageFileHeader)) return nullptr;
+            PageFileHeader header{};
+            std::memcpy(&header, file->Data(), sizeof(header));
+            if (std::memcmp(header.magic, pageFileMagic, 4) != 0 || header.version != pageFileVersion ||
+                header.sourceSize != sourceSize || header.sourceTime != sourceTime ||
+                header.pageSize != static_cast<uint32_t>(VirtualTexture::PAGE_SIZE) || header.levelCount < 1 ||
+                header.firstTailLevel < 0 || header.firstTailLevel >= header.levelCount)
+                return nullptr;
+            size_t expected = sizeof(header) + header.levelCount * sizeof(VirtualTexture::Level) +
+                              header.pageCount * VirtualTexture::PAGE_BYTES;
+            const auto* levels =
+                reinterpret_cast<const VirtualTexture::Level*>(file->Data() + sizeof(PageFileHeader));
+            for (int i = header.firstTailLevel; i < header.levelCount; ++i)
+                expected += static_cast<size_t>(levels[i].w) * levels[i].h * 4;
+            return file->Size() == expected ? file : nullptr;
+        };
+        auto file = openPageFile();
+        if (!file)
+        {
+            if (!buildPageFile(pngPath, path, sourceSize, sourceTime, error)) return nullptr;
+            file = openPageFile();
+            if (!file)
+            {
+                error = "could not read " + path;
+                return nullptr;
+            }
+        }
+
+        std::shared_ptr<VirtualTexture> texture(new VirtualTexture());
+        PageFileHeader header{};
+        std::memcpy(&header, file->Data(), sizeof(header));
+        const char* data = file->Data() + sizeof(header);
+        texture->levels.resize(header.levelCount);
+        std::memcpy(texture->levels.data(), data, header.levelCount * sizeof(VirtualTexture::Level));
+        texture->firstTailLevel = header.firstTailLevel;
+        texture->pageDataOffset = sizeof(header) + header.levelCount * sizeof(VirtualTexture::Level);
+        texture->pageTable.assign(header.pageCount, nullptr);
+        const char* tailData =
+            file->Data() + texture->pageDataOffset + header.pageCount * VirtualTexture::PAGE_BYTES;
+        for (int i = header.firstTailLevel; i < header.levelCount; ++i)
+        {
+            const size_t bytes = static_cast<size_t>(texture->levels[i].w) * texture->levels[i].h * 4;
+            texture->tail.emplace_back(tailData, tailData + bytes);
+            tailData += bytes;
+        }
+        texture->file = std::move(file);
+
+        std::lock_guard lock(mutex);
+        if (auto existing = paths[pngPath].lock()) return existing; // Another thread opened it first
+        texture->pool = this;
+        texture->id = nextId++;
+        textures[texture->id] = texture.get();
+        paths[pngPath] = texture;
+        if (!loader.joinable()) loader = std::thread(&VirtualTexturePool::loadPages, this);
+        return texture;
+    }
+
+    void VirtualTexturePool::Update(const FeedbackBuffer& feedback)
+    {
+        std::lock_guard lock(mutex);
+        ++frame;
+
+        // Sampled pages are marked as used; missing ones are queued after their missing parents, so that the
+        // fallback gets sharper one level at a time
+        const size_t queuedBefore = requests.size();
+        std::vector<uint64_t> chain;
+        for (int i = 0; i < feedback.Size(); ++i)
+        {
+            const uint64_t key = feedback.Entry(i);
+            if (!key) continue;
+            if (auto it = resident.find(key); it != resident.end())
+            {
+                it->second.lastUsed = frame;
+                continue;
+            }
+            const auto texture = textures.find(static_cast<uint32_t>(key >> 32));
+            if (texture == textures.end()) continue;
+
+            chain.clear();
+            for (uint32_t page = key & 0xFFFFFFFF; page != noPage; page = texture->second->parentPage(page))
+            {
+                const uint64_t pageKey = (key & 0xFFFFFFFF00000000) | page;
+                if (auto it = resident.find(pageKey); it != resident.end())
+                {
+                    it->second.lastUsed = frame;
+                    break;
+                }
+                if (queued.contains(pageKey)) break;
+                chain.push_back(pageKey);
+            }
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+            {
+                const size_t offset =
+                    texture->second->pageDataOffset + (*it & 0xFFFFFFFF) * VirtualTexture::PAGE_BYTES;
+                requests.push_back({*it, texture->second->file, offset});
+                queued.insert(*it);
+            }
+        }
+        while (requests.size() > MAX_QUEUED_PAGES)
+        {
+            queued.erase(requests.front().key);
+            requests.pop_front();
+        }
+
+        while (resident.size() > capacity && evictOldest(UINT64_MAX))
+            ;
+        for (auto& page : loaded)
+        {
+            queued.erase(page.key);
+            const auto texture = textures.find(static_cast<uint32_t>(page.key >> 32));
+            if (texture == textures.end()) continue; // Closed while it was loading
+            // Never evict a page that was sampled this frame; the new page is requested again later
+            if (resident.size() >= capacity && !evictOldest(frame)) continue;
+            const auto index = static_cast<uint32_t>(page.key & 0xFFFFFFFF);
+            texture->second->pageTable[index] = page.data.get();
+            resident.emplace(page.key, Resident{texture->second, index, frame, std::move(page.data)});
+        }
+        loaded.clear();
+        if (requests.size() != queuedBefore) wake.notify_one();
+    }
+
+    // Evicts the least recently used page last sampled before frame 'before'. False if there is none.
+    bool VirtualTexturePool::evictOldest(uint64_t before)
+    {
+        auto oldest = resident.end();
+        for (auto it = resident.begin(); it != resident.end(); ++it)
+        {
+            if (it->second.lastUsed < before &&
+                (oldest == resident.end() || it->second.lastUsed < oldest->second.lastUsed))
+                oldest = it;
+        }
+        if (oldest == resident.end()) return false;
+        oldest->second.texture->pageTable[oldest->second.page] = nullptr;
+        resident.erase(oldest);
+        return true;
+    }
+
+    // Background thread: copies requested pages out of the page files. The copy is what faults them in from disk.
+    void VirtualTexturePool::loadPages()
+    {
+        std::unique_lock lock(mutex);
+        while (true)
+        {
+            wake.wait(lock, [this] { return stopping || !requests.empty(); });
+            if (stopping) return;
+            const Request request = std::move(requests.front());
+            requests.pop_front();
+            lock.unlock();
+            auto data = std::make_unique<unsigned char[]>(VirtualTexture::PAGE_BYTES);
+            std::memcpy(data.get(), request.file->Data() + request.offset, VirtualTexture::PAGE_BYTES);
+            lock.lock();
+            loaded.push_back({request.key, std::move(data)});
+        }
+    }
+
+    void VirtualTexturePool::release(VirtualTexture& texture)
+    {
+        std::lock_guard lock(mutex);
+        textures.erase(texture.id);
+        std::erase_if(resident, [&](const auto& entry) { return entry.second.texture == &texture; });
+    }
+
+    void VirtualTexturePool::SetBudget(size_t bytes)
+    {
+        capacity = std::max<size_t>(bytes / VirtualTexture::PAGE_BYTES, 1);
+    }
+
+    size_t VirtualTexturePool::Budget() const
+    {
+        return capacity * VirtualTexture::PAGE_BYTES;
+    }
+
+    size_t VirtualTexturePool::ResidentBytes()
+    {
+        std::lock_guard lock(mutex);
+        return resident.size() * VirtualTexture::PAGE_BYTES;
+    }
+
+    size_t VirtualTexturePool::PendingPages()
+    {
+        std::lock_guard lock(mutex);
+        return queued.size();
+    }
+
+    VirtualTexturePool::VirtualTexturePool(size_t budgetBytes)
+    {
+        SetBudget(budgetBytes);
+    }
+
+    VirtualTexturePool::~VirtualTexturePool()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+            // Textures that outlive the pool must not call back into it, or sample its pages
+            for (auto& [id, texture] : textures)
+                texture->pool = nullptr;
+            for (auto& [key, page] : resident)
+                page.texture->pageTable[page.page] = nullptr;
+        }
+        wake.notify_all();
+        if (loader.joinable()) loader.join();
+    }
+} // namespace soft3d
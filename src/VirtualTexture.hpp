@@ -0,0 +1,201 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+#pragma once
+
+#include "constants.hpp"
+#include "MappedFile.hpp"
+#include "slib.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace soft3d
+{
+    class VirtualTexturePool;
+
+    /*
+     * Which texture pages the rasterizer sampled: one entry per FEEDBACK_SCALE x FEEDBACK_SCALE block of pixels.
+     * Each frame records a different pixel of the block, so every pixel is seen over FEEDBACK_SCALE^2 frames.
+     * Entries are written concurrently by the raster threads.
+     */
+    class FeedbackBuffer
+    {
+      public:
+        static constexpr int FEEDBACK_SCALE = 8;
+
+        // Room for frames of up to frameWidth x frameHeight pixels. Clears the entries.
+        void Resize(int frameWidth, int frameHeight);
+        // Clears the entries and moves on to the next pixel of each block.
+        void Reset(uint64_t frame);
+        [[nodiscard]] bool Samples(int x, int y) const
+        {
+            return x % FEEDBACK_SCALE == offsetX && y % FEEDBACK_SCALE == offsetY;
+        }
+        void Record(int x, int y, uint64_t key)
+        {
+            entries[(y / FEEDBACK_SCALE) * width + x / FEEDBACK_SCALE].store(key, std::memory_order_relaxed);
+        }
+        [[nodiscard]] uint64_t Entry(int i) const
+        {
+            return entries[i].load(std::memory_order_relaxed);
+        }
+        [[nodiscard]] int Size() const
+        {
+            return width * height;
+        }
+
+      private:
+        int width = (static_cast<int>(SCREEN_WIDTH) + FEEDBACK_SCALE - 1) / FEEDBACK_SCALE;
+        int height = (static_cast<int>(SCREEN_HEIGHT) + FEEDBACK_SCALE - 1) / FEEDBACK_SCALE;
+        std::unique_ptr<std::atomic<uint64_t>[]> entries =
+            std::make_unique<std::atomic<uint64_t>[]>(width * height);
+        int offsetX = 0, offsetY = 0;
+    };
+
+    /*
+     * A texture that is streamed in pages instead of being kept whole in memory. Its page file ("<png>.vt") holds
+     * every mip level cut into PAGE_SIZE x PAGE_SIZE pages, each with a border copied from its neighbours so that
+     * bilinear filtering never leaves the page. The small levels that fit in a single page (the "tail") are always
+     * resident; the other pages are loaded on demand by the pool.
+     * Sampling falls back to the next coarser level until it finds a resident page.
+     */
+    class VirtualTexture
+    {
+      public:
+        static constexpr int PAGE_SIZE = 64;
+        static constexpr int PAGE_BORDER = 1;
+        static constexpr int PAGE_STRIDE = PAGE_SIZE + 2 * PAGE_BORDER;
+        static constexpr size_t PAGE_BYTES = PAGE_STRIDE * PAGE_STRIDE * 4; // RGBA8
+
+        struct Level
+        {
+            int32_t w, h;
+            int32_t pagesX, pagesY;
+            uint32_t firstPage; // Index of the level's first page (streamed levels only)
+        };
+
+        /*
+         * Samples (u, v) at mip level 'lod' (0 = full size), or at the finest coarser level that is resident.
+         * Colours are scaled by 'lum' the same way as the regular samplers (Sampler.hpp).
+         */
+        void Sample(
+            float u, float v, float lod, slib::AddressMode mode, bool bilinear, float lum, int& r, int& g, int& b)
+            const;
+        // Key of the page holding (u, v) at 'lod', for the feedback buffer. 0 if that level is always resident.
+        [[nodiscard]] uint64_t FeedbackKey(float u, float v, float lod, slib::AddressMode mode) const;
+        [[nodiscard]] int Width() const
+        {
+            return levels[0].w;
+        }
+        [[nodiscard]] int Height() const
+        {
+            return levels[0].h;
+        }
+
+        VirtualTexture(const VirtualTexture&) = delete;
+        VirtualTexture& operator=(const VirtualTexture&) = delete;
+        ~VirtualTexture();
+
+      private:
+        friend class VirtualTexturePool;
+        VirtualTexture() = default;
+
+        VirtualTexturePool* pool = nullptr;
+        uint32_t id = 0;
+        std::shared_ptr<const MappedFile> file;
+        size_t pageDataOffset = 0; // Of the first page in 'file'
+        std::vector<Level> levels;
+        int firstTailLevel = 0;
+        std::vector<std::vector<unsigned char>> tail; // RGBA8 levels from firstTailLevel on
+        // One entry per streamed page, nullptr while it is not resident. Only changed by
+        // VirtualTexturePool::Update, between frames, so the rasterizer reads it without locking.
+        std::vector<const unsigned char*> pageTable;
+
+        [[nodiscard]] int levelFor(float lod) const;
+        [[nodiscard]] uint32_t pageAt(int level, float u, float v, slib::AddressMode mode) const;
+        [[nodiscard]] uint32_t parentPage(uint32_t page) const;
+    };
+
+    /*
+     * The physical page cache shared by every virtual texture: at most Budget() bytes of streamed pages. Pages the
+     * feedback buffer asks for are read by a background thread and installed at the next Update, evicting the
+     * least recently sampled pages when the cache is full.
+     */
+    class VirtualTexturePool
+    {
+      public:
+        static constexpr size_t DEFAULT_BUDGET = 8 << 20;
+        static constexpr size_t MAX_QUEUED_PAGES = 256; // Older requests are dropped when the camera moves on
+
+        // Opens the png as a virtual texture, building its page file first if it is missing or older than the
+        // png. The same path opened twice gives the same texture while it is in use. nullptr (and 'error') on
+        // failure.
+        std::shared_ptr<VirtualTexture> Open(const std::string& pngPath, std::string& error);
+
+        /*
+         * Called by the renderer between frames, never while rasterizing: marks the pages in 'feedback' as used,
+         * installs the pages loaded since the last call and queues the missing ones.
+         */
+        void Update(const FeedbackBuffer& feedback);
+
+        // Takes effect at the next Update (least recently used pages are evicted first).
+        void SetBudget(size_t bytes);
+        [[nodiscard]] size_t Budget() const;
+        [[nodiscard]] size_t ResidentBytes(); // Streamed pages only (tails are not counted)
+        [[nodiscard]] size_t PendingPages();
+
+        explicit VirtualTexturePool(size_t budgetBytes = DEFAULT_BUDGET);
+        ~VirtualTexturePool();
+
+      private:
+        friend class VirtualTexture;
+
+        struct Resident
+        {
+            VirtualTexture* texture;
+            uint32_t page;
+            uint64_t lastUsed;
+            std::unique_ptr<unsigned char[]> data;
+        };
+        struct Request
+        {
+            uint64_t key;
+            std::shared_ptr<const MappedFile> file;
+            size_t offset;
+        };
+        struct Loaded
+        {
+            uint64_t key;
+            std::unique_ptr<unsigned char[]> data;
+        };
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::thread loader; // Started with the first texture
+        bool stopping = false;
+        std::atomic<size_t> capacity; // In pages
+        uint64_t frame = 0;
+        uint32_t nextId = 1;
+        std::unordered_map<uint32_t, VirtualTexture*> textures;
+        std::map<std::string, std::weak_ptr<VirtualTexture>> paths;
+        std::unordered_map<uint64_t, Resident> resident; // By feedback key (texture id << 32 | page)
+        std::set<uint64_t> queued;                       // Requested or being read
+        std::deque<Request> requests;
+        std::vector<Loaded> loaded;
+
+        void loadPages();
+        bool evictOldest(uint64_t before);
+        void release(VirtualTexture& texture);
+    };
+} // namespace soft3d
@@ -4,18 +4,28 @@
 
 #pragma once
 #include "constants.hpp"
-#include <array>
+#include <algorithm>
+#include <vector>
 
 namespace soft3d
 {
 struct ZBuffer
 {
-    static constexpr unsigned long screenSize = SCREEN_WIDTH * SCREEN_HEIGHT;
-    std::array<float, screenSize> buffer{};
+    int width = static_cast<int>(SCREEN_WIDTH);
+    int height = static_cast<int>(SCREEN_HEIGHT);
+    std::vector<float> buffer = std::vector<float>(width * height);
+    // Rows are 'width' apart. Shrinking keeps the allocation, so the render scale can change every frame.
+    void
+    resize(int _width, int _height)
+    {
+        width = _width;
+        height = _height;
+        buffer.resize(static_cast<size_t>(width) * height);
+    }
     void
     clear()
     {
-        std::fill_n(buffer.begin(), screenSize, 0);
+        std::fill(buffer.begin(), buffer.end(), 0);
     }
 };
 }
@@ -1,8 +1,71 @@
 
 #include "Application.hpp"
-int main()
+#include "constants.hpp"
+#include "ObjParser.hpp"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+// Average time of 'iterations' calls to ObjParser::ParseObj, in ms. 'faces' is 0 if the file does not parse.
+double timeParse(const std::string& path, const ObjParser::Options& options, int iterations, size_t& faces)
+{
+    const auto start = std::chrono::steady_clock::now();
+    std::string error;
+    for (int i = 0; i < iterations; ++i)
+    {
+        const auto mesh = ObjParser::ParseObj(path.c_str(), options, error);
+        faces = mesh ? mesh->faces.size() : 0;
+    }
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+// Times loading every obj file in the resources folder (geometry only, textures are not decoded): parsing the
+// text, and mapping the binary mesh cache.
+void benchmarkParser(int iterations = 10)
 {
+    std::cout << "File\tfaces\tparse ms\tcache ms" << std::endl;
+    for (const auto& entry : std::filesystem::directory_iterator(RES_PATH))
+    {
+        if (entry.path().extension() != ".obj") continue;
+        const std::string path = entry.path().string();
+        size_t faces = 0;
+        const double parseMs = timeParse(path, {.loadTextures = false, .useMeshCache = false}, iterations, faces);
+        std::string error;
+        if (!ObjParser::ParseObj(path.c_str(), {.loadTextures = false}, error)) // Make sure the cache exists
+        {
+            std::cout << entry.path().filename().string() << "\t" << error << std::endl;
+            continue;
+        }
+        const double cacheMs = timeParse(path, {.loadTextures = false}, iterations, faces);
+        std::cout << entry.path().filename().string() << "\t" << faces << "\t" << parseMs << "\t" << cacheMs
+                  << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::strcmp(argv[1], "--bench-parse") == 0)
+    {
+        benchmarkParser();
+        return 0;
+    }
+
     soft3d::Application app;
+    if (argc > 1 && std::strcmp(argv[1], "--bench") == 0)
+    {
+        app.Benchmark();
+        return 0;
+    }
+    for (int i = 1; i < argc; ++i)
+    {
+        // Prepare the next frame while the last one is drawn (one frame more latency; only worth it with spare
+        // cores, and not yet measured to be)
+        if (std::strcmp(argv[i], "--pipeline") == 0) app.SetPipelined(true);
+        // Keep the full resolution instead of lowering it when frames run over 60 fps
+        if (std::strcmp(argv[i], "--fixed-resolution") == 0) app.SetFixedResolution();
+    }
     app.Run();
     return 0;
-}
\ No newline at end of file
+}
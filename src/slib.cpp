@@ -1,8 +1,15 @@
 #include "slib.hpp"
+#include <atomic>
 
 namespace slib
 {
 
+uint64_t nextTextureId()
+{
+    static std::atomic<uint64_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
 vec2 &vec2::operator*=(const vec2& rhs)
 {
     x *= rhs.x;
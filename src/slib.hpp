@@ -1,10 +1,17 @@
 #pragma once
+#include <memory>
 #include <utility>
 #include <vector>
 #include <array>
+#include <cstdint>
 #include <string>
 #include <iostream>
+#include <type_traits>
 
+namespace soft3d
+{
+class VirtualTexture;
+}
 
 namespace slib
 {
@@ -14,15 +21,55 @@ struct vec4;
 struct mat;
 struct material;
 
+enum AddressMode
+{
+    REPEAT,
+    CLAMP,
+    MIRROR
+};
+
+enum FilterMode
+{
+    FILTER_DEFAULT, // Use whatever filter the renderer is currently set to
+    FILTER_NEAREST,
+    FILTER_LINEAR
+};
+
+/*
+ * Describes how a material's textures are addressed and filtered. Read from the texture options in the mtl file.
+ */
+struct sampler
+{
+    AddressMode addressMode = REPEAT;
+    FilterMode filter = FILTER_DEFAULT;
+};
+
+enum TextureFormat
+{
+    RGBA8,
+    BC1 // 4x4 blocks of 8 bytes (two RGB565 endpoints + 2 bit indices). See TextureCompression.hpp
+};
+
+// A number no texture has had yet (see texture::id).
+uint64_t nextTextureId();
+
+/*
+ * Rows are stored bottom-up (flipped at load) so that v = 0 is the first row of 'data'.
+ */
 struct texture
 {
     int w, h;
     std::vector<unsigned char> data;
-    unsigned int bpp;
+    unsigned int bpp; // Bytes per pixel of the decoded texels
+    TextureFormat format = RGBA8;
+    // Never reused, unlike the texture's address once it is freed, so caches of its texels can key on it.
+    // Copies keep it: a texture's data must not change once it has been sampled.
+    uint64_t id = nextTextureId();
 };
 
 struct material
 {
+    std::string name;
     float Ns{};
     std::array<float,3> Ka{};
     std::array<float,3> Kd{};
@@ -31,9 +78,13 @@ struct material
     float Ni{};
     float d{};
     int illum{};
-    texture map_Kd;
-    texture map_Ks;
-    texture map_Ns;
+    // Shared and immutable: materials (and meshes) that use the same image point at one copy. nullptr if unset.
+    std::shared_ptr<const texture> map_Kd;
+    std::shared_ptr<const texture> map_Ks;
+    std::shared_ptr<const texture> map_Ns;
+    // Set instead of map_Kd when the diffuse map is streamed in pages (see VirtualTexture.hpp)
+    std::shared_ptr<soft3d::VirtualTexture> virtual_Kd;
+    sampler texSampler;
 };
 
 /*
@@ -41,10 +92,11 @@ struct material
  */
 struct tri
 {
-    const int v1, v2, v3;
-    const int vt1, vt2, vt3;
-    const std::string material;
+    int v1, v2, v3;
+    int vt1, vt2, vt3;
+    int material; // Index into the mesh's materials
 };
+static_assert(std::is_trivially_copyable_v<tri>);
 
 struct zvec2
 {
@@ -3,6 +3,7 @@
 //
 
 #include "smath.hpp"
+#include <algorithm>
 #include <cmath>
 #include "constants.hpp"
 
@@ -37,11 +38,19 @@ slib::vec3 normalize(slib::vec3 vec)
 /*
  * Returns the central normal of the triangle's face.
  */
-slib::vec3 facenormal(const slib::tri& t, const std::vector<slib::vec3>& points)
+slib::vec3 facenormal(const slib::tri& t, std::span<const slib::vec3> points)
+{
+    return normal(points[t.v1], points[t.v2], points[t.v3]);
+}
+
+/*
+ * Returns the unit normal of the triangle v1, v2, v3.
+ */
+slib::vec3 normal(const slib::vec3& v1, const slib::vec3& v2, const slib::vec3& v3)
 {
     slib::vec3 n({0, 0, 0 });
-    slib::vec3 a = points[t.v2] - points[t.v1];
-    slib::vec3 b = points[t.v3] - points[t.v1];
+    slib::vec3 a = v2 - v1;
+    slib::vec3 b = v3 - v1;
 
     n.x = a.y * b.z - a.z * b.y;
     n.y = a.z * b.x - a.x * b.z;
@@ -167,6 +176,12 @@ slib::mat scaleMatrix(const slib::vec3& scale)
                           });
 }
 
+slib::vec3 normalScale(const slib::vec3& scale)
+{
+    const float sign = scale.x * scale.y * scale.z < 0 ? -1.0f : 1.0f;
+    return {sign * scale.y * scale.z, sign * scale.x * scale.z, sign * scale.x * scale.y};
+}
+
 slib::mat translationMatrix(const slib::vec3& translation)
 {
     return slib::mat ({
@@ -177,4 +192,87 @@ slib::mat translationMatrix(const slib::vec3& translation)
                             });
 }
 
+mat4 flatten(const slib::mat& m)
+{
+    mat4 flat{};
+    for (int r = 0; r < 4; ++r)
+        for (int c = 0; c < 4; ++c)
+            flat[r * 4 + c] = m.data[r][c];
+    return flat;
+}
+
+slib::mat transpose(const slib::mat& m)
+{
+    std::vector<std::vector<float>> t(m.data[0].size(), std::vector<float>(m.data.size()));
+    for (size_t r = 0; r < m.data.size(); ++r)
+        for (size_t c = 0; c < m.data[r].size(); ++c)
+            t[c][r] = m.data[r][c];
+    return slib::mat(std::move(t));
+}
+
+mat4 transpose(const mat4& m)
+{
+    mat4 t{};
+    for (int r = 0; r < 4; ++r)
+        for (int c = 0; c < 4; ++c)
+            t[c * 4 + r] = m[r * 4 + c];
+    return t;
+}
+
+mat4 multiply(const mat4& a, const mat4& b)
+{
+    mat4 result{};
+    for (int r = 0; r < 4; ++r)
+        for (int c = 0; c < 4; ++c)
+            for (int k = 0; k < 4; ++k)
+                result[r * 4 + c] += a[r * 4 + k] * b[k * 4 + c];
+    return result;
+}
+
+mat4 inverse(const mat4& matrix)
+{
+    // In double: a projection's depth terms are far apart in magnitude
+    std::array<double, 16> m{}, inv{};
+    std::copy(matrix.begin(), matrix.end(), m.begin());
+    inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] +
+             m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+    inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] -
+             m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+    inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] +
+             m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+    inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] -
+              m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+    inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] -
+             m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+    inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] +
+             m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+    inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] -
+             m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+    inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] +
+              m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+    inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] +
+             m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+    inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] -
+             m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+    inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] +
+              m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+    inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] -
+              m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+    inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] -
+             m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+    inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] +
+             m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+    inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] -
+              m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+    inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] +
+              m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+    const double det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+    mat4 result{};
+    if (det == 0) return result;
+    for (int i = 0; i < 16; ++i)
+        result[i] = static_cast<float>(inv[i] / det);
+    return result;
+}
+
 }
\ No newline at end of file
@@ -3,6 +3,10 @@
 //
 
 #pragma once
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <span>
 #include <vector>
 #include "slib.hpp"
 
@@ -12,7 +16,7 @@ float distance(const slib::vec3& vec);
 slib::vec3 normalize(slib::vec3 vec);
 slib::vec3 centroid(const std::vector<slib::vec3>& points);
 slib::vec3 centroid(const slib::tri& t, const std::vector<slib::vec3>& points);
-slib::vec3 facenormal(const slib::tri& t, const std::vector<slib::vec3>& points);
+slib::vec3 facenormal(const slib::tri& t, std::span<const slib::vec3> points);
 slib::vec3 normal(const slib::vec3& v1, const slib::vec3& v2, const slib::vec3& v3);
 float dot(const slib::vec3& v1, const slib::vec3& v2);
 slib::vec3 cross(const slib::vec3& v1, const slib::vec3& v2);
@@ -20,8 +24,37 @@ slib::mat perspective(float  zFar, float zNear, float aspect, float fov);
 slib::mat view(const slib::vec3& eye, const slib::vec3& target, const slib::vec3& up);
 slib::mat rotationMatrix(const slib::vec3& eulerAngles);
 slib::mat scaleMatrix(const slib::vec3& scale);
+// The scale for the normals of a model scaled by 'scale': the inverse transpose of a scale is its reciprocal,
+// taken here times |x * y * z| so a zero scale stays finite (normals are renormalised after transforming).
+slib::vec3 normalScale(const slib::vec3& scale);
 slib::mat translationMatrix(const slib::vec3& translation);
 slib::mat fpsview( const slib::vec3& eye, float pitch, float yaw );
+// The matrices above are built transposed from the order slib::mat's operator* applies them in (it gives
+// (b * a) transposed); this gives the matrix to apply as m * v.
+slib::mat transpose(const slib::mat& m);
+
+// Flat row-major 4x4 matrix, applied as m * v like slib::mat but without the heap allocations, so it is cheap
+// enough to build per instance.
+using mat4 = std::array<float, 16>;
+mat4 flatten(const slib::mat& m);
+mat4 transpose(const mat4& m);
+// a * b in the usual order (slib::mat's operator* gives (b * a) transposed).
+mat4 multiply(const mat4& a, const mat4& b);
+// Inverse by cofactors. A singular matrix gives all zeros.
+mat4 inverse(const mat4& m);
+
+// Approximate 1/sqrt(x) (bit trick plus one Newton-Raphson step, ~0.2% error). Used in the per-pixel shaders.
+inline float fastInvSqrt(float x)
+{
+    const float half = x * 0.5f;
+    float y = std::bit_cast<float>(0x5f3759df - (std::bit_cast<uint32_t>(x) >> 1));
+    return y * (1.5f - half * y * y);
+}
+
+inline slib::vec3 fastNormalize(const slib::vec3& vec)
+{
+    return vec * fastInvSqrt(vec.x * vec.x + vec.y * vec.y + vec.z * vec.z);
+}
 };
 
 
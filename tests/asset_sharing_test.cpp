@@ -0,0 +1,61 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+// Checks that the asset registry shares what it should: a model loaded twice is one mesh, its texture asked for
+// again (as another scene would) is the one already decoded, and releasing the last user frees both. Run from
+// the repository root (ctest does), where "resources/" is.
+
+#include "AssetRegistry.hpp"
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool ok, const char* what)
+    {
+        if (ok) return;
+        std::cout << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+} // namespace
+
+int main()
+{
+    const std::string model = "resources/viking_room.obj", image = "resources/viking_room.png";
+    soft3d::AssetRegistry registry;
+    const ObjParser::Options options{.compressTextures = true};
+
+    std::string error;
+    auto first = registry.LoadMesh(model, options, error);
+    auto second = registry.LoadMesh(model, options, error);
+    if (!first || !second)
+    {
+        std::cout << "FAILED: could not load " << model << " (" << error << ")" << std::endl;
+        return 1;
+    }
+    check(first == second && first.use_count() == 2, "mesh loaded twice");
+    const auto& material = first->materials.at(0);
+    check(material.map_Kd != nullptr, "texture not loaded");
+    auto textures = registry.LoadTextures({{image, slib::BC1}, {image, slib::BC1}}, false);
+    check(
+        textures.size() == 2 && textures[0].texture == material.map_Kd && textures[1].texture == material.map_Kd,
+        "texture decoded twice");
+    check(registry.MeshCount() == 1, "more than one mesh in the registry");
+    check(registry.TextureCount() == 1, "more than one texture in the registry");
+
+    const std::weak_ptr<const soft3d::Mesh> mesh = first;
+    const std::weak_ptr<const slib::texture> texture = material.map_Kd;
+    first.reset();
+    second.reset();
+    check(mesh.expired() && registry.MeshCount() == 0, "mesh not freed with its last user");
+    check(!texture.expired(), "texture freed while in use");
+    textures.clear(); // The texture's last user
+    check(texture.expired() && registry.TextureCount() == 0, "texture not freed with its last user");
+
+    if (failures == 0) std::cout << "Asset sharing OK" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
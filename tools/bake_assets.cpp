@@ -0,0 +1,62 @@
+//
+// Created by Steve Wheeler on 18/10/2026.
+//
+
+// Pre-builds the binary mesh cache of each model (and, with --bc1, the compressed texture caches; with --chunks,
+// the chunk files used to stream it, see StreamingMesh) so the renderer never has to parse them at startup. Run
+// from the directory containing 'resources/'.
+// Usage: bake_assets [--bc1] [--chunks] [model.obj ...]    (no models: every obj in resources/)
+
+#include "constants.hpp"
+#include "ObjParser.hpp"
+#include "StreamingMesh.hpp"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    bool compressTextures = false;
+    bool buildChunks = false;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--bc1") == 0)
+            compressTextures = true;
+        else if (std::strcmp(argv[i], "--chunks") == 0)
+            buildChunks = true;
+        else
+            paths.emplace_back(argv[i]);
+    }
+    if (paths.empty())
+    {
+        for (const auto& entry : std::filesystem::directory_iterator(RES_PATH))
+            if (entry.path().extension() == ".obj") paths.push_back(entry.path().string());
+    }
+
+    for (const auto& path : paths)
+    {
+        // Remove the old cache so that ParseObj parses the text and writes a new one
+        std::filesystem::remove(path + ".mesh");
+        const auto start = std::chrono::steady_clock::now();
+        const ObjParser::Options options{
+            .compressTextures = compressTextures, .cacheTextures = true, .loadTextures = compressTextures};
+        std::string error;
+        const auto mesh = ObjParser::ParseObj(path.c_str(), options, error);
+        if (!mesh)
+        {
+            std::cout << path << ": " << error << std::endl;
+            continue;
+        }
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << path << ": " << mesh->vertices.size() << " vertices, " << mesh->faces.size() << " faces ("
+                  << elapsed.count() << " ms)" << std::endl;
+
+        if (buildChunks && !soft3d::StreamingMesh::BuildChunkFile(path, error))
+            std::cout << path << ": could not build the chunk file (" << error << ")" << std::endl;
+    }
+    return 0;
+}